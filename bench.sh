@@ -6,4 +6,20 @@ echo 'SSIM GPU'
 time ./IQM --method SSIM --input ../input.png --ref ../ref.png --output ../out.png >/dev/null
 
 echo 'SSIM CPU'
-time ./IQM --method SSIM_CPU --input ../input.png --ref ../ref.png --output ../out.png >/dev/null
\ No newline at end of file
+time ./IQM --method SSIM_CPU --input ../input.png --ref ../ref.png --output ../out.png >/dev/null
+
+# default 11x11 window with sigma 1.5, compare the ssim and ssim_gaussinput passes in the GPU timers
+# the Startup line includes compiling the specialized variants, the first computation must not create any
+echo 'SSIM GPU, specialized pipelines'
+./IQM --method SSIM --input ../input.png --ref ../ref.png -v | grep -E 'ssim|Startup'
+
+echo 'SSIM GPU, parameters in push constants'
+./IQM --method SSIM --input ../input.png --ref ../ref.png SSIM_SPECIALIZE 0 -v | grep -E 'ssim|Startup'
+
+echo 'FLIP GPU, default and custom viewing condition'
+./IQM --method FLIP --input ../input.png --ref ../ref.png -v | grep -E 'flip|Startup'
+./IQM --method FLIP --input ../input.png --ref ../ref.png FLIP_DISTANCE 1.0 -v | grep -E 'flip|Startup'
+
+# peak is measured by the allocator, the transient line shows how much of it aliasing saved
+echo 'FSIM GPU, device memory'
+./IQM --method FSIM --input ../input.png --ref ../ref.png -v | grep -E 'Device memory|Transient memory'
@@ -15,5 +15,10 @@ for i in $files; do
   path=${i#shaders/}
   path=${path%.glsl}
   # compile shaders to files which are then included
-  glslc "$i" -o "shaders_out/$path.inc" -mfmt=c
+  # the runtime requires Vulkan 1.2, subgroup operations need SPIR-V 1.3 at least
+  glslc "$i" -o "shaders_out/$path.inc" -mfmt=c --target-env=vulkan1.2 -DINTERMEDIATE_RG=rg32f -DINTERMEDIATE_RGBA=rgba32f
+  # shaders using intermediate images get a 16 bit variant as well, see VulkanRuntime::intermediateFormat
+  if grep -q "INTERMEDIATE_" "$i"; then
+    glslc "$i" -o "shaders_out/${path}_fp16.inc" -mfmt=c --target-env=vulkan1.2 -DINTERMEDIATE_RG=rg16f -DINTERMEDIATE_RGBA=rgba16f
+  fi
 done
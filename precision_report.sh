@@ -0,0 +1,78 @@
+#!/bin/bash
+
+# final scores with 16 bit intermediate images (--fp16) against the default 32 bit ones
+# usage: ./precision_report.sh [IQM binary] [corpus], every directory of the corpus holds one input.png and ref.png pair
+# devices without rg16f storage images stay at 32 bit, IQM -v prints which precision was used
+
+iqm=${1:-cmake-build-debug/IQM}
+corpus=${2:-corpus}
+
+pairs=()
+for dir in "$corpus"/*/; do
+  dir=${dir%/}
+  if [ -f "$dir/input.png" ] && [ -f "$dir/ref.png" ]; then
+    pairs+=(--input "$dir/input.png" --ref "$dir/ref.png")
+  fi
+done
+
+# a single pair would not run in batch mode, which prints one line per pair
+if [ ${#pairs[@]} -lt 8 ]; then
+  echo "$corpus needs at least two pairs" >&2
+  exit 1
+fi
+
+for method in SSIM FSIM FLIP; do
+  echo "$method"
+
+  fp32=$("$iqm" --method "$method" "${pairs[@]}" | grep -F -- "$corpus")
+  fp16=$("$iqm" --method "$method" --fp16 "${pairs[@]}" | grep -F -- "$corpus")
+
+  # lines are "input ref: NAME: value ...", pairs are matched by their label, so a pair failing in one run
+  # is reported as failed instead of shifting the values of the others
+  awk '
+    {
+      split_at = index($0, ": ")
+      pair = substr($0, 1, split_at - 1)
+      rest = substr($0, split_at + 2)
+    }
+    FNR == NR {
+      fp32[pair] = rest
+      order[++n] = pair
+      next
+    }
+    {
+      fp16[pair] = rest
+    }
+    END {
+      for (k = 1; k <= n; k++) {
+        pair = order[k]
+        if (!(pair in fp16) || fp32[pair] ~ /^error:/ || fp16[pair] ~ /^error:/) {
+          printf "  %s failed: fp32 %s, fp16 %s\n", pair, fp32[pair], (pair in fp16) ? fp16[pair] : "missing"
+          failed++
+          continue
+        }
+        m = split(fp32[pair], a, " ")
+        split(fp16[pair], b, " ")
+        for (i = 1; i < m; i += 2) {
+          name = substr(a[i], 1, length(a[i]) - 1)
+          diff = b[i + 1] - a[i + 1]
+          if (diff < 0) {
+            diff = -diff
+          }
+          printf "  %s %s: fp32 %.7f fp16 %.7f diff %.7f\n", pair, name, a[i + 1], b[i + 1], diff
+          sum[name] += diff
+          count[name]++
+          if (diff > max[name]) {
+            max[name] = diff
+          }
+        }
+      }
+      for (name in count) {
+        printf "  %s: mean abs diff %.7f, max abs diff %.7f over %d pairs\n", name, sum[name] / count[name], max[name], count[name]
+      }
+      if (failed > 0) {
+        printf "  %d pairs failed\n", failed
+      }
+    }
+  ' <(echo "$fp32") <(echo "$fp16")
+done
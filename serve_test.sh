@@ -0,0 +1,71 @@
+#!/bin/bash
+
+# round trips through IQM --serve and IQM-client, the values must match a direct run of IQM
+# usage: ./serve_test.sh [build directory] [input] [reference], exits with 1 if any check fails
+
+build=${1:-cmake-build-debug}
+input=${2:-input.png}
+ref=${3:-ref.png}
+
+socket=$(mktemp -u /tmp/iqm-serve-test.XXXXXX)
+output=$(mktemp /tmp/iqm-serve-test.XXXXXX.png)
+
+"$build/IQM" --serve "$socket" >/dev/null &
+server=$!
+trap 'kill $server 2>/dev/null; rm -f "$output"' EXIT
+
+# the socket only appears once the runtime is initialized
+for _ in $(seq 300); do
+  [ -S "$socket" ] && break
+  sleep 0.1
+done
+if [ ! -S "$socket" ]; then
+  echo "server did not start" >&2
+  exit 1
+fi
+
+failed=0
+check() {
+  if [ "$2" == "$3" ]; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1"
+    echo "  expected: $2"
+    echo "  got:      $3"
+    failed=1
+  fi
+}
+
+# FLIP prints no value in a direct run, it is only checked for an answer
+for method in SSIM SVD FSIM; do
+  expected=$("$build/IQM" --method $method --input "$input" --ref "$ref" | grep -E '^[A-Za-z-]+: ')
+  check "$method by path" "$expected" "$("$build/IQM-client" --socket "$socket" --method $method --input "$input" --ref "$ref")"
+  check "$method inline" "$expected" "$("$build/IQM-client" --socket "$socket" --method $method --input "$input" --ref "$ref" --inline)"
+done
+check "FLIP" "0" "$("$build/IQM-client" --socket "$socket" --method FLIP --input "$input" --ref "$ref" | grep -c -v '^FLIP: ')"
+
+rm -f "$output"
+"$build/IQM-client" --socket "$socket" --method SSIM --input "$input" --ref "$ref" --output "$output" >/dev/null
+check "output image" "yes" "$([ -s "$output" ] && echo yes || echo no)"
+
+"$build/IQM-client" --socket "$socket" --method SSIM --input "$input" --ref /nonexistent.png >/dev/null 2>&1
+check "missing image is an error" "1" "$?"
+
+# more clients than lanes, each one must still get its own answer
+expected=$("$build/IQM-client" --socket "$socket" --method SSIM --input "$input" --ref "$ref")
+results=$(mktemp -d)
+clients=()
+for i in $(seq 16); do
+  "$build/IQM-client" --socket "$socket" --method SSIM --input "$input" --ref "$ref" --inline > "$results/$i" &
+  clients+=($!)
+done
+wait "${clients[@]}"
+check "concurrent clients" "16" "$(grep -l -x -F "$expected" "$results"/* | wc -l)"
+rm -r "$results"
+
+kill -TERM $server
+wait $server
+check "clean shutdown" "0" "$?"
+check "socket removed" "no" "$([ -e "$socket" ] && echo yes || echo no)"
+
+exit $failed
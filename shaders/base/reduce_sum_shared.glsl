@@ -0,0 +1,58 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#version 450
+#pragma shader_stage(compute)
+
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
+
+// only the first pass squares its input
+layout (constant_id = 2) const bool SQUARE = false;
+
+layout(std430, set = 0, binding = 0) readonly buffer InBuf {
+    float inData[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer OutBuf {
+    float outData[];
+};
+
+layout( push_constant ) uniform constants {
+    // first element and number of elements to sum
+    uint offset;
+    uint size;
+    // workgroup N writes its sum to outData[outIndex + N]
+    uint outIndex;
+} push_consts;
+
+// sized by the specialized workgroup size, a power of two
+shared float subSums[gl_WorkGroupSize.x];
+void main() {
+    uint tid = gl_LocalInvocationID.x;
+
+    // workgroups stride over the whole input, so any number of them covers it
+    float sum = 0.0;
+    for (uint i = gl_GlobalInvocationID.x; i < push_consts.size; i += gl_NumWorkGroups.x * gl_WorkGroupSize.x) {
+        float value = inData[push_consts.offset + i];
+        sum += SQUARE ? value * value : value;
+    }
+    subSums[tid] = sum;
+
+    memoryBarrierShared();
+    barrier();
+
+    for (uint s = gl_WorkGroupSize.x / 2; s > 0; s >>= 1) {
+        if (tid < s) {
+            subSums[tid] += subSums[tid + s];
+        }
+
+        memoryBarrierShared();
+        barrier();
+    }
+
+    if (tid == 0) {
+        outData[push_consts.outIndex + gl_WorkGroupID.x] = subSums[0];
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#version 450
+#pragma shader_stage(compute)
+#extension GL_KHR_shader_subgroup_arithmetic : require
+
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
+
+// only the first pass squares its input
+layout (constant_id = 2) const bool SQUARE = false;
+
+layout(std430, set = 0, binding = 0) readonly buffer InBuf {
+    float inData[];
+};
+
+layout(std430, set = 0, binding = 1) writeonly buffer OutBuf {
+    float outData[];
+};
+
+layout( push_constant ) uniform constants {
+    // first element and number of elements to sum
+    uint offset;
+    uint size;
+    // workgroup N writes its sum to outData[outIndex + N]
+    uint outIndex;
+} push_consts;
+
+// one value per subgroup, there are never more subgroups than invocations
+shared float subgroupSums[gl_WorkGroupSize.x];
+void main() {
+    // workgroups stride over the whole input, so any number of them covers it
+    float sum = 0.0;
+    for (uint i = gl_GlobalInvocationID.x; i < push_consts.size; i += gl_NumWorkGroups.x * gl_WorkGroupSize.x) {
+        float value = inData[push_consts.offset + i];
+        sum += SQUARE ? value * value : value;
+    }
+
+    sum = subgroupAdd(sum);
+    if (subgroupElect()) {
+        subgroupSums[gl_SubgroupID] = sum;
+    }
+
+    memoryBarrierShared();
+    barrier();
+
+    // small subgroups can leave more partial sums than the first subgroup has invocations
+    if (gl_SubgroupID == 0) {
+        float total = 0.0;
+        for (uint i = gl_SubgroupInvocationID; i < gl_NumSubgroups; i += gl_SubgroupSize) {
+            total += subgroupSums[i];
+        }
+
+        total = subgroupAdd(total);
+        if (subgroupElect()) {
+            outData[push_consts.outIndex + gl_WorkGroupID.x] = total;
+        }
+    }
+}
@@ -10,9 +10,8 @@ layout (local_size_x = 16, local_size_y = 1) in;
 
 layout(set = 0, binding = 0, rgba32f) uniform writeonly image2D filter_img;
 
-layout( push_constant ) uniform constants {
-    float pixels_per_degree;
-} push_consts;
+// the filter only depends on the viewing condition, one pipeline is created per condition
+layout(constant_id = 0) const float PIXELS_PER_DEGREE = 52.13; // default FLIPArguments
 
 void main() {
     uint x = gl_WorkGroupID.x * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
@@ -24,7 +23,7 @@ void main() {
     }
 
     float w = 0.082;
-    float sd = 0.5 * w * push_consts.pixels_per_degree;
+    float sd = 0.5 * w * PIXELS_PER_DEGREE;
     int radius = int(ceil(3.0 * sd));
 
     int xCoord = int(x) - radius;
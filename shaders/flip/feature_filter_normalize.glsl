@@ -10,10 +10,6 @@ layout (local_size_x = 16, local_size_y = 1) in;
 
 layout(set = 0, binding = 0, rgba32f) uniform image2D filter_img;
 
-layout( push_constant ) uniform constants {
-    float pixels_per_degree;
-} push_consts;
-
 void main() {
     uint x = gl_WorkGroupID.x * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
     uint y = gl_WorkGroupID.y * gl_WorkGroupSize.y + gl_LocalInvocationID.y;
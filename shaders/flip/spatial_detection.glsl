@@ -6,9 +6,9 @@
 #version 450
 #pragma shader_stage(compute)
 
-layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
-layout(set = 0, binding = 0, rgba32f) uniform readonly image2D input_img[2];
+layout(set = 0, binding = 0, INTERMEDIATE_RGBA) uniform readonly image2D input_img[2];
 layout(set = 0, binding = 1, r32f) uniform writeonly image2D output_img;
 
 const mat3 RGB_TO_XYZ = mat3(
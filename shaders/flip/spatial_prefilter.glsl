@@ -10,12 +10,11 @@
 
 layout (local_size_x = 16, local_size_y = 16) in;
 
-layout(set = 0, binding = 0, rgba32f) uniform readonly image2D input_img[2];
-layout(set = 0, binding = 1, rgba32f) uniform writeonly image2D output_img[2];
+layout(set = 0, binding = 0, INTERMEDIATE_RGBA) uniform readonly image2D input_img[2];
+layout(set = 0, binding = 1, INTERMEDIATE_RGBA) uniform writeonly image2D output_img[2];
 
-layout( push_constant ) uniform constants {
-    float pixels_per_degree;
-} push_consts;
+// one pipeline per viewing condition, the filter radius and weights fold into constants
+layout(constant_id = 0) const float PIXELS_PER_DEGREE = 52.13; // default FLIPArguments
 
 const mat3 XYZ_TO_RGB = mat3(
     3.241003275, -1.537398934, -0.498615861,
@@ -48,9 +47,9 @@ void main() {
         return;
     }
 
-    int radius = int(ceil(3.0 * sqrt(0.04 / (2.0 * PI * PI)) * push_consts.pixels_per_degree));
+    int radius = int(ceil(3.0 * sqrt(0.04 / (2.0 * PI * PI)) * PIXELS_PER_DEGREE));
     int halfSize = radius;
-    float deltaX = 1.0 / push_consts.pixels_per_degree;
+    float deltaX = 1.0 / PIXELS_PER_DEGREE;
 
     vec3 opponent = vec3(0.0);
     vec3 opponentTotal = vec3(0.0);
@@ -7,11 +7,11 @@
 #pragma shader_stage(compute)
 #extension GL_EXT_debug_printf : enable
 
-layout (local_size_x = 8, local_size_y = 8) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 layout(set = 0, binding = 0, rgba8) uniform readonly image2D input_img;
 // each pixel is [I, Q, Y, 1], where I, Q, Y are FSIM color values
-layout(set = 0, binding = 1, rgba32f) uniform writeonly image2D output_img;
+layout(set = 0, binding = 1, INTERMEDIATE_RGBA) uniform writeonly image2D output_img;
 
 layout( push_constant ) uniform constants {
     // FSIM scaling factor
@@ -9,7 +9,7 @@
 layout (local_size_x = 8, local_size_y = 8) in;
 
 // each pixel is [I, Q, Y, 1], where I, Q, Y are FSIM color values
-layout(set = 0, binding = 0, rgba32f) uniform readonly image2D input_img;
+layout(set = 0, binding = 0, INTERMEDIATE_RGBA) uniform readonly image2D input_img;
 layout(std430, set = 0, binding = 1) buffer outputBuf {
     float outData[];
 };
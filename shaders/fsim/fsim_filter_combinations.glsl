@@ -10,7 +10,7 @@
 #define SCALES 4
 #define OxS 16
 
-layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 layout(set = 0, binding = 0, r32f) uniform readonly image2D angular_filters[SCALES];
 layout(set = 0, binding = 1, r32f) uniform readonly image2D gabor_filters[ORIENTATIONS];
@@ -6,10 +6,10 @@
 #version 450
 #pragma shader_stage(compute)
 
-layout (local_size_x = 8, local_size_y = 8) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 // each pixel is [I, Q, Y, 1], where I, Q, Y are FSIM color values
-layout(set = 0, binding = 0, rgba32f) uniform readonly image2D input_imgs[2];
+layout(set = 0, binding = 0, INTERMEDIATE_RGBA) uniform readonly image2D input_imgs[2];
 layout(set = 0, binding = 1, r32f) uniform readonly image2D gradient_imgs[2];
 layout(set = 0, binding = 2, r32f) uniform readonly image2D phase_congruency_imgs[2];
 // The three output images need to be summed separately
@@ -10,7 +10,7 @@
 layout (local_size_x = 8, local_size_y = 8) in;
 
 // each pixel is [I, Q, Y, 1], where I, Q, Y are FSIM color values
-layout(set = 0, binding = 0, rgba32f) uniform readonly image2D input_img;
+layout(set = 0, binding = 0, INTERMEDIATE_RGBA) uniform readonly image2D input_img;
 layout(set = 0, binding = 1, r32f) uniform writeonly image2D output_img;
 
 const float verticalArray[9] = float[9](3.0, 0.0, -3.0, 10.0, 0.0, -10.0, 3.0, 0.0, -3.0);
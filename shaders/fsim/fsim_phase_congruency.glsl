@@ -11,7 +11,7 @@
 #define SCALES 4
 #define OxS 16
 
-layout (local_size_x = 8, local_size_y = 8) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 layout(set = 0, binding = 0, r32f) uniform writeonly image2D phase_congruency[2];
 layout(std430, set = 0, binding = 1) buffer InNPBuf {
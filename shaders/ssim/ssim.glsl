@@ -5,14 +5,23 @@
 
 #version 450
 #pragma shader_stage(compute)
+#extension GL_EXT_control_flow_attributes : require
 
 #define E 2.71828182846
 #define PI 3.141592653589
 
-layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
-layout(set = 0, binding = 0, rg32f) uniform readonly image2D luma_img;
-layout(set = 0, binding = 1, rg32f) uniform readonly image2D lumaBlur_img;
+// parameters are fixed per pipeline, so the loops unroll and gaussian weights fold into constants
+layout(constant_id = 2) const int KERNEL_SIZE = 11;
+layout(constant_id = 3) const float SIGMA = 1.5;
+layout(constant_id = 4) const float K_1 = 0.01;
+layout(constant_id = 5) const float K_2 = 0.03;
+// reads the parameters from push constants instead, only kept to compare against in benchmarks
+layout(constant_id = 6) const bool DYNAMIC_PARAMS = false;
+
+layout(set = 0, binding = 0, INTERMEDIATE_RG) uniform readonly image2D luma_img;
+layout(set = 0, binding = 1, INTERMEDIATE_RG) uniform readonly image2D lumaBlur_img;
 layout(set = 0, binding = 2, r32f) uniform writeonly image2D output_img;
 
 layout( push_constant ) uniform constants {
@@ -22,14 +31,19 @@ layout( push_constant ) uniform constants {
     float sigma;
 } push_consts;
 
-float gaussWeight(ivec2 offset) {
+float gaussWeight(ivec2 offset, float sigma) {
     float dist = (offset.x * offset.x) + (offset.y * offset.y);
-    return pow(E, -(dist / (2.0 * pow(push_consts.sigma, 2.0))));
+    return exp(-(dist / (2.0 * sigma * sigma)));
 }
 
 void main() {
-    float c_1 = pow(push_consts.k_1, 2);
-    float c_2 = pow(push_consts.k_2, 2);
+    int kernelSize = DYNAMIC_PARAMS ? push_consts.kernelSize : KERNEL_SIZE;
+    float sigma = DYNAMIC_PARAMS ? push_consts.sigma : SIGMA;
+    float k_1 = DYNAMIC_PARAMS ? push_consts.k_1 : K_1;
+    float k_2 = DYNAMIC_PARAMS ? push_consts.k_2 : K_2;
+
+    float c_1 = k_1 * k_1;
+    float c_2 = k_2 * k_2;
 
     uint x = gl_WorkGroupID.x * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
     uint y = gl_WorkGroupID.y * gl_WorkGroupSize.y + gl_LocalInvocationID.y;
@@ -49,16 +63,16 @@ void main() {
     float coVar = 0.0;
 
     float totalWeight = 0.0;
-    int start = -(push_consts.kernelSize - 1) / 2;
-    int end = (push_consts.kernelSize - 1) / 2;
-    for (int xOffset = start; xOffset <= end; xOffset++) {
-        for (int yOffset = start; yOffset <= end; yOffset++) {
+    int start = -(kernelSize - 1) / 2;
+    int end = (kernelSize - 1) / 2;
+    [[unroll]] for (int xOffset = start; xOffset <= end; xOffset++) {
+        [[unroll]] for (int yOffset = start; yOffset <= end; yOffset++) {
             int x = pos.x + xOffset;
             int y = pos.y + yOffset;
             if (x >= maxPos.x || y >= maxPos.y || x < 0 || y < 0) {
                 continue;
             }
-            float weight = gaussWeight(ivec2(xOffset, yOffset));
+            float weight = gaussWeight(ivec2(xOffset, yOffset), sigma);
 
             vec2 luma = imageLoad(luma_img, ivec2(x, y)).xy;
 
@@ -5,26 +5,35 @@
 
 #version 450
 #pragma shader_stage(compute)
+#extension GL_EXT_control_flow_attributes : require
 
 #define E 2.71828182846
 #define PI 3.141592653589
 
-layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
-layout(set = 0, binding = 0, rg32f) uniform readonly image2D input_img;
-layout(set = 0, binding = 1, rg32f) uniform writeonly image2D output_img;
+// same constants as ssim.glsl
+layout(constant_id = 2) const int KERNEL_SIZE = 11;
+layout(constant_id = 3) const float SIGMA = 1.5;
+layout(constant_id = 4) const bool DYNAMIC_PARAMS = false;
+
+layout(set = 0, binding = 0, INTERMEDIATE_RG) uniform readonly image2D input_img;
+layout(set = 0, binding = 1, INTERMEDIATE_RG) uniform writeonly image2D output_img;
 
 layout( push_constant ) uniform constants {
     int kernelSize;
     float sigma;
 } push_consts;
 
-float gaussWeight(ivec2 offset) {
+float gaussWeight(ivec2 offset, float sigma) {
     float dist = (offset.x * offset.x) + (offset.y * offset.y);
-    return pow(E, -(dist / (2.0 * pow(push_consts.sigma, 2.0))));
+    return exp(-(dist / (2.0 * sigma * sigma)));
 }
 
 void main() {
+    int kernelSize = DYNAMIC_PARAMS ? push_consts.kernelSize : KERNEL_SIZE;
+    float sigma = DYNAMIC_PARAMS ? push_consts.sigma : SIGMA;
+
     uint x = gl_WorkGroupID.x * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
     uint y = gl_WorkGroupID.y * gl_WorkGroupSize.y + gl_LocalInvocationID.y;
     ivec2 pos = ivec2(x, y);
@@ -37,16 +46,16 @@ void main() {
 
     vec2 total = vec2(0.0);
     float totalWeight = 0.0;
-    int start = -(push_consts.kernelSize - 1) / 2;
-    int end = (push_consts.kernelSize - 1) / 2;
-    for (int xOffset = start; xOffset <= end; xOffset++) {
-        for (int yOffset = start; yOffset <= end; yOffset++) {
+    int start = -(kernelSize - 1) / 2;
+    int end = (kernelSize - 1) / 2;
+    [[unroll]] for (int xOffset = start; xOffset <= end; xOffset++) {
+        [[unroll]] for (int yOffset = start; yOffset <= end; yOffset++) {
             int x = pos.x + xOffset;
             int y = pos.y + yOffset;
             if (x >= maxPos.x || y >= maxPos.y || x < 0 || y < 0) {
                 continue;
             }
-            float weight = gaussWeight(ivec2(xOffset, yOffset));
+            float weight = gaussWeight(ivec2(xOffset, yOffset), sigma);
             total += imageLoad(input_img, ivec2(x, y)).xy * weight;
             totalWeight += weight;
         }
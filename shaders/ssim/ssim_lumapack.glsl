@@ -9,11 +9,11 @@
 #define E 2.71828182846
 #define PI 3.141592653589
 
-layout (local_size_x = 16, local_size_y = 16) in;
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
 
 layout(set = 0, binding = 0, rgba8) uniform readonly image2D input_img;
 layout(set = 0, binding = 1, rgba8) uniform readonly image2D ref_img;
-layout(set = 0, binding = 2, rg32f) uniform writeonly image2D output_img;
+layout(set = 0, binding = 2, INTERMEDIATE_RG) uniform writeonly image2D output_img;
 
 // Rec. 601 - same as openCV
 float luminance(vec4 color) {
@@ -14,49 +14,87 @@ IQM::Args::Args(const unsigned argc, const char *argv[]) {
     for (unsigned i = 0; i < argc; i++) {
         if (i + 1 < argc) {
             if (strcmp(argv[i], "--method") == 0) {
-                if (strcmp(argv[i + 1], "SSIM") == 0) {
-                    this->method = Method::SSIM;
-                    parsedMethod = true;
-                } else if (strcmp(argv[i + 1], "CW_SSIM_CPU") == 0) {
-                    this->method = Method::CW_SSIM_CPU;
-                    parsedMethod = true;
-                } else if (strcmp(argv[i + 1], "SVD") == 0) {
-                    this->method = Method::SVD;
-                    parsedMethod = true;
-                } else if (strcmp(argv[i + 1], "FSIM") == 0) {
-                    this->method = Method::FSIM;
-                    parsedMethod = true;
-                } else if (strcmp(argv[i + 1], "FLIP") == 0) {
-                    this->method = Method::FLIP;
-                    parsedMethod = true;
-                } else {
-                    throw std::runtime_error("Unknown method");
-                }
+                this->method = parse_method(argv[i + 1]);
+                parsedMethod = true;
             } else if (strcmp(argv[i], "--input") == 0) {
                 this->inputPath = std::string(argv[i + 1]);
+                this->inputPaths.emplace_back(argv[i + 1]);
                 parsedInput = true;
             } else if (strcmp(argv[i], "--ref") == 0) {
                 this->refPath = std::string(argv[i + 1]);
+                this->refPaths.emplace_back(argv[i + 1]);
                 parsedReference = true;
             } else if (strcmp(argv[i], "--output") == 0) {
                 this->outputPath = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--pipeline-cache") == 0) {
+                this->pipelineCachePath = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--workgroup-sizes") == 0) {
+                this->workgroupSizesDir = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--device") == 0) {
+                this->device = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--devices") == 0) {
+                this->devices = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--batch") == 0) {
+                this->batchManifest = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--input-dir") == 0) {
+                this->inputDir = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--ref-dir") == 0) {
+                this->refDir = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--serve") == 0) {
+                this->servePath = std::string(argv[i + 1]);
+            } else if (strcmp(argv[i], "--socket") == 0) {
+                this->socketPath = std::string(argv[i + 1]);
             } else {
                 this->options.emplace(std::string(argv[i]), std::string(argv[i + 1]));
             }
         }
-        if (strcmp(argv[i], "-v") == 0) {
+        if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             this->verbose = true;
         }
+        if (strcmp(argv[i], "--autotune") == 0) {
+            this->autotune = true;
+        }
+        if (strcmp(argv[i], "--fp16") == 0) {
+            this->halfPrecision = true;
+        }
+        if (strcmp(argv[i], "--debug-gpu") == 0) {
+            this->debugGpu = true;
+        }
+        if (strcmp(argv[i], "--inline") == 0) {
+            this->inlinePixels = true;
+        }
+    }
+
+    this->methodSelected = parsedMethod;
+    // synthetic images are used for tuning, the server gets method and images with every request
+    if (this->autotune || this->servePath.has_value()) {
+        return;
     }
 
     if (!parsedMethod) {
         throw std::runtime_error("missing method");
     }
+    // pairs come from the manifest or the directories
+    if (this->inputDir.has_value() != this->refDir.has_value()) {
+        throw std::runtime_error("--input-dir and --ref-dir must be used together");
+    }
+    if (this->batchManifest.has_value() && this->inputDir.has_value()) {
+        throw std::runtime_error("--batch cannot be combined with --input-dir and --ref-dir");
+    }
+    if (this->batchManifest.has_value() || this->inputDir.has_value()) {
+        if (parsedInput || parsedReference) {
+            throw std::runtime_error("--batch and --input-dir cannot be combined with --input and --ref");
+        }
+        return;
+    }
     if (!parsedInput) {
         throw std::runtime_error("missing input");
     }
     if (!parsedReference) {
         throw std::runtime_error("missing reference");
     }
+    if (this->inputPaths.size() != this->refPaths.size()) {
+        throw std::runtime_error("every input needs a matching reference");
+    }
 }
 
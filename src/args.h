@@ -10,17 +10,45 @@
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 namespace IQM {
     class Args {
     public:
         Args(unsigned argc, const char* argv[]);
         Method method;
+        // only false with --autotune, which then tunes every compiled metric
+        bool methodSelected = false;
         std::string inputPath;
         std::string refPath;
+        // --input and --ref can be repeated, pairs are matched in order
+        std::vector<std::string> inputPaths;
+        std::vector<std::string> refPaths;
         std::optional<std::string> outputPath;
+        std::optional<std::string> pipelineCachePath;
+        std::optional<std::string> workgroupSizesDir;
+        std::optional<std::string> device;
+        // "all" or comma separated device indices, enables batch mode
+        std::optional<std::string> devices;
+        // --batch, CSV with one "input,ref[,output]" row per pair, replaces --input and --ref
+        std::optional<std::string> batchManifest;
+        // --input-dir and --ref-dir, compares files with the same name in both directories
+        std::optional<std::string> inputDir;
+        std::optional<std::string> refDir;
+        // --serve, Unix domain socket to accept requests on, images come from the requests
+        std::optional<std::string> servePath;
+        // --socket of a running server, only used by IQM-client
+        std::optional<std::string> socketPath;
+        // --inline, IQM-client decodes the images and sends the pixels instead of the paths
+        bool inlinePixels = false;
         std::unordered_map<std::string, std::string> options;
         bool verbose = false;
+        // benchmark workgroup sizes on the device and save the fastest ones, no images are compared
+        bool autotune = false;
+        // --fp16, 16 bit float intermediate images where the device supports them
+        bool halfPrecision = false;
+        // --debug-gpu, validation, debug messages and RenderDoc captures instead of the production profile
+        bool debugGpu = false;
     };
 }
 
@@ -0,0 +1,213 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "autotune.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+
+#if COMPILE_SSIM
+#include <ssim.h>
+#endif
+
+#if COMPILE_FSIM
+#include <fsim.h>
+#endif
+
+#if COMPILE_FLIP
+#include <flip.h>
+#endif
+
+struct TunableKernel {
+    IQM::Method method;
+    const char *name;
+    // reductions over a 1D workgroup, only powers of two work there
+    bool reduction;
+};
+
+// names match the keys the metrics look up with VulkanRuntime::workgroupSize
+static const std::vector<TunableKernel> TUNABLE_KERNELS = {
+    {IQM::Method::SSIM, "ssim", false},
+    {IQM::Method::FLIP, "flip_ycxcz", false},
+    {IQM::Method::FLIP, "flip_feature_filter_horizontal", false},
+    {IQM::Method::FLIP, "flip_feature_detect", false},
+    {IQM::Method::FLIP, "flip_spatial_detect", false},
+    {IQM::Method::FLIP, "flip_error_combine", false},
+    {IQM::Method::FSIM, "fsim_downsample", false},
+    {IQM::Method::FSIM, "fsim_log_gabor", false},
+    {IQM::Method::FSIM, "fsim_filter_combinations", false},
+    {IQM::Method::FSIM, "fsim_phase_congruency", false},
+    {IQM::Method::FSIM, "fsim_final_multiply", false},
+    // SumReduction, shared by all metrics but only FSIM sums on the GPU
+    {IQM::Method::FSIM, "reduce_sum", true},
+};
+
+// covers the sizes the shaders were written for, wide rows for desktop GPUs and large groups for CPU implementations
+static const std::vector<IQM::GPU::WorkgroupSize> CANDIDATES_2D = {
+    {8, 4}, {8, 8}, {16, 8}, {8, 16}, {16, 16}, {32, 4}, {32, 8}, {64, 4}, {32, 16}, {64, 8}, {32, 32},
+};
+
+static const std::vector<IQM::GPU::WorkgroupSize> CANDIDATES_REDUCTION = {
+    {32, 1}, {64, 1}, {128, 1}, {256, 1}, {512, 1}, {1024, 1},
+};
+
+static InputImage syntheticImage(const int size, const unsigned seed) {
+    PixelData pixels(static_cast<size_t>(size) * size * 4);
+
+    // content does not change the amount of work, only keeps the metrics away from degenerate inputs
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = i % 4 == 3 ? 255 : static_cast<unsigned char>(distribution(generator));
+    }
+
+    return InputImage::fromPixels(size, size, std::move(pixels));
+}
+
+using MetricRun = std::function<void(IQM::GPU::FrameSlot &)>;
+
+static MetricRun createRun(const IQM::Method method, const IQM::GPU::VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
+    switch (method) {
+#if COMPILE_SSIM
+        case IQM::Method::SSIM: {
+            auto ssim = std::make_shared<IQM::GPU::SSIM>(runtime);
+            return [&runtime, &image, &ref, ssim](IQM::GPU::FrameSlot &slot) {
+                (void) ssim->computeMetric(runtime, slot, image, ref);
+            };
+        }
+#endif
+#if COMPILE_FSIM
+        case IQM::Method::FSIM: {
+            auto fsim = std::make_shared<IQM::GPU::FSIM>(runtime);
+            return [&runtime, &image, &ref, fsim](IQM::GPU::FrameSlot &slot) {
+                (void) fsim->computeMetric(runtime, slot, image, ref);
+            };
+        }
+#endif
+#if COMPILE_FLIP
+        case IQM::Method::FLIP: {
+            auto flip = std::make_shared<IQM::GPU::FLIP>(runtime);
+            return [&runtime, &image, &ref, flip](IQM::GPU::FrameSlot &slot) {
+                (void) flip->computeMetric(runtime, slot, image, ref, IQM::GPU::FLIPArguments{});
+            };
+        }
+#endif
+        default:
+            throw std::runtime_error("Method " + IQM::method_name(method) + " has no tunable kernels or was not compiled");
+    }
+}
+
+static bool isCompiled(const IQM::Method method) {
+    switch (method) {
+#if COMPILE_SSIM
+        case IQM::Method::SSIM:
+#endif
+#if COMPILE_FSIM
+        case IQM::Method::FSIM:
+#endif
+#if COMPILE_FLIP
+        case IQM::Method::FLIP:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
+IQM::Autotuner::Autotuner(const Args &args, GPU::VulkanRuntime &runtime) :
+    _args(args),
+    _runtime(runtime),
+    _input(syntheticImage(args.options.contains("AUTOTUNE_SIZE") ? std::stoi(args.options.at("AUTOTUNE_SIZE")) : 1024, 1)),
+    _ref(syntheticImage(this->_input.width, 2))
+{
+    if (args.options.contains("AUTOTUNE_RUNS")) {
+        this->_runs = std::max(1ul, std::stoul(args.options.at("AUTOTUNE_RUNS")));
+    }
+}
+
+std::vector<IQM::AutotuneResult> IQM::Autotuner::run() {
+    std::vector<AutotuneResult> results;
+
+    for (const auto &kernel : TUNABLE_KERNELS) {
+        if (this->_args.methodSelected ? kernel.method != this->_args.method : !isCompiled(kernel.method)) {
+            continue;
+        }
+
+        AutotuneResult result{.kernel = kernel.name};
+        std::optional<GPU::WorkgroupSize> best;
+        std::chrono::duration<double, std::milli> bestTime{std::numeric_limits<double>::infinity()};
+
+        for (const auto &candidate : kernel.reduction ? CANDIDATES_REDUCTION : CANDIDATES_2D) {
+            if (!this->_runtime.supportsWorkgroupSize(candidate)) {
+                continue;
+            }
+
+            this->_runtime._workgroupSizes.set(kernel.name, candidate);
+            std::chrono::duration<double, std::milli> time;
+            try {
+                time = this->measure(kernel.method);
+            } catch (const std::exception &e) {
+                // e.g. shared memory or register limits the device limits do not describe
+                if (this->_args.verbose) {
+                    std::cout << kernel.name << " " << candidate.x << "x" << candidate.y << " failed: " << e.what() << std::endl;
+                }
+                continue;
+            }
+
+            if (this->_args.verbose) {
+                std::cout << kernel.name << " " << candidate.x << "x" << candidate.y << ": " << time.count() << " ms" << std::endl;
+            }
+
+            result.candidates++;
+            if (time < bestTime) {
+                best = candidate;
+                bestTime = time;
+            }
+            if (time > result.slowestTime) {
+                result.slowestSize = candidate;
+                result.slowestTime = time;
+            }
+        }
+
+        if (!best.has_value()) {
+            throw std::runtime_error(std::string("no workgroup size of ") + kernel.name + " works on this device");
+        }
+
+        // later kernels are tuned with this one at its best
+        this->_runtime._workgroupSizes.set(kernel.name, best.value());
+        result.size = best.value();
+        result.time = bestTime;
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+std::chrono::duration<double, std::milli> IQM::Autotuner::measure(const Method method) const {
+    const auto run = createRun(method, this->_runtime, this->_input, this->_ref);
+
+    // allocates the images and fills the caches
+    {
+        const auto slot = this->_runtime.acquireSlot();
+        run(*slot);
+    }
+
+    std::chrono::duration<double, std::milli> best{std::numeric_limits<double>::infinity()};
+    for (unsigned i = 0; i < this->_runs; i++) {
+        const auto slot = this->_runtime.acquireSlot();
+        const auto start = std::chrono::high_resolution_clock::now();
+        run(*slot);
+        const auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start));
+    }
+
+    return best;
+}
@@ -0,0 +1,52 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_AUTOTUNE_H
+#define IQM_AUTOTUNE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "input_image.h"
+#include "gpu/base/vulkan_runtime.h"
+
+namespace IQM {
+    struct AutotuneResult {
+        std::string kernel;
+        GPU::WorkgroupSize size;
+        std::chrono::duration<double, std::milli> time{};
+        // spread between the candidates, to tell whether the kernel is sensitive to the size at all
+        GPU::WorkgroupSize slowestSize;
+        std::chrono::duration<double, std::milli> slowestTime{};
+        unsigned candidates = 0;
+    };
+
+    /**
+     * Picks workgroup sizes for the kernels listed in autotune.cpp on the device of the runtime.
+     * Every candidate size supported by the device is benchmarked by running the whole metric on a synthetic
+     * image pair, the fastest one is written into the runtime's table before the next kernel is tuned.
+     * Metrics read the table when they are constructed, so each candidate gets a fresh metric instance.
+     */
+    class Autotuner {
+    public:
+        // AUTOTUNE_SIZE (image side, 1024 by default) and AUTOTUNE_RUNS (5) options are read from args
+        Autotuner(const Args &args, GPU::VulkanRuntime &runtime);
+        std::vector<AutotuneResult> run();
+
+    private:
+        // best wall time of the metric over the configured number of runs, after one warmup run
+        [[nodiscard]] std::chrono::duration<double, std::milli> measure(Method method) const;
+
+        const Args &_args;
+        GPU::VulkanRuntime &_runtime;
+        unsigned _runs = 5;
+        InputImage _input;
+        InputImage _ref;
+    };
+}
+
+#endif //IQM_AUTOTUNE_H
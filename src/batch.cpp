@@ -0,0 +1,377 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "batch.h"
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
+
+#include "gpu/base/vulkan_runtime.h"
+#include "image_io.h"
+#include "metric_worker.h"
+
+/**
+ * One deque per device, the owner takes jobs from the front, thieves from the back.
+ * Jobs are cheap to hand out compared to the work they represent, so a mutex per deque is enough.
+ */
+class WorkStealingQueue {
+public:
+    WorkStealingQueue(const size_t jobCount, const size_t workerCount) : queues(workerCount) {
+        // contiguous chunks, so neighbouring (often similarly sized) pairs end up on the same device
+        for (size_t worker = 0; worker < workerCount; worker++) {
+            const auto start = jobCount * worker / workerCount;
+            const auto end = jobCount * (worker + 1) / workerCount;
+            for (size_t job = start; job < end; job++) {
+                this->queues[worker].jobs.push_back(job);
+            }
+        }
+    }
+
+    std::optional<size_t> next(const size_t worker, bool &stolen) {
+        stolen = false;
+        {
+            auto &own = this->queues[worker];
+            std::lock_guard lock(own.mutex);
+            if (!own.jobs.empty()) {
+                const auto job = own.jobs.front();
+                own.jobs.pop_front();
+                return job;
+            }
+        }
+
+        for (size_t offset = 1; offset < this->queues.size(); offset++) {
+            auto &victim = this->queues[(worker + offset) % this->queues.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                const auto job = victim.jobs.back();
+                victim.jobs.pop_back();
+                stolen = true;
+                return job;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+    std::vector<Queue> queues;
+};
+
+IQM::BatchRunner::BatchRunner(const Args &args, const GPU::VulkanRuntimeConfig &baseConfig, const std::vector<std::optional<std::string>> &devices):
+_args(args),
+_baseConfig(baseConfig),
+_devices(devices)
+{
+    if (this->_devices.empty()) {
+        throw std::runtime_error("Batch processing needs at least one device");
+    }
+}
+
+std::vector<std::optional<std::string>> IQM::BatchRunner::parseDevices(const std::string &selector) {
+    std::vector<std::optional<std::string>> devices;
+
+    if (selector == "all") {
+        const auto count = GPU::VulkanRuntime::enumerateDevices().size();
+        for (unsigned i = 0; i < count; i++) {
+            devices.emplace_back(std::to_string(i));
+        }
+        return devices;
+    }
+
+    std::stringstream stream(selector);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty() || !std::ranges::all_of(item, [](const unsigned char c) { return std::isdigit(c); })) {
+            throw std::runtime_error("Invalid device index '" + item + "'");
+        }
+        devices.emplace_back(item);
+    }
+
+    return devices;
+}
+
+// splits one CSV row, quoted fields may contain commas and "" for a quote
+static std::vector<std::string> splitCsvRow(const std::string &row) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < row.size(); i++) {
+        const char c = row[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < row.size() && row[i + 1] == '"') {
+                fields.back() += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                fields.back() += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+
+    for (auto &field : fields) {
+        const auto first = field.find_first_not_of(" \t");
+        const auto last = field.find_last_not_of(" \t");
+        field = first == std::string::npos ? "" : field.substr(first, last - first + 1);
+    }
+    return fields;
+}
+
+std::vector<IQM::BatchJob> IQM::BatchRunner::parseManifest(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open batch manifest '" + path + "'");
+    }
+
+    const auto base = std::filesystem::path(path).parent_path();
+    const auto resolve = [&base](const std::string &field) {
+        const std::filesystem::path fieldPath(field);
+        return fieldPath.is_absolute() ? fieldPath.string() : (base / fieldPath).string();
+    };
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    size_t lineNumber = 0;
+    bool firstRow = true;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        const auto firstChar = line.find_first_not_of(" \t");
+        if (firstChar == std::string::npos || line[firstChar] == '#') {
+            continue;
+        }
+
+        const auto fields = splitCsvRow(line);
+        if (firstRow && fields.size() >= 2 && fields[0] == "input" && fields[1] == "ref") {
+            firstRow = false;
+            continue;
+        }
+        firstRow = false;
+
+        if (fields.size() < 2 || fields.size() > 3 || fields[0].empty() || fields[1].empty()) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected input,ref[,output]");
+        }
+
+        BatchJob job{
+            .inputPath = resolve(fields[0]),
+            .refPath = resolve(fields[1]),
+        };
+        if (fields.size() == 3 && !fields[2].empty()) {
+            job.outputPath = resolve(fields[2]);
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    if (jobs.empty()) {
+        throw std::runtime_error("Batch manifest '" + path + "' contains no pairs");
+    }
+    return jobs;
+}
+
+// extensions stb_image can decode
+static bool isImageFile(const std::filesystem::directory_entry &entry) {
+    if (!entry.is_regular_file()) {
+        return false;
+    }
+    auto extension = entry.path().extension().string();
+    std::ranges::transform(extension, extension.begin(), [](const unsigned char c) { return std::tolower(c); });
+    static const std::unordered_set<std::string> extensions = {
+        ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm",
+    };
+    return extensions.contains(extension);
+}
+
+static std::vector<std::string> listImageFiles(const std::string &dir) {
+    if (!std::filesystem::is_directory(dir)) {
+        throw std::runtime_error("'" + dir + "' is not a directory");
+    }
+
+    std::vector<std::string> names;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (isImageFile(entry)) {
+            names.push_back(entry.path().filename().string());
+        }
+    }
+    return names;
+}
+
+IQM::BatchDirectoryPairs IQM::BatchRunner::pairDirectories(const std::string &inputDir, const std::string &refDir) {
+    const auto inputNames = listImageFiles(inputDir);
+    const auto refNames = listImageFiles(refDir);
+    // hash lookups keep matching linear in the number of files
+    const std::unordered_set<std::string> refSet(refNames.begin(), refNames.end());
+    const std::unordered_set<std::string> inputSet(inputNames.begin(), inputNames.end());
+
+    struct Pair {
+        std::string name;
+        // headers that cannot be read sort last, loading them reports the error
+        std::pair<int, int> size;
+    };
+    std::vector<Pair> pairs;
+    BatchDirectoryPairs result;
+    for (const auto &name : inputNames) {
+        if (!refSet.contains(name)) {
+            result.onlyInInput.push_back(name);
+            continue;
+        }
+        // only the header is read, the reference gets checked against it when the pair is loaded
+        const auto size = read_image_size((std::filesystem::path(inputDir) / name).string());
+        pairs.push_back(Pair{
+            .name = name,
+            .size = size.value_or(std::pair{std::numeric_limits<int>::max(), std::numeric_limits<int>::max()}),
+        });
+    }
+    for (const auto &name : refNames) {
+        if (!inputSet.contains(name)) {
+            result.onlyInRef.push_back(name);
+        }
+    }
+
+    std::ranges::sort(pairs, [](const Pair &a, const Pair &b) {
+        return std::tie(a.size, a.name) < std::tie(b.size, b.name);
+    });
+    std::ranges::sort(result.onlyInInput);
+    std::ranges::sort(result.onlyInRef);
+
+    for (auto &pair : pairs) {
+        result.jobs.push_back(BatchJob{
+            .inputPath = (std::filesystem::path(inputDir) / pair.name).string(),
+            .refPath = (std::filesystem::path(refDir) / pair.name).string(),
+        });
+        result.names.push_back(std::move(pair.name));
+    }
+    return result;
+}
+
+std::vector<IQM::BatchJobResult> IQM::BatchRunner::run(const std::vector<BatchJob> &jobs, const BatchResultCallback &onResult) {
+    this->_deviceStats = std::vector<BatchDeviceStats>(this->_devices.size());
+
+    std::vector<BatchJobResult> results(jobs.size());
+    for (auto &result : results) {
+        result.error = "no device was able to process this pair";
+    }
+
+    WorkStealingQueue queue(jobs.size(), this->_devices.size());
+    std::mutex callbackMutex;
+
+    std::vector<std::thread> threads;
+    for (size_t worker = 0; worker < this->_devices.size(); worker++) {
+        threads.emplace_back([this, worker, &queue, &jobs, &results, &onResult, &callbackMutex] {
+            auto &stats = this->_deviceStats[worker];
+            auto config = this->_baseConfig;
+            if (this->_devices[worker].has_value()) {
+                config.device = this->_devices[worker];
+            }
+            stats.name = "device " + config.device.value_or("default");
+
+            // separate file per device, otherwise they would keep invalidating each other
+            if (this->_devices.size() > 1 && config.pipelineCachePath.has_value()) {
+                std::filesystem::path path = config.pipelineCachePath.value();
+                path.replace_filename(path.stem().string() + "_" + config.device.value_or("default") + path.extension().string());
+                config.pipelineCachePath = path.string();
+            }
+
+            // metrics are declared after runtime, so they are destroyed before it
+            std::unique_ptr<GPU::VulkanRuntime> runtime;
+            std::vector<std::unique_ptr<MetricWorker>> metrics;
+            try {
+                runtime = std::make_unique<GPU::VulkanRuntime>(config);
+                stats.name = runtime->selectedDevice;
+                // metric instances hold per-pair resources, so every slot in flight needs its own
+                for (unsigned lane = 0; lane < runtime->slotCount(); lane++) {
+                    metrics.push_back(createWorker(this->_args.method, *runtime));
+                }
+            } catch (const std::exception &e) {
+                // remaining jobs of this device get stolen by the others
+                stats.error = e.what();
+                return;
+            }
+
+            // lanes share the device queue, so one can load images and record while another one's work is running
+            std::mutex statsMutex;
+            std::vector<std::thread> lanes;
+            for (auto &metric : metrics) {
+                lanes.emplace_back([&, metric = metric.get()] {
+                    bool stolen = false;
+                    while (const auto job = queue.next(worker, stolen)) {
+                        auto &result = results[job.value()];
+                        const auto start = std::chrono::high_resolution_clock::now();
+
+                        try {
+                            const auto &pair = jobs[job.value()];
+                            const auto input = load_image(pair.inputPath);
+                            const auto reference = load_image(pair.refPath);
+                            if (input.width != reference.width || input.height != reference.height) {
+                                throw std::runtime_error("Compared images must have the same size");
+                            }
+
+                            const auto slot = runtime->acquireSlot();
+                            auto output = metric->compute(*slot, input, reference, this->_args.options);
+                            if (pair.outputPath.has_value()) {
+                                if (output.imageData.empty()) {
+                                    throw std::runtime_error("Method " + method_name(this->_args.method) + " has no output image");
+                                }
+                                save_image(pair.outputPath.value(), output.imageData, output.width, output.height);
+                            }
+                            result.values = std::move(output.values);
+                            result.error.reset();
+                        } catch (const std::exception &e) {
+                            result.error = e.what();
+                        }
+
+                        result.device = worker;
+                        result.time = std::chrono::high_resolution_clock::now() - start;
+
+                        {
+                            std::lock_guard lock(statsMutex);
+                            stats.busyTime += result.time;
+                            stats.completed++;
+                            if (stolen) {
+                                stats.stolen++;
+                            }
+                        }
+
+                        if (onResult) {
+                            std::lock_guard lock(callbackMutex);
+                            onResult(job.value(), result);
+                        }
+                    }
+                });
+            }
+
+            for (auto &lane : lanes) {
+                lane.join();
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    return results;
+}
@@ -0,0 +1,86 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_BATCH_H
+#define IQM_BATCH_H
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "gpu/base/vulkan_runtime_config.h"
+
+namespace IQM {
+    struct BatchJob {
+        std::string inputPath;
+        std::string refPath;
+        // written only by metrics with an output image
+        std::optional<std::string> outputPath = std::nullopt;
+    };
+
+    struct BatchJobResult {
+        // metric name -> value, in the order they should be printed
+        std::vector<std::pair<std::string, double>> values;
+        std::optional<std::string> error;
+        // index into BatchRunner::deviceStats()
+        unsigned device = 0;
+        std::chrono::duration<double, std::milli> time{};
+    };
+
+    struct BatchDirectoryPairs {
+        std::vector<BatchJob> jobs;
+        // file name shared by the input and reference of every job
+        std::vector<std::string> names;
+        // file names without a counterpart in the other directory
+        std::vector<std::string> onlyInInput;
+        std::vector<std::string> onlyInRef;
+    };
+
+    // receives the index of the job and its result as soon as the pair is done
+    using BatchResultCallback = std::function<void(size_t, const BatchJobResult &)>;
+
+    struct BatchDeviceStats {
+        std::string name;
+        size_t completed = 0;
+        // jobs taken from the queue of another device
+        size_t stolen = 0;
+        // time spent processing jobs summed over all frame slots, excluding runtime and metric initialization
+        std::chrono::duration<double> busyTime{};
+        std::optional<std::string> error;
+    };
+
+    /**
+     * Runs one metric over many image pairs, with one VulkanRuntime per device and one metric instance per frame slot.
+     * Jobs are split evenly between devices up front, devices that run out of work steal from the others.
+     */
+    class BatchRunner {
+    public:
+        // each device is selected the same way as VulkanRuntimeConfig::device, nullopt keeps the default selection
+        BatchRunner(const Args &args, const GPU::VulkanRuntimeConfig &baseConfig, const std::vector<std::optional<std::string>> &devices);
+        // onResult is called from the worker threads, but never concurrently
+        std::vector<BatchJobResult> run(const std::vector<BatchJob> &jobs, const BatchResultCallback &onResult = {});
+        [[nodiscard]] const std::vector<BatchDeviceStats> &deviceStats() const { return this->_deviceStats; }
+
+        // parses "all" or a comma separated list of device indices
+        static std::vector<std::optional<std::string>> parseDevices(const std::string &selector);
+        // CSV rows of "input,ref[,output]", relative paths are relative to the manifest,
+        // empty lines, lines starting with # and an "input,ref" header are skipped, fields may be quoted
+        static std::vector<BatchJob> parseManifest(const std::string &path);
+        // pairs image files with the same name, ordered by resolution and then name,
+        // so consecutive pairs on a device reuse the cached images and allocations of the previous one
+        static BatchDirectoryPairs pairDirectories(const std::string &inputDir, const std::string &refDir);
+
+    private:
+        const Args &_args;
+        GPU::VulkanRuntimeConfig _baseConfig;
+        std::vector<std::optional<std::string>> _devices;
+        std::vector<BatchDeviceStats> _deviceStats;
+    };
+}
+
+#endif //IQM_BATCH_H
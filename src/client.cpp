@@ -0,0 +1,57 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include <filesystem>
+#include <iostream>
+
+#include "args.h"
+#include "image_io.h"
+#include "serve_client.h"
+
+// sends one pair to IQM --serve, takes the same arguments as a single pair run of IQM plus --socket
+int main(int argc, const char **argv) {
+    try {
+        const auto args = IQM::Args(argc, argv);
+        if (!args.socketPath.has_value()) {
+            throw std::runtime_error("missing --socket");
+        }
+
+        // the server does not share the working directory of the client
+        const auto source = [&args](const std::string &path) {
+            IQM::Serve::ImageSource image;
+            if (args.inlinePixels) {
+                image.pixels = load_image(path);
+            } else {
+                image.path = std::filesystem::absolute(path).string();
+            }
+            return image;
+        };
+
+        IQM::Serve::Request request{
+            .method = args.method,
+            .input = source(args.inputPath),
+            .ref = source(args.refPath),
+            .options = args.options,
+        };
+        if (args.outputPath.has_value()) {
+            request.outputPath = std::filesystem::absolute(args.outputPath.value()).string();
+        }
+
+        const IQM::ServeClient client(args.socketPath.value());
+        const auto response = client.compute(request);
+        if (response.error.has_value()) {
+            std::cerr << response.error.value() << std::endl;
+            return 1;
+        }
+        for (const auto &[name, value] : response.values) {
+            std::cout << name << ": " << value << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -12,8 +12,12 @@ static bool renderdocActive = false;
 static RENDERDOC_API_1_6_0 *api = nullptr;
 #endif
 
-inline void initRenderDoc() {
+// enabled is VulkanRuntimeConfig::renderDoc, the profiling tool always captures
+inline void initRenderDoc([[maybe_unused]] const bool enabled = true) {
 #ifdef ENABLE_RENDERDOC
+    if (!enabled) {
+        return;
+    }
     if (void *mod = dlopen("librenderdoc.so", RTLD_NOW | RTLD_NOLOAD)) {
         std::cout << "Renderdoc loaded" << std::endl;
         pRENDERDOC_GetAPI RENDERDOC_GetAPI = (pRENDERDOC_GetAPI)(dlsym(mod, "RENDERDOC_GetAPI"));
@@ -0,0 +1,325 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "render_graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "vulkan_runtime.h"
+
+static constexpr auto WRITE_ACCESS =
+    vk::AccessFlagBits::eShaderWrite |
+    vk::AccessFlagBits::eTransferWrite |
+    vk::AccessFlagBits::eHostWrite |
+    vk::AccessFlagBits::eMemoryWrite;
+
+static constexpr auto NO_LEVEL = std::numeric_limits<unsigned>::max();
+
+static IQM::GPU::RenderGraphUsage imageUsage(const std::shared_ptr<IQM::GPU::VulkanImage> &image, const vk::PipelineStageFlags stage, const vk::AccessFlags access) {
+    return IQM::GPU::RenderGraphUsage{.image = image, .stage = stage, .access = access};
+}
+
+static IQM::GPU::RenderGraphUsage bufferUsage(const vk::raii::Buffer &buffer, const vk::PipelineStageFlags stage, const vk::AccessFlags access) {
+    return IQM::GPU::RenderGraphUsage{.buffer = *buffer, .stage = stage, .access = access};
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::read(const std::shared_ptr<VulkanImage> &image) {
+    this->usages.push_back(imageUsage(image, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::write(const std::shared_ptr<VulkanImage> &image) {
+    this->usages.push_back(imageUsage(image, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::readWrite(const std::shared_ptr<VulkanImage> &image) {
+    this->usages.push_back(imageUsage(image, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::read(const vk::raii::Buffer &buffer) {
+    this->usages.push_back(bufferUsage(buffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::write(const vk::raii::Buffer &buffer) {
+    this->usages.push_back(bufferUsage(buffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::readWrite(const vk::raii::Buffer &buffer) {
+    this->usages.push_back(bufferUsage(buffer, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::transferRead(const std::shared_ptr<VulkanImage> &image) {
+    this->usages.push_back(imageUsage(image, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::transferWrite(const std::shared_ptr<VulkanImage> &image) {
+    this->usages.push_back(imageUsage(image, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::transferRead(const vk::raii::Buffer &buffer) {
+    this->usages.push_back(bufferUsage(buffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead));
+    return *this;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraphPass::transferWrite(const vk::raii::Buffer &buffer) {
+    this->usages.push_back(bufferUsage(buffer, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferWrite));
+    return *this;
+}
+
+void IQM::GPU::RenderGraph::reset() {
+    this->_passes.clear();
+    this->_readbacks.clear();
+    this->_stats = RenderGraphStats{};
+    this->_compiled = false;
+
+    // the transient images are kept for the next build
+    this->_transientImages.clear();
+    this->_transients.reset();
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::RenderGraph::createTransientImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo) {
+    if (this->_compiled) {
+        throw std::runtime_error("Transient images must be created before the render graph is compiled");
+    }
+
+    // levels are only known after scheduling, see allocateTransients()
+    auto image = this->_transients.createImage(runtime, imageInfo, 0, 0);
+    this->_transientImages.push_back(image);
+    return image;
+}
+
+IQM::GPU::RenderGraphPass &IQM::GPU::RenderGraph::addPass(const std::string &name, RenderGraphPass::RecordFn record) {
+    if (this->_compiled) {
+        throw std::runtime_error("Passes must be added before the render graph is compiled");
+    }
+
+    // constructor is private, so make_unique is not an option
+    this->_passes.emplace_back(new RenderGraphPass(name, std::move(record)));
+    return *this->_passes.back();
+}
+
+void IQM::GPU::RenderGraph::readback(const vk::raii::Buffer &buffer) {
+    this->_readbacks.push_back(*buffer);
+}
+
+void IQM::GPU::RenderGraph::compile(const VulkanRuntime &runtime) {
+    if (this->_compiled) {
+        throw std::runtime_error("Render graph was already compiled");
+    }
+
+    this->scheduleLevels();
+    this->allocateTransients(runtime);
+    this->_compiled = true;
+}
+
+void IQM::GPU::RenderGraph::scheduleLevels() {
+    // last writer and readers since then, per resource, in program order
+    struct Hazards {
+        const RenderGraphPass *writer = nullptr;
+        std::vector<const RenderGraphPass *> readers;
+    };
+    std::map<const VulkanImage *, Hazards> images;
+    std::map<VkBuffer, Hazards> buffers;
+
+    unsigned levelCount = 0;
+    for (const auto &pass : this->_passes) {
+        unsigned level = 0;
+        const auto after = [&](const RenderGraphPass *dependency) {
+            if (dependency != nullptr && dependency != pass.get()) {
+                level = std::max(level, dependency->level + 1);
+            }
+        };
+
+        for (const auto &usage : pass->usages) {
+            auto &hazards = usage.image ? images[usage.image.get()] : buffers[static_cast<VkBuffer>(usage.buffer)];
+            after(hazards.writer);
+            if (usage.access & WRITE_ACCESS) {
+                for (const auto reader : hazards.readers) {
+                    after(reader);
+                }
+            }
+        }
+
+        // second loop, so that a pass declaring the same resource twice does not depend on itself
+        for (const auto &usage : pass->usages) {
+            auto &hazards = usage.image ? images[usage.image.get()] : buffers[static_cast<VkBuffer>(usage.buffer)];
+            if (usage.access & WRITE_ACCESS) {
+                hazards.writer = pass.get();
+                hazards.readers.clear();
+            } else {
+                hazards.readers.push_back(pass.get());
+            }
+        }
+
+        pass->level = level;
+        levelCount = std::max(levelCount, level + 1);
+    }
+
+    this->_stats.passCount = this->_passes.size();
+    this->_stats.levelCount = levelCount;
+}
+
+void IQM::GPU::RenderGraph::allocateTransients(const VulkanRuntime &runtime) {
+    for (const auto &image : this->_transientImages) {
+        unsigned firstLevel = NO_LEVEL;
+        unsigned lastLevel = 0;
+        for (const auto &pass : this->_passes) {
+            for (const auto &usage : pass->usages) {
+                if (usage.image == image) {
+                    firstLevel = std::min(firstLevel, pass->level);
+                    lastLevel = std::max(lastLevel, pass->level);
+                }
+            }
+        }
+
+        // images never used by any pass do not take part in aliasing, they still get memory for their descriptors
+        if (firstLevel == NO_LEVEL) {
+            firstLevel = 0;
+            lastLevel = NO_LEVEL;
+        }
+        this->_transients.setSteps(image, firstLevel, lastLevel);
+    }
+
+    this->_transients.allocate(runtime);
+    this->_stats.transients = this->_transients.stats();
+}
+
+void IQM::GPU::RenderGraph::execute(const VulkanRuntime &runtime, FrameSlot &slot) {
+    if (!this->_compiled) {
+        throw std::runtime_error("Render graph must be compiled before it is executed");
+    }
+
+    // synchronization state of a single image or buffer
+    struct State {
+        // last write, empty if nothing was written inside the graph
+        vk::PipelineStageFlags writeStages;
+        vk::AccessFlags writeAccess;
+        // stages and accesses the last write is already visible to
+        vk::PipelineStageFlags visibleStages;
+        vk::AccessFlags visibleAccess;
+        // reads since the last write
+        vk::PipelineStageFlags readStages;
+    };
+    std::map<const VulkanImage *, State> images;
+    std::map<VkBuffer, State> buffers;
+
+    // transient images start their first level in GENERAL, see TransientResources::addStepBarriers
+    const auto stateOf = [&](const RenderGraphUsage &usage) -> State & {
+        if (!usage.image) {
+            return buffers[static_cast<VkBuffer>(usage.buffer)];
+        }
+        return images[usage.image.get()];
+    };
+
+    std::vector<std::vector<const RenderGraphPass *>> levels(this->_stats.levelCount);
+    for (const auto &pass : this->_passes) {
+        levels[pass->level].push_back(pass.get());
+    }
+
+    for (unsigned i = 0; i < levels.size(); i++) {
+        const auto &level = levels[i];
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::MemoryBarrier memoryBarrier;
+        std::vector<vk::ImageMemoryBarrier> imageBarriers;
+
+        // layouts of transient images first used here, and waits for the earlier images in their memory
+        this->_transients.addStepBarriers(i, srcStages, dstStages, memoryBarrier, imageBarriers);
+
+        // passes of a level do not depend on each other, so all of them are checked against the state before the level
+        for (const auto pass : level) {
+            for (const auto &usage : pass->usages) {
+                auto &state = stateOf(usage);
+
+                if (usage.access & WRITE_ACCESS) {
+                    // write after write, previous write must finish and be made available
+                    if (state.writeStages) {
+                        srcStages |= state.writeStages;
+                        dstStages |= usage.stage;
+                        memoryBarrier.srcAccessMask |= state.writeAccess;
+                        memoryBarrier.dstAccessMask |= usage.access;
+                    }
+                    // write after read, execution dependency is enough
+                    if (state.readStages) {
+                        srcStages |= state.readStages;
+                        dstStages |= usage.stage;
+                    }
+                } else if (state.writeStages) {
+                    // read after write, skipped if an earlier barrier already made the write visible here
+                    const bool visible = (state.visibleStages & usage.stage) == usage.stage && (state.visibleAccess & usage.access) == usage.access;
+                    if (!visible) {
+                        srcStages |= state.writeStages;
+                        dstStages |= usage.stage;
+                        memoryBarrier.srcAccessMask |= state.writeAccess;
+                        memoryBarrier.dstAccessMask |= usage.access;
+                    }
+                }
+            }
+        }
+
+        if (dstStages) {
+            // only fresh transient images, nothing to wait for
+            if (!srcStages) {
+                srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+            }
+
+            std::vector<vk::MemoryBarrier> memoryBarriers;
+            if (memoryBarrier.srcAccessMask || memoryBarrier.dstAccessMask) {
+                memoryBarriers.push_back(memoryBarrier);
+            }
+
+            slot.cmd->pipelineBarrier(srcStages, dstStages, {}, memoryBarriers, {}, imageBarriers);
+            this->_stats.barrierCount++;
+        }
+
+        for (const auto pass : level) {
+            for (const auto &usage : pass->usages) {
+                auto &state = stateOf(usage);
+                if (usage.access & WRITE_ACCESS) {
+                    state.writeStages = usage.stage;
+                    state.writeAccess = usage.access & WRITE_ACCESS;
+                    state.visibleStages = {};
+                    state.visibleAccess = {};
+                    state.readStages = {};
+                } else {
+                    state.visibleStages |= usage.stage;
+                    state.visibleAccess |= usage.access;
+                    state.readStages |= usage.stage;
+                }
+            }
+        }
+
+        for (const auto pass : level) {
+            runtime.beginGpuTimer(slot, pass->name);
+            pass->record(slot, *slot.cmd);
+            runtime.endGpuTimer(slot);
+        }
+    }
+
+    vk::MemoryBarrier hostBarrier{
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    };
+    vk::PipelineStageFlags srcStages;
+    for (const auto &buffer : this->_readbacks) {
+        const auto &state = buffers[static_cast<VkBuffer>(buffer)];
+        srcStages |= state.writeStages;
+        hostBarrier.srcAccessMask |= state.writeAccess;
+    }
+
+    if (srcStages) {
+        slot.cmd->pipelineBarrier(srcStages, vk::PipelineStageFlagBits::eHost, {}, {hostBarrier}, {}, {});
+        this->_stats.barrierCount++;
+    }
+}
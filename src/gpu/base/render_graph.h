@@ -0,0 +1,129 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "transient_resources.h"
+#include "vulkan_image.h"
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+    struct FrameSlot;
+
+    struct RenderGraphStats {
+        unsigned passCount = 0;
+        // passes in the same level have no hazards between them and are recorded without barriers in between
+        unsigned levelCount = 0;
+        // pipelineBarrier calls, at most one per level plus one for host readback
+        unsigned barrierCount = 0;
+        // transient images, one step per level
+        TransientResourcesStats transients;
+    };
+
+    struct RenderGraphUsage {
+        // exactly one of these is set
+        std::shared_ptr<VulkanImage> image;
+        vk::Buffer buffer = nullptr;
+        vk::PipelineStageFlags stage;
+        vk::AccessFlags access;
+    };
+
+    /**
+     * Single pass of the graph, declares everything its commands touch.
+     * Anything not declared here is not synchronized.
+     */
+    class RenderGraphPass {
+    public:
+        // cmd is the compute command buffer of the slot, the slot is given for PushDescriptorLayout::push
+        using RecordFn = std::function<void(FrameSlot &slot, vk::raii::CommandBuffer &cmd)>;
+
+        // storage image and buffer access from compute shaders
+        RenderGraphPass &read(const std::shared_ptr<VulkanImage> &image);
+        RenderGraphPass &write(const std::shared_ptr<VulkanImage> &image);
+        RenderGraphPass &readWrite(const std::shared_ptr<VulkanImage> &image);
+        RenderGraphPass &read(const vk::raii::Buffer &buffer);
+        RenderGraphPass &write(const vk::raii::Buffer &buffer);
+        RenderGraphPass &readWrite(const vk::raii::Buffer &buffer);
+        // copies
+        RenderGraphPass &transferRead(const std::shared_ptr<VulkanImage> &image);
+        RenderGraphPass &transferWrite(const std::shared_ptr<VulkanImage> &image);
+        RenderGraphPass &transferRead(const vk::raii::Buffer &buffer);
+        RenderGraphPass &transferWrite(const vk::raii::Buffer &buffer);
+
+    private:
+        friend class RenderGraph;
+        RenderGraphPass(std::string name, RecordFn record) : name(std::move(name)), record(std::move(record)) {}
+
+        std::string name;
+        RecordFn record;
+        std::vector<RenderGraphUsage> usages;
+        unsigned level = 0;
+    };
+
+    /**
+     * Records compute passes into a frame slot, inferring barriers from the resources each pass declares.
+     *
+     * Passes are declared in program order, hazards between them (read after write, write after read,
+     * write after write) define the dependencies. Passes are then grouped into levels, every pass lands
+     * in the first level after all of its dependencies, and all barriers needed before a level are
+     * issued as one batch. Passes within a level are recorded back to back, so the GPU can overlap them.
+     *
+     * Images created by createTransientImage() live only within the graph, they are TransientResources
+     * whose steps are the levels, so their memory is bound in compile() and images whose level ranges
+     * do not overlap share the same memory.
+     * All other images are expected to be in GENERAL layout, with any earlier writes already made
+     * available (e.g. by the upload submission the compute queue waits for).
+     *
+     * A graph rebuilt after reset() gets back the transient images it had before, as long as they are
+     * created with the same keys in the same order. If the new passes also give them the same level ranges,
+     * compile() keeps their memory as it was, otherwise all of them are recreated, see TransientResources.
+     */
+    class RenderGraph {
+    public:
+        RenderGraph() = default;
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph &operator=(const RenderGraph &) = delete;
+        RenderGraph(RenderGraph &&) = default;
+        RenderGraph &operator=(RenderGraph &&) = default;
+
+        // drops all passes, the transient images are kept for the next build, the previous work must be finished
+        void reset();
+        // image without memory and view, both are assigned in compile(), unless the image is kept from the previous build
+        [[nodiscard]] std::shared_ptr<VulkanImage> createTransientImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo);
+        // passes are named, the name is used for GPU timers
+        RenderGraphPass &addPass(const std::string &name, RenderGraphPass::RecordFn record);
+        // makes the last write to the buffer visible to the host once the recorded work finishes
+        void readback(const vk::raii::Buffer &buffer);
+
+        // schedules the passes and allocates transient images, must be called before their descriptors are written
+        void compile(const VulkanRuntime &runtime);
+        // records all passes into the already begun slot.cmd
+        void execute(const VulkanRuntime &runtime, FrameSlot &slot);
+
+        [[nodiscard]] const RenderGraphStats &stats() const { return this->_stats; }
+
+    private:
+        void scheduleLevels();
+        void allocateTransients(const VulkanRuntime &runtime);
+
+        std::vector<std::unique_ptr<RenderGraphPass>> _passes;
+        std::vector<std::shared_ptr<VulkanImage>> _transientImages;
+        TransientResources _transients;
+        std::vector<vk::Buffer> _readbacks;
+        RenderGraphStats _stats;
+        bool _compiled = false;
+    };
+}
+
+#endif //RENDER_GRAPH_H
@@ -0,0 +1,350 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "transient_resources.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include "vulkan_runtime.h"
+
+static vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void IQM::GPU::TransientResources::reset() {
+    // declarations that were never allocated have nothing worth keeping
+    if (this->_allocated) {
+        this->_previousResources = std::move(this->_resources);
+        this->_previousMemory = std::move(this->_memory);
+    }
+    this->_resources.clear();
+    this->_memory.clear();
+    this->_stats = TransientResourcesStats{};
+    this->_allocated = false;
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::TransientResources::createImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo, const unsigned firstStep, const unsigned lastStep) {
+    return this->addImage(runtime, Resource{
+        .imageInfo = imageInfo,
+        .firstStep = firstStep,
+        .lastStep = lastStep,
+    });
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::TransientResources::createUploadImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo, const unsigned lastStep) {
+    // the upload is submitted before any step, so only memory of the previous computation could be reused
+    return this->addImage(runtime, Resource{
+        .imageInfo = imageInfo,
+        .firstStep = 0,
+        .lastStep = lastStep,
+        .uploaded = true,
+    });
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::TransientResources::addImage(const VulkanRuntime &runtime, Resource resource) {
+    // kept for recreating the image, the pointers would not outlive the call
+    resource.imageInfo.pNext = nullptr;
+    resource.imageInfo.queueFamilyIndexCount = 0;
+    resource.imageInfo.pQueueFamilyIndices = nullptr;
+
+    if (this->matchesPrevious(resource)) {
+        const auto &previous = this->_previousResources[this->_resources.size()];
+        resource.image = previous.image;
+        resource.requirements = previous.requirements;
+        resource.matchesPrevious = true;
+    } else {
+        resource.image = std::make_shared<VulkanImage>();
+        resource.image->image = vk::raii::Image{runtime._device, resource.imageInfo};
+        resource.requirements = resource.image->image.getMemoryRequirements();
+    }
+
+    auto image = resource.image;
+    this->_resources.push_back(std::move(resource));
+    return image;
+}
+
+vk::raii::Buffer IQM::GPU::TransientResources::createBuffer(const VulkanRuntime &runtime, const vk::DeviceSize size, const vk::BufferUsageFlags usage, const unsigned firstStep, const unsigned lastStep) {
+    vk::BufferCreateInfo bufferCreateInfo{
+        .size = size,
+        .usage = usage,
+    };
+    vk::raii::Buffer buffer{runtime._device, bufferCreateInfo};
+
+    Resource resource{
+        .buffer = buffer,
+        .bufferSize = size,
+        .bufferUsage = usage,
+        .requirements = buffer.getMemoryRequirements(),
+        .firstStep = firstStep,
+        .lastStep = lastStep,
+    };
+    // buffers belong to their users, so a matching one is only bound to the kept memory again
+    resource.matchesPrevious = this->matchesPrevious(resource);
+    this->_resources.push_back(std::move(resource));
+
+    return buffer;
+}
+
+void IQM::GPU::TransientResources::setSteps(const std::shared_ptr<VulkanImage> &image, const unsigned firstStep, const unsigned lastStep) {
+    if (this->_allocated) {
+        throw std::runtime_error("Steps of transient resources must be set before they are allocated");
+    }
+
+    const auto resource = std::ranges::find(this->_resources, image, &Resource::image);
+    if (resource == this->_resources.end()) {
+        throw std::runtime_error("Image is not a transient resource");
+    }
+    resource->firstStep = firstStep;
+    resource->lastStep = lastStep;
+}
+
+bool IQM::GPU::TransientResources::matchesPrevious(const Resource &resource) const {
+    // steps are compared in keepPreviousMemory(), they can still change until allocate()
+    const auto index = this->_resources.size();
+    if (index >= this->_previousResources.size()) {
+        return false;
+    }
+
+    const auto &previous = this->_previousResources[index];
+    if (resource.bufferSize == 0) {
+        return previous.image && previous.uploaded == resource.uploaded && ImageCacheKey::of(previous.imageInfo) == ImageCacheKey::of(resource.imageInfo);
+    }
+    return !previous.image && previous.bufferSize == resource.bufferSize && previous.bufferUsage == resource.bufferUsage;
+}
+
+bool IQM::GPU::TransientResources::keepPreviousMemory() const {
+    if (this->_previousMemory.empty() || this->_resources.size() != this->_previousResources.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < this->_resources.size(); i++) {
+        const auto &resource = this->_resources[i];
+        const auto &previous = this->_previousResources[i];
+        // the same step ranges give the same placement, so the memory layout would come out identical
+        if (!resource.matchesPrevious || resource.firstStep != previous.firstStep || resource.lastStep != previous.lastStep) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void IQM::GPU::TransientResources::allocate(const VulkanRuntime &runtime) {
+    if (this->_allocated) {
+        throw std::runtime_error("Transient resources are already allocated");
+    }
+
+    if (this->keepPreviousMemory()) {
+        // same declarations give the same placement, so everything stays where it was
+        std::vector<vk::BindBufferMemoryInfo> bufferBinds;
+        for (size_t i = 0; i < this->_resources.size(); i++) {
+            auto &resource = this->_resources[i];
+            const auto &previous = this->_previousResources[i];
+            resource.memoryTypeIndex = previous.memoryTypeIndex;
+            resource.memoryIndex = previous.memoryIndex;
+            resource.offset = previous.offset;
+            resource.reusesMemory = previous.reusesMemory;
+            this->_stats.requestedBytes += resource.requirements.size;
+
+            if (resource.image) {
+                runtime._imageCache->record(true);
+            } else {
+                const auto &memory = this->_previousMemory[resource.memoryIndex];
+                bufferBinds.push_back(vk::BindBufferMemoryInfo{
+                    .buffer = resource.buffer,
+                    .memory = memory.memory(),
+                    .memoryOffset = memory.offset() + resource.offset,
+                });
+            }
+        }
+        if (!bufferBinds.empty()) {
+            runtime._device.bindBufferMemory2(bufferBinds);
+        }
+
+        this->_memory = std::move(this->_previousMemory);
+        for (const auto &memory : this->_memory) {
+            this->_stats.allocatedBytes += memory.size();
+        }
+        this->_previousResources.clear();
+        this->_stats.resourceCount = this->_resources.size();
+        this->_stats.reusedCount = this->_resources.size();
+        this->_allocated = true;
+        return;
+    }
+
+    // kept images are bound to the previous memory for good, so with a new placement they have to be created again
+    for (auto &resource : this->_resources) {
+        if (resource.image) {
+            if (resource.matchesPrevious) {
+                resource.image->imageView = VK_NULL_HANDLE;
+                resource.image->image = vk::raii::Image{runtime._device, resource.imageInfo};
+                resource.requirements = resource.image->image.getMemoryRequirements();
+            }
+            runtime._imageCache->record(false);
+        }
+    }
+    this->_previousResources.clear();
+    this->_previousMemory.clear();
+
+    // buffers and images share the memory, so every placement is padded to whole granularity pages
+    const auto granularity = std::max<vk::DeviceSize>(runtime._physicalDevice.getProperties().limits.bufferImageGranularity, 1);
+
+    std::map<uint32_t, std::vector<Resource *>> groups;
+    for (auto &resource : this->_resources) {
+        resource.memoryTypeIndex = runtime._allocator->findMemoryType(resource.requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        groups[resource.memoryTypeIndex].push_back(&resource);
+        this->_stats.requestedBytes += resource.requirements.size;
+    }
+
+    const auto aliveTogether = [](const Resource *a, const Resource *b) {
+        return a->firstStep <= b->lastStep && b->firstStep <= a->lastStep;
+    };
+    const auto rangesOverlap = [granularity](const Resource *a, const Resource *b) {
+        return a->offset < b->offset + alignUp(b->requirements.size, granularity)
+            && b->offset < a->offset + alignUp(a->requirements.size, granularity);
+    };
+
+    for (auto &[memoryTypeIndex, group] : groups) {
+        // largest first, so the big resources determine the layout and small ones fill in the gaps around them
+        std::ranges::stable_sort(group, [](const Resource *a, const Resource *b) {
+            return a->requirements.size > b->requirements.size;
+        });
+
+        std::vector<const Resource *> placed;
+        vk::DeviceSize totalSize = 0;
+        vk::DeviceSize totalAlignment = 1;
+        for (auto *resource : group) {
+            const auto alignment = std::max(resource->requirements.alignment, granularity);
+
+            // move past every conflicting resource until the range is free for the whole lifetime
+            resource->offset = 0;
+            bool moved = true;
+            while (moved) {
+                moved = false;
+                for (const auto *other : placed) {
+                    if (aliveTogether(resource, other) && rangesOverlap(resource, other)) {
+                        resource->offset = alignUp(other->offset + alignUp(other->requirements.size, granularity), alignment);
+                        moved = true;
+                    }
+                }
+            }
+
+            placed.push_back(resource);
+            resource->memoryIndex = this->_memory.size();
+            totalSize = std::max(totalSize, resource->offset + alignUp(resource->requirements.size, granularity));
+            totalAlignment = std::max(totalAlignment, alignment);
+        }
+
+        // the later of two resources sharing memory has to wait for the earlier one
+        for (auto *resource : group) {
+            resource->reusesMemory = std::ranges::any_of(group, [&](const Resource *other) {
+                return other->lastStep < resource->firstStep && rangesOverlap(resource, other);
+            });
+        }
+
+        const vk::MemoryRequirements requirements{
+            .size = totalSize,
+            .alignment = totalAlignment,
+            .memoryTypeBits = 1u << memoryTypeIndex,
+        };
+        auto memory = runtime._allocator->allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal, false);
+
+        std::vector<vk::BindBufferMemoryInfo> bufferBinds;
+        for (const auto *resource : group) {
+            if (resource->image) {
+                resource->image->image.bindMemory(memory.memory(), memory.offset() + resource->offset);
+
+                vk::ImageViewCreateInfo imageViewCreateInfo{
+                    .image = resource->image->image,
+                    .viewType = vk::ImageViewType::e2D,
+                    .format = resource->imageInfo.format,
+                    .subresourceRange = vk::ImageSubresourceRange{
+                        .aspectMask = vk::ImageAspectFlagBits::eColor,
+                        .baseMipLevel = 0,
+                        .levelCount = 1,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1,
+                    }
+                };
+                resource->image->imageView = vk::raii::ImageView{runtime._device, imageViewCreateInfo};
+            } else {
+                bufferBinds.push_back(vk::BindBufferMemoryInfo{
+                    .buffer = resource->buffer,
+                    .memory = memory.memory(),
+                    .memoryOffset = memory.offset() + resource->offset,
+                });
+            }
+        }
+        if (!bufferBinds.empty()) {
+            runtime._device.bindBufferMemory2(bufferBinds);
+        }
+
+        this->_stats.allocatedBytes += totalSize;
+        this->_memory.push_back(std::move(memory));
+    }
+
+    this->_stats.resourceCount = this->_resources.size();
+    this->_allocated = true;
+}
+
+void IQM::GPU::TransientResources::beginStep(const vk::raii::CommandBuffer &cmd, const unsigned step) const {
+    // the step may read anything written by the earlier ones, by shaders or copies
+    vk::PipelineStageFlags srcStages = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+    vk::PipelineStageFlags dstStages = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+    vk::MemoryBarrier memoryBarrier{
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
+    };
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    this->addStepBarriers(step, srcStages, dstStages, memoryBarrier, imageBarriers);
+
+    cmd.pipelineBarrier(srcStages, dstStages, {}, {memoryBarrier}, nullptr, imageBarriers);
+}
+
+void IQM::GPU::TransientResources::addStepBarriers(const unsigned step, vk::PipelineStageFlags &srcStages, vk::PipelineStageFlags &dstStages, vk::MemoryBarrier &memoryBarrier, std::vector<vk::ImageMemoryBarrier> &imageBarriers) const {
+    if (!this->_allocated) {
+        throw std::runtime_error("Transient resources must be allocated before they are used");
+    }
+
+    // the earlier resources could have been used by shaders or copies, and so can be the new ones
+    constexpr auto stages = vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+    constexpr auto writeAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+    constexpr auto access = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+
+    for (const auto &resource : this->_resources) {
+        if (resource.firstStep != step) {
+            continue;
+        }
+
+        if (resource.reusesMemory) {
+            srcStages |= stages;
+            dstStages |= stages;
+        }
+
+        if (resource.image && !resource.uploaded) {
+            // previous contents are discarded, the previous occupant of the memory only has to be done with it
+            dstStages |= stages;
+            imageBarriers.push_back(vk::ImageMemoryBarrier{
+                .srcAccessMask = resource.reusesMemory ? writeAccess : vk::AccessFlags{},
+                .dstAccessMask = access,
+                .oldLayout = vk::ImageLayout::eUndefined,
+                .newLayout = vk::ImageLayout::eGeneral,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image = resource.image->image,
+                .subresourceRange = vk::ImageSubresourceRange {
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                }
+            });
+        } else if (resource.reusesMemory) {
+            memoryBarrier.srcAccessMask |= writeAccess;
+            memoryBarrier.dstAccessMask |= access;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef TRANSIENT_RESOURCES_H
+#define TRANSIENT_RESOURCES_H
+
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vulkan_allocator.h"
+#include "vulkan_image.h"
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+
+    struct TransientResourcesStats {
+        unsigned resourceCount = 0;
+        // memory the resources would take without aliasing
+        vk::DeviceSize requestedBytes = 0;
+        // memory actually allocated for them
+        vk::DeviceSize allocatedBytes = 0;
+        // resources whose placement was kept from before reset(), all or none of them
+        unsigned reusedCount = 0;
+    };
+
+    /**
+     * Device local images and buffers of a metric that runs as a sequence of steps, shared by RenderGraph,
+     * whose steps are the levels it schedules, and by metrics recording their steps by hand.
+     *
+     * Every resource declares the first and the last step it is used in. All of them are created
+     * up front, allocate() then places them into shared memory, resources whose step ranges
+     * do not overlap may be given overlapping memory ranges. Placement goes from the largest resource
+     * down, each one is put at the lowest offset not taken by any resource alive at the same time.
+     *
+     * Images are created in UNDEFINED layout and moved to GENERAL by the barrier of their first step,
+     * the same barrier waits for the earlier resources whose memory the new ones reuse.
+     *
+     * After reset() the same sequence of resources can be declared again. Images declared with the same key
+     * as before are handed back as they were, and if every resource matches including its steps, allocate() keeps
+     * the previous memory and placement, so only the buffers (owned by their users) are bound again.
+     */
+    class TransientResources {
+    public:
+        TransientResources() = default;
+        TransientResources(const TransientResources &) = delete;
+        TransientResources &operator=(const TransientResources &) = delete;
+        TransientResources(TransientResources &&) = default;
+        TransientResources &operator=(TransientResources &&) = default;
+
+        // forgets all declarations, but keeps the resources for the next ones, the previous work must be finished
+        void reset();
+        // image without memory and view, both are assigned in allocate(), unless the image is kept from before reset()
+        [[nodiscard]] std::shared_ptr<VulkanImage> createImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo, unsigned firstStep, unsigned lastStep);
+        // image filled by VulkanRuntime::uploadInputImage before the first step, the upload also sets its layout
+        [[nodiscard]] std::shared_ptr<VulkanImage> createUploadImage(const VulkanRuntime &runtime, const vk::ImageCreateInfo &imageInfo, unsigned lastStep);
+        // buffer without memory, it is bound in allocate()
+        [[nodiscard]] vk::raii::Buffer createBuffer(const VulkanRuntime &runtime, vk::DeviceSize size, vk::BufferUsageFlags usage, unsigned firstStep, unsigned lastStep);
+        // for images created before their steps are known, e.g. by RenderGraph before it schedules its passes
+        void setSteps(const std::shared_ptr<VulkanImage> &image, unsigned firstStep, unsigned lastStep);
+
+        // must be called after all resources are created and before their descriptors are written
+        void allocate(const VulkanRuntime &runtime);
+        // records the barrier every step starts with, it transitions the images first used in the step,
+        // waits for the resources whose memory they reuse and makes all earlier writes visible to the step
+        void beginStep(const vk::raii::CommandBuffer &cmd, unsigned step) const;
+        // adds only the transitions and waits for reused memory to a barrier built by the caller,
+        // for users that synchronize everything else themselves
+        void addStepBarriers(unsigned step, vk::PipelineStageFlags &srcStages, vk::PipelineStageFlags &dstStages, vk::MemoryBarrier &memoryBarrier, std::vector<vk::ImageMemoryBarrier> &imageBarriers) const;
+
+        [[nodiscard]] const TransientResourcesStats &stats() const { return this->_stats; }
+
+    private:
+        struct Resource {
+            // exactly one of these is set
+            std::shared_ptr<VulkanImage> image;
+            vk::Buffer buffer = nullptr;
+            // image info without pointers, or the size and usage of the buffer
+            vk::ImageCreateInfo imageInfo;
+            vk::DeviceSize bufferSize = 0;
+            vk::BufferUsageFlags bufferUsage;
+            vk::MemoryRequirements requirements;
+            unsigned firstStep = 0;
+            unsigned lastStep = 0;
+            uint32_t memoryTypeIndex = 0;
+            // index into _memory
+            size_t memoryIndex = 0;
+            vk::DeviceSize offset = 0;
+            // placed over memory of a resource that was alive before this one
+            bool reusesMemory = false;
+            // layout is set by the upload, see createUploadImage()
+            bool uploaded = false;
+            // declared the same way as the resource at the same position before reset()
+            bool matchesPrevious = false;
+        };
+
+        [[nodiscard]] std::shared_ptr<VulkanImage> addImage(const VulkanRuntime &runtime, Resource resource);
+        [[nodiscard]] bool matchesPrevious(const Resource &resource) const;
+        [[nodiscard]] bool keepPreviousMemory() const;
+
+        std::vector<Resource> _resources;
+        // one allocation per memory type the resources ended up in, almost always just one
+        std::vector<VulkanAllocation> _memory;
+        // state of the declarations before reset()
+        std::vector<Resource> _previousResources;
+        std::vector<VulkanAllocation> _previousMemory;
+        TransientResourcesStats _stats;
+        bool _allocated = false;
+    };
+}
+
+#endif //TRANSIENT_RESOURCES_H
@@ -0,0 +1,289 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_allocator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+static vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+IQM::GPU::VulkanAllocation::VulkanAllocation(VulkanAllocation &&other) noexcept {
+    *this = std::move(other);
+}
+
+IQM::GPU::VulkanAllocation &IQM::GPU::VulkanAllocation::operator=(VulkanAllocation &&other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->_allocator = std::exchange(other._allocator, nullptr);
+        this->_block = std::exchange(other._block, nullptr);
+        this->_offset = std::exchange(other._offset, 0);
+        this->_size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+IQM::GPU::VulkanAllocation::~VulkanAllocation() {
+    this->release();
+}
+
+vk::DeviceMemory IQM::GPU::VulkanAllocation::memory() const {
+    if (this->_block == nullptr) {
+        return nullptr;
+    }
+    return *this->_block->memory;
+}
+
+void *IQM::GPU::VulkanAllocation::map() const {
+    if (this->_block == nullptr || this->_block->mapped == nullptr) {
+        return nullptr;
+    }
+    return static_cast<char *>(this->_block->mapped) + this->_offset;
+}
+
+void IQM::GPU::VulkanAllocation::flush() const {
+    if (this->_block != nullptr && !this->_block->coherent) {
+        this->_allocator->flush(this->_block, this->_offset, this->_size);
+    }
+}
+
+void IQM::GPU::VulkanAllocation::invalidate() const {
+    if (this->_block != nullptr && !this->_block->coherent) {
+        this->_allocator->invalidate(this->_block, this->_offset, this->_size);
+    }
+}
+
+void IQM::GPU::VulkanAllocation::flush(const vk::DeviceSize offset, const vk::DeviceSize size) const {
+    if (this->_block != nullptr && !this->_block->coherent) {
+        this->_allocator->flush(this->_block, this->_offset + offset, std::min(size, this->_size - offset));
+    }
+}
+
+void IQM::GPU::VulkanAllocation::invalidate(const vk::DeviceSize offset, const vk::DeviceSize size) const {
+    if (this->_block != nullptr && !this->_block->coherent) {
+        this->_allocator->invalidate(this->_block, this->_offset + offset, std::min(size, this->_size - offset));
+    }
+}
+
+void IQM::GPU::VulkanAllocation::release() {
+    if (this->_allocator != nullptr) {
+        this->_allocator->release(this->_block, this->_offset, this->_size);
+    }
+    this->_allocator = nullptr;
+    this->_block = nullptr;
+    this->_offset = 0;
+    this->_size = 0;
+}
+
+IQM::GPU::VulkanAllocator::VulkanAllocator(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, const vk::DeviceSize blockSize):
+_device(device),
+_memoryProperties(physicalDevice.getMemoryProperties()),
+_nonCoherentAtomSize(physicalDevice.getProperties().limits.nonCoherentAtomSize),
+_blockSize(blockSize)
+{
+    this->_pools.resize(this->_memoryProperties.memoryTypeCount * 2);
+}
+
+uint32_t IQM::GPU::VulkanAllocator::findMemoryType(uint32_t typeBits, const vk::MemoryPropertyFlags flags) const {
+    for (uint32_t i = 0; i < this->_memoryProperties.memoryTypeCount; i++) {
+        if ((typeBits & 1) && ((this->_memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)) {
+            return i;
+        }
+        typeBits >>= 1;
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
+}
+
+IQM::GPU::VulkanAllocation IQM::GPU::VulkanAllocator::allocate(const vk::MemoryRequirements &requirements, const vk::MemoryPropertyFlags flags, const bool linear) {
+    const auto memoryTypeIndex = this->findMemoryType(requirements.memoryTypeBits, flags);
+    const size_t poolIndex = memoryTypeIndex * 2 + (linear ? 1 : 0);
+    const auto typeFlags = this->_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    const bool coherent = !(typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) || (typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    auto alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+    auto size = requirements.size;
+    // flush and invalidate work on whole atoms, so non-coherent ranges must not share one
+    if (!coherent) {
+        alignment = std::max(alignment, this->_nonCoherentAtomSize);
+        size = alignUp(size, this->_nonCoherentAtomSize);
+    }
+
+    const auto heapSize = this->_memoryProperties.memoryHeaps[this->_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+    // small heaps (BAR windows, some integrated GPUs) would be exhausted by a few full size blocks
+    const auto blockSize = std::min(this->_blockSize, std::max<vk::DeviceSize>(heapSize / 8, 1));
+
+    std::lock_guard lock(this->_mutex);
+
+    VulkanAllocation allocation;
+    allocation._allocator = this;
+    allocation._size = size;
+
+    if (size > blockSize / 2) {
+        auto block = this->createBlock(memoryTypeIndex, poolIndex, size, true);
+        block->used = size;
+        allocation._block = block.get();
+        allocation._offset = 0;
+        this->_dedicated.emplace_back(std::move(block));
+        this->_stats.dedicatedCount++;
+    } else {
+        auto &pool = this->_pools[poolIndex];
+
+        VulkanMemoryBlock *target = nullptr;
+        vk::DeviceSize offset = 0;
+        for (const auto &block : pool) {
+            if (takeRange(*block, size, alignment, offset)) {
+                target = block.get();
+                break;
+            }
+        }
+
+        if (target == nullptr) {
+            pool.emplace_back(this->createBlock(memoryTypeIndex, poolIndex, blockSize, false));
+            target = pool.back().get();
+            this->_stats.blockCount++;
+            if (!takeRange(*target, size, alignment, offset)) {
+                throw std::runtime_error("Failed to suballocate device memory");
+            }
+        }
+
+        allocation._block = target;
+        allocation._offset = offset;
+    }
+
+    this->_stats.allocationCount++;
+    this->_stats.totalAllocations++;
+    this->_stats.bytesUsed += size;
+    this->_stats.peakBytesUsed = std::max(this->_stats.peakBytesUsed, this->_stats.bytesUsed);
+
+    return allocation;
+}
+
+IQM::GPU::VulkanAllocatorStats IQM::GPU::VulkanAllocator::stats() const {
+    std::lock_guard lock(this->_mutex);
+    return this->_stats;
+}
+
+void IQM::GPU::VulkanAllocator::release(VulkanMemoryBlock *block, const vk::DeviceSize offset, const vk::DeviceSize size) {
+    std::lock_guard lock(this->_mutex);
+
+    this->_stats.allocationCount--;
+    this->_stats.bytesUsed -= size;
+
+    if (block->dedicated) {
+        auto it = std::ranges::find_if(this->_dedicated, [block](const auto &b) { return b.get() == block; });
+        this->_stats.bytesReserved -= block->size;
+        this->_stats.dedicatedCount--;
+        this->_dedicated.erase(it);
+        return;
+    }
+
+    block->used -= size;
+
+    // insert the range back and merge it with its neighbours
+    auto [it, _] = block->freeRanges.emplace(offset, size);
+    if (auto next = std::next(it); next != block->freeRanges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        block->freeRanges.erase(next);
+    }
+    if (it != block->freeRanges.begin()) {
+        if (auto prev = std::prev(it); prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            block->freeRanges.erase(it);
+        }
+    }
+
+    if (block->used != 0) {
+        return;
+    }
+
+    // keep one empty block per pool around for reuse, release the rest
+    auto &pool = this->_pools[block->poolIndex];
+    const auto emptyBlocks = std::ranges::count_if(pool, [](const auto &b) { return b->used == 0; });
+    if (emptyBlocks > 1) {
+        auto blockIt = std::ranges::find_if(pool, [block](const auto &b) { return b.get() == block; });
+        this->_stats.bytesReserved -= block->size;
+        this->_stats.blockCount--;
+        pool.erase(blockIt);
+    }
+}
+
+vk::MappedMemoryRange IQM::GPU::VulkanAllocator::atomRange(const VulkanMemoryBlock *block, const vk::DeviceSize offset, const vk::DeviceSize size) const {
+    // non-coherent allocations own whole atoms, so widening never touches another allocation
+    const auto start = offset / this->_nonCoherentAtomSize * this->_nonCoherentAtomSize;
+    const auto end = std::min(alignUp(offset + size, this->_nonCoherentAtomSize), block->size);
+    return vk::MappedMemoryRange{
+        .memory = *block->memory,
+        .offset = start,
+        .size = end - start,
+    };
+}
+
+void IQM::GPU::VulkanAllocator::flush(const VulkanMemoryBlock *block, const vk::DeviceSize offset, const vk::DeviceSize size) const {
+    this->_device.flushMappedMemoryRanges(this->atomRange(block, offset, size));
+}
+
+void IQM::GPU::VulkanAllocator::invalidate(const VulkanMemoryBlock *block, const vk::DeviceSize offset, const vk::DeviceSize size) const {
+    this->_device.invalidateMappedMemoryRanges(this->atomRange(block, offset, size));
+}
+
+std::unique_ptr<IQM::GPU::VulkanMemoryBlock> IQM::GPU::VulkanAllocator::createBlock(const uint32_t memoryTypeIndex, const size_t poolIndex, const vk::DeviceSize size, const bool dedicated) {
+    const auto typeFlags = this->_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+    vk::MemoryAllocateInfo memoryAllocateInfo{
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+
+    auto block = std::make_unique<VulkanMemoryBlock>();
+    block->memory = vk::raii::DeviceMemory{this->_device, memoryAllocateInfo};
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->poolIndex = poolIndex;
+    block->dedicated = dedicated;
+    block->coherent = !(typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) || (typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    if (typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+        block->mapped = block->memory.mapMemory(0, VK_WHOLE_SIZE, {});
+    }
+
+    if (!dedicated) {
+        block->freeRanges.emplace(0, size);
+    }
+
+    this->_stats.deviceAllocations++;
+    this->_stats.bytesReserved += size;
+
+    return block;
+}
+
+bool IQM::GPU::VulkanAllocator::takeRange(VulkanMemoryBlock &block, const vk::DeviceSize size, const vk::DeviceSize alignment, vk::DeviceSize &offset) {
+    // first fit, the lists are short enough for this not to matter
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        const auto [rangeStart, rangeSize] = *it;
+        const auto alignedStart = alignUp(rangeStart, alignment);
+        const auto padding = alignedStart - rangeStart;
+        if (padding + size > rangeSize) {
+            continue;
+        }
+
+        block.freeRanges.erase(it);
+        if (padding > 0) {
+            block.freeRanges.emplace(rangeStart, padding);
+        }
+        if (const auto remaining = rangeSize - padding - size; remaining > 0) {
+            block.freeRanges.emplace(alignedStart + size, remaining);
+        }
+
+        block.used += size;
+        offset = alignedStart;
+        return true;
+    }
+
+    return false;
+}
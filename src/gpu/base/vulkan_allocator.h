@@ -0,0 +1,130 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_ALLOCATOR_H
+#define VULKAN_ALLOCATOR_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace IQM::GPU {
+    class VulkanAllocator;
+    struct VulkanMemoryBlock;
+
+    struct VulkanAllocatorStats {
+        // large blocks shared between suballocations
+        uint64_t blockCount = 0;
+        // allocations too large to fit into a block, backed by their own vkAllocateMemory
+        uint64_t dedicatedCount = 0;
+        // currently live suballocations
+        uint64_t allocationCount = 0;
+        // number of allocate() calls over the lifetime of the allocator
+        uint64_t totalAllocations = 0;
+        // number of vkAllocateMemory calls over the lifetime of the allocator
+        uint64_t deviceAllocations = 0;
+        vk::DeviceSize bytesReserved = 0;
+        vk::DeviceSize bytesUsed = 0;
+        vk::DeviceSize peakBytesUsed = 0;
+    };
+
+    /**
+     * Range of device memory handed out by VulkanAllocator.
+     * The range is returned to the free list of its block when this object is destroyed.
+     */
+    class VulkanAllocation {
+    public:
+        VulkanAllocation() = default;
+        // allows the same `= VK_NULL_HANDLE` member initialization as raii handles
+        VulkanAllocation(std::nullptr_t) {}
+        VulkanAllocation(const VulkanAllocation &) = delete;
+        VulkanAllocation &operator=(const VulkanAllocation &) = delete;
+        VulkanAllocation(VulkanAllocation &&other) noexcept;
+        VulkanAllocation &operator=(VulkanAllocation &&other) noexcept;
+        ~VulkanAllocation();
+
+        [[nodiscard]] vk::DeviceMemory memory() const;
+        [[nodiscard]] vk::DeviceSize offset() const { return this->_offset; }
+        [[nodiscard]] vk::DeviceSize size() const { return this->_size; }
+
+        // blocks of host visible memory stay mapped for their whole lifetime,
+        // so this only offsets the persistent mapping, returns nullptr for device only memory
+        [[nodiscard]] void *map() const;
+        // required only for memory without HOST_COHERENT flag, no-op otherwise
+        void flush() const;
+        void invalidate() const;
+        // only a part of the allocation, offset is relative to it and is widened to whole atoms
+        void flush(vk::DeviceSize offset, vk::DeviceSize size) const;
+        void invalidate(vk::DeviceSize offset, vk::DeviceSize size) const;
+
+    private:
+        friend class VulkanAllocator;
+        void release();
+
+        VulkanAllocator *_allocator = nullptr;
+        VulkanMemoryBlock *_block = nullptr;
+        vk::DeviceSize _offset = 0;
+        vk::DeviceSize _size = 0;
+    };
+
+    struct VulkanMemoryBlock {
+        vk::raii::DeviceMemory memory = VK_NULL_HANDLE;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize used = 0;
+        uint32_t memoryTypeIndex = 0;
+        size_t poolIndex = 0;
+        bool dedicated = false;
+        bool coherent = true;
+        void *mapped = nullptr;
+        // offset -> size, neighbouring ranges are merged when released
+        std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+    };
+
+    /**
+     * Suballocates device memory from large per memory type blocks,
+     * so that metrics creating many small buffers and images do not hit driver allocation limits.
+     *
+     * Linear (buffers) and optimal (images) resources are kept in separate blocks,
+     * which sidesteps bufferImageGranularity requirements altogether.
+     */
+    class VulkanAllocator {
+    public:
+        static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+        VulkanAllocator(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, vk::DeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+        VulkanAllocator(const VulkanAllocator &) = delete;
+        VulkanAllocator &operator=(const VulkanAllocator &) = delete;
+
+        [[nodiscard]] VulkanAllocation allocate(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags flags, bool linear);
+        [[nodiscard]] uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags flags) const;
+        [[nodiscard]] VulkanAllocatorStats stats() const;
+
+    private:
+        friend class VulkanAllocation;
+        void release(VulkanMemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size);
+        void flush(const VulkanMemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size) const;
+        void invalidate(const VulkanMemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size) const;
+        [[nodiscard]] vk::MappedMemoryRange atomRange(const VulkanMemoryBlock *block, vk::DeviceSize offset, vk::DeviceSize size) const;
+        std::unique_ptr<VulkanMemoryBlock> createBlock(uint32_t memoryTypeIndex, size_t poolIndex, vk::DeviceSize size, bool dedicated);
+        static bool takeRange(VulkanMemoryBlock &block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset);
+
+        const vk::raii::Device &_device;
+        vk::PhysicalDeviceMemoryProperties _memoryProperties;
+        vk::DeviceSize _nonCoherentAtomSize;
+        vk::DeviceSize _blockSize;
+
+        // pools are indexed by memory type, twice - once for linear and once for optimal resources
+        std::vector<std::vector<std::unique_ptr<VulkanMemoryBlock>>> _pools;
+        std::vector<std::unique_ptr<VulkanMemoryBlock>> _dedicated;
+        VulkanAllocatorStats _stats;
+        mutable std::mutex _mutex;
+    };
+}
+
+#endif //VULKAN_ALLOCATOR_H
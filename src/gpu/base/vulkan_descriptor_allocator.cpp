@@ -0,0 +1,149 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_descriptor_allocator.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+// all metrics use only storage images and buffers, some sets bind a handful of each
+static constexpr uint32_t IMAGES_PER_SET = 4;
+static constexpr uint32_t BUFFERS_PER_SET = 4;
+
+// returns nothing if the pool does not have enough space left
+static std::optional<vk::raii::DescriptorSets> tryAllocate(const vk::raii::Device &device, const vk::raii::DescriptorPool &pool, const std::vector<vk::DescriptorSetLayout> &layouts) {
+    const vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
+        .descriptorPool = pool,
+        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
+        .pSetLayouts = layouts.data()
+    };
+
+    try {
+        return vk::raii::DescriptorSets{device, descriptorSetAllocateInfo};
+    } catch (const vk::OutOfPoolMemoryError &) {
+        return std::nullopt;
+    } catch (const vk::FragmentedPoolError &) {
+        return std::nullopt;
+    }
+}
+
+IQM::GPU::VulkanDescriptorAllocator::VulkanDescriptorAllocator(const vk::raii::Device &device, const uint32_t setsPerPool):
+_device(device),
+_setsPerPool(std::max(setsPerPool, 1u))
+{}
+
+vk::raii::DescriptorPool IQM::GPU::VulkanDescriptorAllocator::createPool(const uint32_t sets, const bool freeable) const {
+    std::vector poolSizes = {
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage, .descriptorCount = IMAGES_PER_SET * sets},
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = BUFFERS_PER_SET * sets}
+    };
+
+    vk::DescriptorPoolCreateInfo dsCreateInfo{
+        .flags = freeable ? vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet : vk::DescriptorPoolCreateFlags{},
+        .maxSets = sets,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data()
+    };
+
+    return vk::raii::DescriptorPool{this->_device, dsCreateInfo};
+}
+
+uint32_t IQM::GPU::VulkanDescriptorAllocator::nextPoolSize(const std::vector<vk::raii::DescriptorPool> &pools, const size_t requiredSets) const {
+    // every new pool is twice the size of the previous one, so long chains are not needed
+    auto size = this->_setsPerPool;
+    for (size_t i = 0; i < pools.size() && size < MAX_SETS_PER_POOL; i++) {
+        size *= 2;
+    }
+    return std::max(std::min(size, MAX_SETS_PER_POOL), static_cast<uint32_t>(requiredSets));
+}
+
+std::vector<vk::raii::DescriptorSet> IQM::GPU::VulkanDescriptorAllocator::allocate(const std::vector<vk::DescriptorSetLayout> &layouts) {
+    std::lock_guard lock(this->_mutex);
+
+    std::optional<vk::raii::DescriptorSets> sets;
+    // older pools may have space again after their sets were freed
+    for (auto it = this->_pools.rbegin(); it != this->_pools.rend() && !sets.has_value(); ++it) {
+        sets = tryAllocate(this->_device, *it, layouts);
+    }
+
+    if (!sets.has_value()) {
+        if (!this->_pools.empty()) {
+            this->_stats.poolGrowths++;
+        }
+        this->_pools.push_back(this->createPool(this->nextPoolSize(this->_pools, layouts.size()), true));
+        this->_stats.poolCount++;
+
+        sets = tryAllocate(this->_device, this->_pools.back(), layouts);
+        if (!sets.has_value()) {
+            throw std::runtime_error("Descriptor sets do not fit into an empty descriptor pool");
+        }
+    }
+
+    this->_stats.totalSets += layouts.size();
+
+    std::vector<vk::raii::DescriptorSet> result;
+    result.reserve(sets->size());
+    for (auto &set : sets.value()) {
+        result.push_back(std::move(set));
+    }
+    return result;
+}
+
+std::vector<vk::DescriptorSet> IQM::GPU::VulkanDescriptorAllocator::allocateTransient(const std::vector<vk::DescriptorSetLayout> &layouts) {
+    std::lock_guard lock(this->_mutex);
+
+    std::optional<vk::raii::DescriptorSets> sets;
+    while (this->_transientCurrent < this->_transientPools.size()) {
+        sets = tryAllocate(this->_device, this->_transientPools[this->_transientCurrent], layouts);
+        if (sets.has_value()) {
+            break;
+        }
+        // transient pools are never freed into, so an exhausted one stays exhausted until reset
+        this->_transientCurrent++;
+    }
+
+    if (!sets.has_value()) {
+        if (!this->_transientPools.empty()) {
+            this->_stats.poolGrowths++;
+        }
+        this->_transientPools.push_back(this->createPool(this->nextPoolSize(this->_transientPools, layouts.size()), false));
+        this->_stats.transientPoolCount++;
+        this->_transientCurrent = this->_transientPools.size() - 1;
+
+        sets = tryAllocate(this->_device, this->_transientPools.back(), layouts);
+        if (!sets.has_value()) {
+            throw std::runtime_error("Descriptor sets do not fit into an empty descriptor pool");
+        }
+    }
+
+    this->_stats.totalSets += layouts.size();
+    this->_stats.transientSets += layouts.size();
+    this->_stats.peakTransientSets = std::max(this->_stats.peakTransientSets, this->_stats.transientSets);
+
+    // the pool is reset as a whole, individual sets must never be freed
+    std::vector<vk::DescriptorSet> result;
+    result.reserve(sets->size());
+    for (auto &set : sets.value()) {
+        result.push_back(set.release());
+    }
+    return result;
+}
+
+void IQM::GPU::VulkanDescriptorAllocator::reset() {
+    std::lock_guard lock(this->_mutex);
+
+    for (auto &pool : this->_transientPools) {
+        pool.reset();
+    }
+    this->_transientCurrent = 0;
+    this->_stats.transientSets = 0;
+    this->_stats.resetCount++;
+}
+
+IQM::GPU::VulkanDescriptorAllocatorStats IQM::GPU::VulkanDescriptorAllocator::stats() const {
+    std::lock_guard lock(this->_mutex);
+    return this->_stats;
+}
@@ -0,0 +1,85 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_DESCRIPTOR_ALLOCATOR_H
+#define VULKAN_DESCRIPTOR_ALLOCATOR_H
+
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace IQM::GPU {
+    struct VulkanDescriptorAllocatorStats {
+        // pools for sets freed one by one
+        uint64_t poolCount = 0;
+        // pools for transient sets, freed all at once by reset()
+        uint64_t transientPoolCount = 0;
+        // number of sets allocated over the lifetime of the allocator
+        uint64_t totalSets = 0;
+        // transient sets allocated since the last reset
+        uint64_t transientSets = 0;
+        uint64_t peakTransientSets = 0;
+        // times an allocation did not fit into any existing pool and a new one was chained
+        uint64_t poolGrowths = 0;
+        uint64_t resetCount = 0;
+
+        // sums the stats of allocators used side by side, so the peaks add up as well
+        VulkanDescriptorAllocatorStats &operator+=(const VulkanDescriptorAllocatorStats &other) {
+            this->poolCount += other.poolCount;
+            this->transientPoolCount += other.transientPoolCount;
+            this->totalSets += other.totalSets;
+            this->transientSets += other.transientSets;
+            this->peakTransientSets += other.peakTransientSets;
+            this->poolGrowths += other.poolGrowths;
+            this->resetCount += other.resetCount;
+            return *this;
+        }
+    };
+
+    /**
+     * Allocates descriptor sets from a chain of pools, a new and larger pool is added
+     * whenever the existing ones are exhausted, so any number of metric instances can be created.
+     *
+     * Sets from allocate() are freed back to their pool when destroyed. Sets from allocateTransient()
+     * come from separate pools that are only ever reset as a whole, which is the cheap path
+     * for sets that live for a single frame.
+     */
+    class VulkanDescriptorAllocator {
+    public:
+        static constexpr uint32_t DEFAULT_SETS_PER_POOL = 64;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        explicit VulkanDescriptorAllocator(const vk::raii::Device &device, uint32_t setsPerPool = DEFAULT_SETS_PER_POOL);
+        VulkanDescriptorAllocator(const VulkanDescriptorAllocator &) = delete;
+        VulkanDescriptorAllocator &operator=(const VulkanDescriptorAllocator &) = delete;
+
+        // one set per layout
+        [[nodiscard]] std::vector<vk::raii::DescriptorSet> allocate(const std::vector<vk::DescriptorSetLayout> &layouts);
+        // valid only until the next reset()
+        [[nodiscard]] std::vector<vk::DescriptorSet> allocateTransient(const std::vector<vk::DescriptorSetLayout> &layouts);
+        // invalidates all transient sets, their previous users must have finished on the GPU
+        void reset();
+
+        [[nodiscard]] VulkanDescriptorAllocatorStats stats() const;
+
+    private:
+        [[nodiscard]] vk::raii::DescriptorPool createPool(uint32_t sets, bool freeable) const;
+        [[nodiscard]] uint32_t nextPoolSize(const std::vector<vk::raii::DescriptorPool> &pools, size_t requiredSets) const;
+
+        const vk::raii::Device &_device;
+        uint32_t _setsPerPool;
+        // newest last, allocations try the newest pool first
+        std::vector<vk::raii::DescriptorPool> _pools;
+        std::vector<vk::raii::DescriptorPool> _transientPools;
+        // first transient pool that may still have free space, pools before it were exhausted since the last reset
+        size_t _transientCurrent = 0;
+        VulkanDescriptorAllocatorStats _stats;
+        mutable std::mutex _mutex;
+    };
+}
+
+#endif //VULKAN_DESCRIPTOR_ALLOCATOR_H
@@ -9,13 +9,17 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include "vulkan_allocator.h"
+
 namespace IQM::GPU {
 
 class VulkanImage {
 public:
-    vk::raii::DeviceMemory memory = VK_NULL_HANDLE;
+    VulkanAllocation memory = VK_NULL_HANDLE;
     vk::raii::Image image = VK_NULL_HANDLE;
     vk::raii::ImageView imageView = VK_NULL_HANDLE;
+    // host written images start in PREINITIALIZED, cleared once a transition to GENERAL is recorded
+    bool preinitialized = false;
 };
 
 }
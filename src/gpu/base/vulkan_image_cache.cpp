@@ -0,0 +1,77 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_image_cache.h"
+
+#include <algorithm>
+
+#include "vulkan_runtime.h"
+
+IQM::GPU::VulkanImageCache::VulkanImageCache(const VulkanRuntime &runtime) : _runtime(runtime) {}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::VulkanImageCache::acquire(const vk::ImageCreateInfo &imageInfo, const vk::MemoryPropertyFlags memoryFlags) {
+    const auto key = ImageCacheKey::of(imageInfo, memoryFlags);
+
+    std::lock_guard lock(this->_mutex);
+    this->_useCounter++;
+
+    for (auto &entry : this->_entries) {
+        // nobody else holds the image, and nobody can get it without going through the cache
+        if (entry.key == key && entry.image.use_count() == 1) {
+            entry.lastUse = this->_useCounter;
+            this->_stats.hits++;
+            return entry.image;
+        }
+    }
+
+    auto image = std::make_shared<VulkanImage>(this->_runtime.createImage(imageInfo, memoryFlags));
+    this->_entries.push_back(Entry{
+        .key = key,
+        .image = image,
+        .lastUse = this->_useCounter,
+    });
+    this->_stats.misses++;
+
+    this->evictIdle();
+    this->_stats.cachedImages = this->_entries.size();
+
+    return image;
+}
+
+void IQM::GPU::VulkanImageCache::record(const bool hit) {
+    std::lock_guard lock(this->_mutex);
+    if (hit) {
+        this->_stats.hits++;
+    } else {
+        this->_stats.misses++;
+    }
+}
+
+void IQM::GPU::VulkanImageCache::evictIdle() {
+    std::vector<Entry *> idle;
+    for (auto &entry : this->_entries) {
+        if (entry.image.use_count() == 1) {
+            idle.push_back(&entry);
+        }
+    }
+    if (idle.size() <= MAX_IDLE_IMAGES) {
+        return;
+    }
+
+    std::ranges::sort(idle, [](const Entry *a, const Entry *b) {
+        return a->lastUse < b->lastUse;
+    });
+    const auto evictBefore = idle[idle.size() - MAX_IDLE_IMAGES]->lastUse;
+
+    const auto removed = std::erase_if(this->_entries, [evictBefore](const Entry &entry) {
+        return entry.image.use_count() == 1 && entry.lastUse < evictBefore;
+    });
+    this->_stats.evictions += removed;
+}
+
+IQM::GPU::VulkanImageCacheStats IQM::GPU::VulkanImageCache::stats() const {
+    std::lock_guard lock(this->_mutex);
+    return this->_stats;
+}
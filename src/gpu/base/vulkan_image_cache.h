@@ -0,0 +1,89 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_IMAGE_CACHE_H
+#define VULKAN_IMAGE_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vulkan_image.h"
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+
+    // images with equal keys are interchangeable for the metrics, they are all 2D, single mip and layer
+    struct ImageCacheKey {
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent3D extent;
+        vk::ImageUsageFlags usage;
+        vk::ImageTiling tiling = vk::ImageTiling::eOptimal;
+        vk::MemoryPropertyFlags memoryFlags;
+
+        static ImageCacheKey of(const vk::ImageCreateInfo &imageInfo, const vk::MemoryPropertyFlags memoryFlags = vk::MemoryPropertyFlagBits::eDeviceLocal) {
+            return ImageCacheKey{.format = imageInfo.format, .extent = imageInfo.extent, .usage = imageInfo.usage, .tiling = imageInfo.tiling, .memoryFlags = memoryFlags};
+        }
+        bool operator==(const ImageCacheKey &other) const = default;
+    };
+
+    struct VulkanImageCacheStats {
+        // lookups served by an image created earlier, including images kept by RenderGraph and TransientResources
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // images currently owned by the cache, whether in use or not
+        uint64_t cachedImages = 0;
+        uint64_t evictions = 0;
+
+        [[nodiscard]] double hitRate() const {
+            const auto lookups = this->hits + this->misses;
+            return lookups == 0 ? 0.0 : static_cast<double>(this->hits) / static_cast<double>(lookups);
+        }
+    };
+
+    /**
+     * Keeps images with their own memory after their users are done with them,
+     * so repeated runs on inputs of the same resolution do not create new images and views every time.
+     *
+     * An image is in use while anyone besides the cache holds it. Users drop their images only after
+     * waiting for the slot they were used in, so an image that is not in use is idle on the GPU as well.
+     */
+    class VulkanImageCache {
+    public:
+        // idle images over this count are destroyed, least recently used first
+        static constexpr size_t MAX_IDLE_IMAGES = 16;
+
+        explicit VulkanImageCache(const VulkanRuntime &runtime);
+        VulkanImageCache(const VulkanImageCache &) = delete;
+        VulkanImageCache &operator=(const VulkanImageCache &) = delete;
+
+        // idle image with the same key or a new one, the contents and layout of a reused image are undefined
+        [[nodiscard]] std::shared_ptr<VulkanImage> acquire(const vk::ImageCreateInfo &imageInfo, vk::MemoryPropertyFlags memoryFlags = vk::MemoryPropertyFlagBits::eDeviceLocal);
+        // counts a lookup done by a user keeping its own images, see RenderGraph and TransientResources
+        void record(bool hit);
+
+        [[nodiscard]] VulkanImageCacheStats stats() const;
+
+    private:
+        struct Entry {
+            ImageCacheKey key;
+            std::shared_ptr<VulkanImage> image;
+            uint64_t lastUse = 0;
+        };
+
+        void evictIdle();
+
+        const VulkanRuntime &_runtime;
+        std::vector<Entry> _entries;
+        uint64_t _useCounter = 0;
+        VulkanImageCacheStats _stats;
+        mutable std::mutex _mutex;
+    };
+}
+
+#endif //VULKAN_IMAGE_CACHE_H
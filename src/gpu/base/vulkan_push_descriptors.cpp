@@ -0,0 +1,110 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_push_descriptors.h"
+
+#include <numeric>
+#include <stdexcept>
+
+#include "vulkan_runtime.h"
+
+IQM::GPU::PushDescriptor IQM::GPU::PushDescriptor::storageImage(const std::shared_ptr<VulkanImage> &image) {
+    PushDescriptor descriptor{};
+    descriptor.image = VkDescriptorImageInfo{
+        .sampler = VK_NULL_HANDLE,
+        .imageView = static_cast<VkImageView>(*image->imageView),
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    };
+    return descriptor;
+}
+
+IQM::GPU::PushDescriptor IQM::GPU::PushDescriptor::storageBuffer(const vk::raii::Buffer &buffer, const vk::DeviceSize offset, const vk::DeviceSize range) {
+    PushDescriptor descriptor{};
+    descriptor.buffer = VkDescriptorBufferInfo{
+        .buffer = static_cast<VkBuffer>(*buffer),
+        .offset = offset,
+        .range = range,
+    };
+    return descriptor;
+}
+
+std::vector<IQM::GPU::PushDescriptor> IQM::GPU::storageImages(const std::vector<std::shared_ptr<VulkanImage>> &images) {
+    std::vector<PushDescriptor> descriptors;
+    descriptors.reserve(images.size());
+    for (const auto &image : images) {
+        descriptors.push_back(PushDescriptor::storageImage(image));
+    }
+    return descriptors;
+}
+
+IQM::GPU::PushDescriptorLayout::PushDescriptorLayout(const VulkanRuntime &runtime, const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub, const std::vector<vk::PushConstantRange> &ranges) {
+    this->_descriptorCount = std::accumulate(stub.begin(), stub.end(), size_t{0}, [](const size_t sum, const auto &binding) {
+        return sum + binding.second;
+    });
+    // sets over the device limit can still go through the template path
+    this->_push = runtime._pushDescriptors && this->_descriptorCount <= runtime._maxPushDescriptors;
+
+    this->_setLayout = runtime.createDescLayout(stub, this->_push);
+
+    const std::vector setLayouts = {
+        *this->_setLayout,
+    };
+    this->_pipelineLayout = runtime.createPipelineLayout(setLayouts, ranges);
+
+    // descriptors are passed as a flat array of PushDescriptor, bindings follow each other
+    std::vector<vk::DescriptorUpdateTemplateEntry> entries(stub.size());
+    size_t offset = 0;
+    for (unsigned i = 0; i < stub.size(); i++) {
+        const auto &[descType, count] = stub[i];
+        entries[i] = vk::DescriptorUpdateTemplateEntry{
+            .dstBinding = i,
+            .dstArrayElement = 0,
+            .descriptorCount = count,
+            .descriptorType = descType,
+            .offset = offset * sizeof(PushDescriptor),
+            .stride = sizeof(PushDescriptor),
+        };
+        offset += count;
+    }
+
+    const vk::DescriptorUpdateTemplateCreateInfo templateInfo{
+        .descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size()),
+        .pDescriptorUpdateEntries = entries.data(),
+        .templateType = this->_push ? vk::DescriptorUpdateTemplateType::ePushDescriptorsKHR : vk::DescriptorUpdateTemplateType::eDescriptorSet,
+        .descriptorSetLayout = this->_setLayout,
+        .pipelineBindPoint = vk::PipelineBindPoint::eCompute,
+        .pipelineLayout = this->_pipelineLayout,
+        .set = 0,
+    };
+    this->_template = vk::raii::DescriptorUpdateTemplate{runtime._device, templateInfo};
+}
+
+void IQM::GPU::PushDescriptorLayout::push(FrameSlot &slot, const std::vector<PushDescriptor> &descriptors) const {
+    if (descriptors.size() != this->_descriptorCount) {
+        throw std::runtime_error("Pushed descriptors do not match the descriptor set layout");
+    }
+
+    const auto &cmd = *slot.cmd;
+    if (this->_push) {
+        cmd.getDispatcher()->vkCmdPushDescriptorSetWithTemplateKHR(
+            static_cast<VkCommandBuffer>(*cmd),
+            static_cast<VkDescriptorUpdateTemplate>(*this->_template),
+            static_cast<VkPipelineLayout>(*this->_pipelineLayout),
+            0,
+            descriptors.data()
+        );
+        return;
+    }
+
+    // valid until the slot is acquired again, by then the GPU is done with it
+    const auto set = slot.descriptors->allocateTransient({*this->_setLayout}).front();
+    this->_template.getDispatcher()->vkUpdateDescriptorSetWithTemplate(
+        static_cast<VkDevice>(this->_template.getDevice()),
+        static_cast<VkDescriptorSet>(set),
+        static_cast<VkDescriptorUpdateTemplate>(*this->_template),
+        descriptors.data()
+    );
+    cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->_pipelineLayout, 0, {set}, {});
+}
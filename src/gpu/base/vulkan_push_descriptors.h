@@ -0,0 +1,64 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_PUSH_DESCRIPTORS_H
+#define VULKAN_PUSH_DESCRIPTORS_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vulkan_image.h"
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+    struct FrameSlot;
+
+    // single descriptor passed to PushDescriptorLayout::push, laid out as the update template expects it
+    struct PushDescriptor {
+        union {
+            VkDescriptorImageInfo image;
+            VkDescriptorBufferInfo buffer;
+        };
+
+        static PushDescriptor storageImage(const std::shared_ptr<VulkanImage> &image);
+        static PushDescriptor storageBuffer(const vk::raii::Buffer &buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+    };
+
+    // one descriptor per image, in the order of the images
+    std::vector<PushDescriptor> storageImages(const std::vector<std::shared_ptr<VulkanImage>> &images);
+
+    /**
+     * Pipeline layout with a single descriptor set, whose descriptors are given with every dispatch
+     * instead of being written into a set owned by the metric.
+     *
+     * With VK_KHR_push_descriptor they are recorded straight into the command buffer.
+     * Otherwise a transient set is taken from the frame slot, filled through a descriptor update template
+     * and bound, the slot releases it once it is acquired again.
+     */
+    class PushDescriptorLayout {
+    public:
+        PushDescriptorLayout() = default;
+        PushDescriptorLayout(const VulkanRuntime &runtime, const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub, const std::vector<vk::PushConstantRange> &ranges);
+
+        [[nodiscard]] const vk::raii::PipelineLayout &pipelineLayout() const { return this->_pipelineLayout; }
+        [[nodiscard]] bool usesPushDescriptors() const { return this->_push; }
+        // binds the descriptors as set 0 for the following dispatches recorded into slot.cmd,
+        // they go in binding order and an array binding takes one descriptor per element
+        void push(FrameSlot &slot, const std::vector<PushDescriptor> &descriptors) const;
+
+    private:
+        vk::raii::DescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+        vk::raii::PipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+        vk::raii::DescriptorUpdateTemplate _template = VK_NULL_HANDLE;
+        size_t _descriptorCount = 0;
+        bool _push = false;
+    };
+}
+
+#endif //VULKAN_PUSH_DESCRIPTORS_H
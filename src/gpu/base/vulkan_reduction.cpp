@@ -0,0 +1,120 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_reduction.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static uint32_t srcSubgroup[] =
+#include <base/reduce_sum_subgroup.inc>
+;
+
+static uint32_t srcShared[] =
+#include <base/reduce_sum_shared.inc>
+;
+
+struct SumPushConstants {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t outIndex;
+};
+
+IQM::GPU::SumReduction::SumReduction(const VulkanRuntime &runtime, const uint32_t maxSums) : _maxSums(maxSums) {
+    if (runtime._subgroupArithmetic) {
+        this->_kernel = runtime.createShaderModule(srcSubgroup, sizeof(srcSubgroup));
+    } else {
+        this->_kernel = runtime.createShaderModule(srcShared, sizeof(srcShared));
+    }
+
+    this->_layout = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageBuffer, 1},
+        {vk::DescriptorType::eStorageBuffer, 1},
+    }, VulkanRuntime::createPushConstantRange(sizeof(SumPushConstants))};
+
+    this->_workgroupSize = runtime.workgroupSize("reduce_sum", {256, 1});
+    for (const bool square : {false, true}) {
+        auto constants = this->_workgroupSize.constants();
+        constants.add(square);
+        const auto info = constants.info();
+        (square ? this->_squarePipeline : this->_pipeline) = runtime.createComputePipeline(this->_kernel, this->_layout.pipelineLayout(), &info);
+    }
+
+    auto [buf, mem] = runtime.createBuffer(
+        maxSums * MAX_PARTIALS * sizeof(float),
+        vk::BufferUsageFlagBits::eStorageBuffer,
+        vk::MemoryPropertyFlagBits::eDeviceLocal
+    );
+    this->_partials = std::move(buf);
+    this->_partialsMemory = std::move(mem);
+}
+
+void IQM::GPU::SumReduction::record(FrameSlot &slot, const std::vector<SumRequest> &sums, const bool square) const {
+    if (sums.size() > this->_maxSums) {
+        throw std::runtime_error("SumReduction was created for " + std::to_string(this->_maxSums) + " sums, " + std::to_string(sums.size()) + " requested");
+    }
+
+    // partial sums of previous record() calls may still be read
+    const vk::MemoryBarrier reuseBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderRead,
+        .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
+    };
+    slot.cmd->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {reuseBarrier}, {}, {});
+
+    std::vector<uint32_t> groups(sums.size());
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, square ? this->_squarePipeline : this->_pipeline);
+    for (size_t i = 0; i < sums.size(); i++) {
+        const auto &sum = sums[i];
+        groups[i] = std::clamp((sum.count + this->_workgroupSize.x - 1) / this->_workgroupSize.x, 1u, MAX_PARTIALS);
+
+        this->_layout.push(slot, {
+            PushDescriptor::storageBuffer(*sum.input),
+            PushDescriptor::storageBuffer(this->_partials),
+        });
+        slot.cmd->pushConstants<SumPushConstants>(this->_layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, SumPushConstants{
+            .offset = sum.offset,
+            .size = sum.count,
+            .outIndex = static_cast<uint32_t>(i) * MAX_PARTIALS,
+        });
+        slot.cmd->dispatch(groups[i], 1, 1);
+    }
+
+    const vk::MemoryBarrier partialsBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+    };
+    slot.cmd->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {partialsBarrier}, {}, {});
+
+    // a single workgroup strides over all partial sums of a request
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->_pipeline);
+    for (size_t i = 0; i < sums.size(); i++) {
+        const auto &sum = sums[i];
+
+        this->_layout.push(slot, {
+            PushDescriptor::storageBuffer(this->_partials),
+            PushDescriptor::storageBuffer(*sum.output),
+        });
+        slot.cmd->pushConstants<SumPushConstants>(this->_layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, SumPushConstants{
+            .offset = static_cast<uint32_t>(i) * MAX_PARTIALS,
+            .size = groups[i],
+            .outIndex = sum.outputIndex,
+        });
+        slot.cmd->dispatch(1, 1, 1);
+    }
+
+    const vk::MemoryBarrier resultBarrier = {
+        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead,
+    };
+    slot.cmd->pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+        {},
+        {resultBarrier},
+        {},
+        {}
+    );
+}
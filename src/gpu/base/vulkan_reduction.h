@@ -0,0 +1,64 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_REDUCTION_H
+#define VULKAN_REDUCTION_H
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vulkan_runtime.h"
+
+namespace IQM::GPU {
+    // sums count floats of input starting at element offset, the result goes to element outputIndex of output
+    struct SumRequest {
+        const vk::raii::Buffer *input;
+        uint32_t offset;
+        uint32_t count;
+        const vk::raii::Buffer *output;
+        uint32_t outputIndex;
+    };
+
+    /**
+     * Sums float buffers on the GPU in two dispatches, independent of the number of elements.
+     *
+     * The first pass strides every workgroup over the input and writes one partial sum per workgroup,
+     * at most MAX_PARTIALS of them, the second pass sums those with a single workgroup.
+     * All requests given to record() share these two passes, so there is one barrier between them
+     * instead of a barrier per level of a tree reduction for every sum.
+     *
+     * Workgroups reduce with subgroupAdd if VulkanRuntime::_subgroupArithmetic is set and with a tree
+     * in shared memory otherwise, the workgroup size is tuned as "reduce_sum" and must be a power of two.
+     */
+    class SumReduction {
+    public:
+        static constexpr uint32_t MAX_PARTIALS = 256;
+
+        SumReduction() = default;
+        // maxSums limits the number of requests of a single record() call
+        SumReduction(const VulkanRuntime &runtime, uint32_t maxSums);
+
+        // inputs must be visible to compute shader reads already,
+        // outputs are visible to compute shaders and transfers once the recorded commands finish
+        void record(FrameSlot &slot, const std::vector<SumRequest> &sums, bool square) const;
+
+    private:
+        vk::raii::ShaderModule _kernel = VK_NULL_HANDLE;
+        PushDescriptorLayout _layout;
+        vk::raii::Pipeline _pipeline = VK_NULL_HANDLE;
+        // squares the elements before summing, used only by the first pass
+        vk::raii::Pipeline _squarePipeline = VK_NULL_HANDLE;
+        WorkgroupSize _workgroupSize;
+
+        // MAX_PARTIALS floats for every request
+        vk::raii::Buffer _partials = VK_NULL_HANDLE;
+        VulkanAllocation _partialsMemory = VK_NULL_HANDLE;
+        uint32_t _maxSums = 0;
+    };
+}
+
+#endif //VULKAN_REDUCTION_H
@@ -5,8 +5,16 @@
 
 #include "vulkan_runtime.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <vector>
 
@@ -19,7 +27,7 @@
 
 const std::string LAYER_VALIDATION = "VK_LAYER_KHRONOS_validation";
 
-IQM::GPU::VulkanRuntime::VulkanRuntime() {
+IQM::GPU::VulkanRuntime::VulkanRuntime(const VulkanRuntimeConfig &config) : _config(config) {
     this->_context = vk::raii::Context{};
 
     vk::ApplicationInfo appInfo{
@@ -30,11 +38,10 @@ IQM::GPU::VulkanRuntime::VulkanRuntime() {
         .apiVersion = VK_API_VERSION_1_3,
     };
 
-    auto layers = getLayers();
+    auto layers = getLayers(config);
 
 #ifdef PROFILE
     std::vector extensions = {
-        VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
         VK_KHR_SURFACE_EXTENSION_NAME,
     };
 
@@ -47,11 +54,19 @@ IQM::GPU::VulkanRuntime::VulkanRuntime() {
     }
 
 #else
-    std::vector extensions = {
-        VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
-    };
+    std::vector<const char *> extensions;
 #endif
 
+    // production runs enable no layers nor debug extensions at all
+    const bool debugUtils = config.debugMessenger && std::ranges::any_of(this->_context.enumerateInstanceExtensionProperties(), [](const vk::ExtensionProperties &extension) {
+        return strcmp(extension.extensionName, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0;
+    });
+    if (debugUtils) {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    } else if (config.debugMessenger) {
+        std::cerr << VK_EXT_DEBUG_UTILS_EXTENSION_NAME << " is not available, debug messages are not printed" << std::endl;
+    }
+
     const vk::InstanceCreateInfo instanceCreateInfo{
         .pApplicationInfo = &appInfo,
         .enabledLayerCount = static_cast<uint32_t>(layers.size()),
@@ -61,9 +76,51 @@ IQM::GPU::VulkanRuntime::VulkanRuntime() {
     };
 
     this->_instance = vk::raii::Instance{this->_context, instanceCreateInfo};
+    if (debugUtils) {
+        this->initDebugMessenger();
+    }
 
     this->initQueues();
     this->initDescriptors();
+    this->initStaging();
+    this->_imageCache = std::make_unique<VulkanImageCache>(*this);
+    this->initZeroCopy();
+    this->initPipelineCache();
+    this->initWorkgroupSizes();
+}
+
+IQM::GPU::VulkanRuntime::~VulkanRuntime() {
+    // must not throw, a failed write only means the next run starts cold
+    try {
+        this->savePipelineCache();
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to save pipeline cache: " << e.what() << std::endl;
+    }
+}
+
+std::vector<std::string> IQM::GPU::VulkanRuntime::enumerateDevices() {
+    const vk::raii::Context context{};
+
+    vk::ApplicationInfo appInfo{
+        .pApplicationName = "Image Quality Metrics",
+        .applicationVersion = VK_MAKE_API_VERSION(0, 0, 1, 0),
+        .pEngineName = "No Engine",
+        .engineVersion = VK_MAKE_API_VERSION(0, 0, 1, 0),
+        .apiVersion = VK_API_VERSION_1_3,
+    };
+
+    const vk::InstanceCreateInfo instanceCreateInfo{
+        .pApplicationInfo = &appInfo,
+    };
+
+    const vk::raii::Instance instance{context, instanceCreateInfo};
+
+    std::vector<std::string> names;
+    for (const auto &device : instance.enumeratePhysicalDevices()) {
+        names.emplace_back(device.getProperties().deviceName);
+    }
+
+    return names;
 }
 
 vk::raii::ShaderModule IQM::GPU::VulkanRuntime::createShaderModule(const uint32_t* spvCode, size_t size) const {
@@ -88,79 +145,71 @@ vk::raii::PipelineLayout IQM::GPU::VulkanRuntime::createPipelineLayout(const std
     return vk::raii::PipelineLayout{this->_device, layoutInfo};
 }
 
-vk::raii::Pipeline IQM::GPU::VulkanRuntime::createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout) const {
+vk::raii::Pipeline IQM::GPU::VulkanRuntime::createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const vk::SpecializationInfo *specialization) const {
     vk::ComputePipelineCreateInfo computePipelineCreateInfo{
         .stage = vk::PipelineShaderStageCreateInfo {
             .stage = vk::ShaderStageFlagBits::eCompute,
             .module = shader,
             // all shaders will start in main
             .pName = "main",
+            .pSpecializationInfo = specialization,
         },
         .layout = layout
     };
 
-    return std::move(vk::raii::Pipelines{this->_device, nullptr, computePipelineCreateInfo}.front());
+    const auto start = std::chrono::high_resolution_clock::now();
+    auto pipeline = std::move(vk::raii::Pipelines{this->_device, this->_pipelineCache, computePipelineCreateInfo}.front());
+    const auto creationTime = std::chrono::high_resolution_clock::now() - start;
+
+    {
+        std::lock_guard lock(this->_pipelineStatsMutex);
+        this->_pipelineCacheStats.creationTime += creationTime;
+        this->_pipelineCacheStats.pipelineCount++;
+    }
+
+    return pipeline;
 }
 
-uint32_t findMemoryType(vk::PhysicalDeviceMemoryProperties const &memoryProperties, uint32_t typeBits, vk::MemoryPropertyFlags requirementsMask) {
-    auto typeIndex = static_cast<uint32_t>(~0);
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        if ((typeBits & 1) && ((memoryProperties.memoryTypes[i].propertyFlags & requirementsMask) == requirementsMask)) {
-            typeIndex = i;
-            break;
-        }
-        typeBits >>= 1;
+IQM::GPU::PipelineCacheStats IQM::GPU::VulkanRuntime::pipelineCacheStats() const {
+    std::lock_guard lock(this->_pipelineStatsMutex);
+    return this->_pipelineCacheStats;
+}
+
+IQM::GPU::VulkanDescriptorAllocatorStats IQM::GPU::VulkanRuntime::slotDescriptorStats() const {
+    VulkanDescriptorAllocatorStats stats;
+    for (const auto &slot : this->_slots) {
+        stats += slot->descriptors->stats();
     }
-    assert(typeIndex != static_cast<uint32_t>(~0));
-    return typeIndex;
+    return stats;
 }
 
-std::pair<vk::raii::Buffer, vk::raii::DeviceMemory> IQM::GPU::VulkanRuntime::createBuffer(const unsigned bufferSize, const vk::BufferUsageFlags bufferFlags, const vk::MemoryPropertyFlags memoryFlags) const {
-    // create now, so it's destroyed before buffer
-    vk::raii::DeviceMemory memory{nullptr};
+vk::raii::Pipeline IQM::GPU::VulkanRuntime::createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const WorkgroupSize workgroupSize) const {
+    const auto constants = workgroupSize.constants();
+    const auto info = constants.info();
+    return this->createComputePipeline(shader, layout, &info);
+}
 
+std::pair<vk::raii::Buffer, IQM::GPU::VulkanAllocation> IQM::GPU::VulkanRuntime::createBuffer(const vk::DeviceSize bufferSize, const vk::BufferUsageFlags bufferFlags, const vk::MemoryPropertyFlags memoryFlags) const {
     vk::BufferCreateInfo bufferCreateInfo{
         .size = bufferSize,
         .usage = bufferFlags,
     };
 
     vk::raii::Buffer buffer{this->_device, bufferCreateInfo};
-    auto memReqs = buffer.getMemoryRequirements();
-    const auto memType = findMemoryType(
-        this->_physicalDevice.getMemoryProperties(),
-        memReqs.memoryTypeBits,
-        memoryFlags
-    );
-
-    vk::MemoryAllocateInfo memoryAllocateInfo{
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = memType
-    };
-
-    memory = vk::raii::DeviceMemory{this->_device, memoryAllocateInfo};
+    auto memory = this->_allocator->allocate(buffer.getMemoryRequirements(), memoryFlags, true);
+    buffer.bindMemory(memory.memory(), memory.offset());
 
     return std::make_pair(std::move(buffer), std::move(memory));
 }
 
-IQM::GPU::VulkanImage IQM::GPU::VulkanRuntime::createImage(const vk::ImageCreateInfo &imageInfo) const {
-    // create now, so it's destroyed before buffer
-    vk::raii::DeviceMemory memory{nullptr};
-
+IQM::GPU::VulkanImage IQM::GPU::VulkanRuntime::createImage(const vk::ImageCreateInfo &imageInfo, const vk::MemoryPropertyFlags memoryFlags) const {
     vk::raii::Image image{this->_device, imageInfo};
-    auto memReqs = image.getMemoryRequirements();
-    const auto memType = findMemoryType(
-        this->_physicalDevice.getMemoryProperties(),
-        memReqs.memoryTypeBits,
-        vk::MemoryPropertyFlagBits::eDeviceLocal
+    auto memory = this->_allocator->allocate(
+        image.getMemoryRequirements(),
+        memoryFlags,
+        imageInfo.tiling == vk::ImageTiling::eLinear
     );
-
-    vk::MemoryAllocateInfo memoryAllocateInfo{
-        .allocationSize = memReqs.size,
-        .memoryTypeIndex = memType
-    };
-
-    memory = vk::raii::DeviceMemory{this->_device, memoryAllocateInfo};
-    image.bindMemory(memory, 0);
+    image.bindMemory(memory.memory(), memory.offset());
 
     vk::ImageViewCreateInfo imageViewCreateInfo{
         .image = image,
@@ -179,9 +228,158 @@ IQM::GPU::VulkanImage IQM::GPU::VulkanRuntime::createImage(const vk::ImageCreate
         .memory = std::move(memory),
         .image = std::move(image),
         .imageView = vk::raii::ImageView{this->_device, imageViewCreateInfo},
+        .preinitialized = imageInfo.initialLayout == vk::ImageLayout::ePreinitialized,
+    };
+}
+
+static constexpr vk::MemoryPropertyFlags ZERO_COPY_MEMORY = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+static vk::ImageCreateInfo hostInputImageInfo(vk::ImageCreateInfo imageInfo) {
+    // only linear images have a row layout the host can write into
+    imageInfo.tiling = vk::ImageTiling::eLinear;
+    imageInfo.usage = vk::ImageUsageFlagBits::eStorage;
+    imageInfo.initialLayout = vk::ImageLayout::ePreinitialized;
+    return imageInfo;
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::VulkanRuntime::acquireHostInputImage(const vk::ImageCreateInfo &imageInfo) const {
+    if (!this->_zeroCopyInputs || imageInfo.format != vk::Format::eR8G8B8A8Unorm) {
+        return nullptr;
+    }
+    if (imageInfo.extent.width > this->_zeroCopyMaxExtent.width || imageInfo.extent.height > this->_zeroCopyMaxExtent.height) {
+        return nullptr;
+    }
+
+    return this->_imageCache->acquire(hostInputImageInfo(imageInfo), ZERO_COPY_MEMORY);
+}
+
+std::shared_ptr<IQM::GPU::VulkanImage> IQM::GPU::VulkanRuntime::acquireInputImage(const vk::ImageCreateInfo &imageInfo) const {
+    if (auto image = this->acquireHostInputImage(imageInfo)) {
+        return image;
+    }
+    return this->_imageCache->acquire(imageInfo);
+}
+
+bool IQM::GPU::VulkanRuntime::uploadInputImage(FrameSlot &slot, const std::shared_ptr<VulkanImage> &image, const InputImage &input) const {
+    // always 4 channels on input, with 1B per channel
+    const auto rowSize = static_cast<size_t>(input.width) * 4;
+
+    if (auto *mapped = static_cast<char *>(image->memory.map()); mapped != nullptr) {
+        // the image is idle once handed out, the submission of the slot makes the writes visible to the device
+        const auto layout = image->image.getSubresourceLayout(vk::ImageSubresource{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .mipLevel = 0,
+            .arrayLayer = 0,
+        });
+        for (int y = 0; y < input.height; y++) {
+            memcpy(mapped + layout.offset + y * layout.rowPitch, input.data.data() + y * rowSize, rowSize);
+        }
+
+        // reused images are already in GENERAL, nothing to submit
+        if (!image->preinitialized) {
+            return false;
+        }
+
+        // unlike UNDEFINED, PREINITIALIZED keeps the contents written by the host
+        const vk::ImageMemoryBarrier barrier{
+            .oldLayout = vk::ImageLayout::ePreinitialized,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image->image,
+            .subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1),
+        };
+        slot.cmdTransfer->pipelineBarrier(vk::PipelineStageFlagBits::eBottomOfPipe, vk::PipelineStageFlagBits::eTopOfPipe, {}, nullptr, nullptr, barrier);
+        image->preinitialized = false;
+        return true;
+    }
+
+    initImages(slot.cmdTransfer, {image});
+
+    vk::BufferImageCopy copyRegion{
+        .bufferOffset = 0,
+        .bufferRowLength = static_cast<uint32_t>(input.width),
+        .bufferImageHeight = static_cast<uint32_t>(input.height),
+        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+        .imageOffset = vk::Offset3D{0, 0, 0},
+        .imageExtent = vk::Extent3D{static_cast<uint32_t>(input.width), static_cast<uint32_t>(input.height), 1}
     };
+
+    if (const auto imported = this->importHostPixels(slot, input)) {
+        slot.cmdTransfer->copyBufferToImage(*imported, image->image, vk::ImageLayout::eGeneral, copyRegion);
+        return true;
+    }
+
+    const auto size = rowSize * input.height;
+    const auto staging = this->_uploadRing->reserve(slot, size);
+    memcpy(staging.data(), input.data.data(), size);
+    staging.flush();
+
+    copyRegion.bufferOffset = staging.offset();
+    slot.cmdTransfer->copyBufferToImage(staging.buffer(), image->image, vk::ImageLayout::eGeneral, copyRegion);
+    return true;
 }
 
+const vk::raii::Buffer *IQM::GPU::VulkanRuntime::importHostPixels(FrameSlot &slot, const InputImage &input) const {
+    if (!this->_externalMemoryHost || input.data.empty()) {
+        return nullptr;
+    }
+
+    // the allocation behind the view ends on hostAlignment, so the whole imported range belongs to the input
+    const auto alignment = this->_minImportedHostPointerAlignment;
+    const auto address = reinterpret_cast<uintptr_t>(input.data.data());
+    if (alignment == 0 || alignment > input.hostAlignment || address % alignment != 0) {
+        return nullptr;
+    }
+    const auto size = (input.data.size() + alignment - 1) / alignment * alignment;
+
+    // only read by the transfer, the import itself needs a non-const pointer
+    auto *pointer = const_cast<unsigned char *>(input.data.data());
+    constexpr auto handleType = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT;
+
+    try {
+        const auto pointerProperties = this->_device.getMemoryHostPointerPropertiesEXT(handleType, pointer);
+
+        const vk::ExternalMemoryBufferCreateInfo externalInfo{
+            .handleTypes = handleType,
+        };
+        ImportedHostBuffer imported;
+        imported.pixels = input.owner;
+        imported.buffer = vk::raii::Buffer{this->_device, vk::BufferCreateInfo{
+            .pNext = &externalInfo,
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+            .sharingMode = vk::SharingMode::eExclusive,
+        }};
+
+        const auto requirements = imported.buffer.getMemoryRequirements();
+        const auto typeBits = requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+        if (typeBits == 0 || requirements.size > size) {
+            return nullptr;
+        }
+
+        const vk::ImportMemoryHostPointerInfoEXT importInfo{
+            .handleType = handleType,
+            .pHostPointer = pointer,
+        };
+        imported.memory = vk::raii::DeviceMemory{this->_device, vk::MemoryAllocateInfo{
+            .pNext = &importInfo,
+            .allocationSize = size,
+            .memoryTypeIndex = static_cast<uint32_t>(std::countr_zero(typeBits)),
+        }};
+        imported.buffer.bindMemory(imported.memory, 0);
+
+        slot.importedBuffers.push_back(std::move(imported));
+    } catch (const vk::SystemError &) {
+        // drivers may still refuse some allocations, e.g. memory that is not from an anonymous mapping
+        return nullptr;
+    }
+
+    return &slot.importedBuffers.back().buffer;
+}
+
+
+
 void IQM::GPU::VulkanRuntime::setImageLayout(const std::shared_ptr<vk::raii::CommandBuffer> &cmd_buf, const vk::raii::Image& image, vk::ImageLayout srcLayout, vk::ImageLayout targetLayout) const {
     vk::AccessFlags sourceAccessMask;
     vk::PipelineStageFlags sourceStage = vk::PipelineStageFlagBits::eTopOfPipe | vk::PipelineStageFlagBits::eTransfer;
@@ -223,31 +421,6 @@ void IQM::GPU::VulkanRuntime::initImages(const std::shared_ptr<vk::raii::Command
     return cmd_buf->pipelineBarrier(vk::PipelineStageFlagBits::eBottomOfPipe,  vk::PipelineStageFlagBits::eTopOfPipe, {}, nullptr, nullptr, barriers);
 }
 
-void IQM::GPU::VulkanRuntime::nuke() const {
-    auto mask =
-        vk::AccessFlagBits::eIndirectCommandRead |
-        vk::AccessFlagBits::eIndexRead |
-        vk::AccessFlagBits::eVertexAttributeRead |
-        vk::AccessFlagBits::eUniformRead |
-        vk::AccessFlagBits::eInputAttachmentRead |
-        vk::AccessFlagBits::eShaderRead |
-        vk::AccessFlagBits::eShaderWrite |
-        vk::AccessFlagBits::eColorAttachmentRead |
-        vk::AccessFlagBits::eColorAttachmentWrite |
-        vk::AccessFlagBits::eDepthStencilAttachmentRead |
-        vk::AccessFlagBits::eDepthStencilAttachmentWrite |
-        vk::AccessFlagBits::eTransferRead |
-        vk::AccessFlagBits::eTransferWrite|
-        vk::AccessFlagBits::eHostRead |
-        vk::AccessFlagBits::eHostWrite;
-
-    vk::MemoryBarrier barrier {
-        .srcAccessMask = mask,
-        .dstAccessMask = mask,
-    };
-    return this->_cmd_buffer->pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eAllCommands, {}, {barrier}, nullptr, nullptr);
-}
-
 std::vector<vk::PushConstantRange> IQM::GPU::VulkanRuntime::createPushConstantRange(const unsigned size) {
     return {
         vk::PushConstantRange {
@@ -382,40 +555,135 @@ void IQM::GPU::VulkanRuntime::present(unsigned index) {
 }
 #endif
 
-void IQM::GPU::VulkanRuntime::initQueues() {
-    std::optional<vk::raii::PhysicalDevice> physicalDevice;
+struct DeviceCandidate {
+    uint32_t index;
+    std::string name;
+    int64_t score;
+    int computeQueueIndex;
+    int transferQueueIndex;
+};
+
+static DeviceCandidate scoreDevice(const vk::raii::PhysicalDevice &device, const uint32_t index) {
+    const auto properties = device.getProperties();
+    DeviceCandidate candidate{
+        .index = index,
+        .name = std::string(properties.deviceName),
+        .score = 0,
+        .computeQueueIndex = -1,
+        .transferQueueIndex = -1,
+    };
+
     // try to access faster dedicated transfer queue
-    int computeQueueIndex = -1;
-    int transferQueueIndex = -1;
+    int i = 0;
+    for (const auto& queueFamily : device.getQueueFamilyProperties()) {
+        if (!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)) {
+            candidate.transferQueueIndex = i;
+        }
 
-    auto devices = _instance.enumeratePhysicalDevices();
-    for (const auto& device : devices) {
-        auto properties = device.getProperties();
+        if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+            candidate.computeQueueIndex = i;
+        }
 
-        physicalDevice = device;
+        i++;
+    }
 
-        auto queueFamilyProperties = device.getQueueFamilyProperties();
+    // unusable without a compute queue
+    if (candidate.computeQueueIndex == -1) {
+        candidate.score = -1;
+        return candidate;
+    }
 
-        int i = 0;
-        for (const auto& queueFamily : queueFamilyProperties) {
-            if (!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer && !(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)) {
-                transferQueueIndex = i;
-            }
+    switch (properties.deviceType) {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            candidate.score += 10000;
+        break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            candidate.score += 5000;
+        break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            candidate.score += 2000;
+        break;
+        case vk::PhysicalDeviceType::eCpu:
+        break;
+        default:
+            candidate.score += 1000;
+        break;
+    }
 
-            if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute && queueFamily.queueFlags & vk::QueueFlagBits::eTransfer && queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
-                computeQueueIndex = i;
+    // one point per MiB of device local memory would outweigh device type, count GiB instead
+    const auto memoryProperties = device.getMemoryProperties();
+    vk::DeviceSize deviceLocalSize = 0;
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+        if (memoryProperties.memoryHeaps[heap].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+            deviceLocalSize = std::max(deviceLocalSize, memoryProperties.memoryHeaps[heap].size);
+        }
+    }
+    candidate.score += static_cast<int64_t>(deviceLocalSize / (1024 * 1024 * 1024)) * 100;
+
+    if (candidate.transferQueueIndex != -1) {
+        candidate.score += 500;
+    }
+
+    return candidate;
+}
+
+static std::string toLower(std::string str) {
+    std::ranges::transform(str, str.begin(), [](const unsigned char c) { return std::tolower(c); });
+    return str;
+}
+
+void IQM::GPU::VulkanRuntime::initQueues() {
+    auto devices = _instance.enumeratePhysicalDevices();
+    if (devices.empty()) {
+        throw std::runtime_error("No Vulkan device found");
+    }
+
+    std::vector<DeviceCandidate> candidates;
+    for (uint32_t i = 0; i < devices.size(); i++) {
+        candidates.emplace_back(scoreDevice(devices[i], i));
+    }
+
+    std::vector<DeviceCandidate> matching;
+    if (this->_config.device.has_value()) {
+        const auto &selector = this->_config.device.value();
+        // whole selector is a number -> device index, otherwise part of the device name
+        if (!selector.empty() && std::ranges::all_of(selector, [](const unsigned char c) { return std::isdigit(c); })) {
+            const auto index = std::stoul(selector);
+            if (index >= candidates.size()) {
+                throw std::runtime_error("Device index " + selector + " is out of range, " + std::to_string(candidates.size()) + " devices available");
             }
+            matching.push_back(candidates[index]);
+        } else {
+            const auto needle = toLower(selector);
+            for (const auto &candidate : candidates) {
+                if (toLower(candidate.name).find(needle) != std::string::npos) {
+                    matching.push_back(candidate);
+                }
+            }
+        }
 
-            i++;
+        if (matching.empty()) {
+            std::string available;
+            for (const auto &candidate : candidates) {
+                available += "\n  " + std::to_string(candidate.index) + ": " + candidate.name;
+            }
+            throw std::runtime_error("No device matches '" + selector + "', available devices:" + available);
         }
+    } else {
+        matching = candidates;
+    }
 
-        this->selectedDevice = std::string(properties.deviceName);
-        break;
+    const auto best = std::ranges::max_element(matching, {}, &DeviceCandidate::score);
+    if (best->score < 0) {
+        throw std::runtime_error("Device '" + best->name + "' has no suitable compute queue");
     }
 
-    this->_physicalDevice = physicalDevice.value();
-    this->_queueFamilyIndex = computeQueueIndex;
-    this->_transferQueueFamilyIndex = transferQueueIndex;
+    this->selectedDevice = best->name;
+    this->_physicalDevice = devices[best->index];
+    this->_queueFamilyIndex = best->computeQueueIndex;
+    this->_transferQueueFamilyIndex = best->transferQueueIndex;
+    const int computeQueueIndex = best->computeQueueIndex;
+    const int transferQueueIndex = best->transferQueueIndex;
 
     float queuePriority = 1.0f;
 
@@ -448,14 +716,61 @@ void IQM::GPU::VulkanRuntime::initQueues() {
     }
 
 #ifdef PROFILE
-    std::vector deviceExtensions = {
+    std::vector<const char *> deviceExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 #else
-    std::vector<char*> deviceExtensions = {};
+    std::vector<const char *> deviceExtensions = {};
 #endif
 
+    // optional, metrics bind their descriptors through update templates without it
+    const auto availableExtensions = this->_physicalDevice.enumerateDeviceExtensionProperties();
+    this->_pushDescriptors = std::ranges::any_of(availableExtensions, [](const vk::ExtensionProperties &extension) {
+        return strcmp(extension.extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0;
+    });
+    if (this->_pushDescriptors) {
+        deviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+        const auto properties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR>();
+        this->_maxPushDescriptors = properties.get<vk::PhysicalDevicePushDescriptorPropertiesKHR>().maxPushDescriptors;
+    }
+
+    // optional, input uploads go through the staging ring without it
+    this->_externalMemoryHost = this->_config.importHostMemory && std::ranges::any_of(availableExtensions, [](const vk::ExtensionProperties &extension) {
+        return strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0;
+    });
+    if (this->_externalMemoryHost) {
+        deviceExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+
+        const auto properties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>();
+        this->_minImportedHostPointerAlignment = properties.get<vk::PhysicalDeviceExternalMemoryHostPropertiesEXT>().minImportedHostPointerAlignment;
+    }
+
+    // core since 1.1, only the reductions use it and they fall back to shared memory
+    const auto subgroupProperties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceSubgroupProperties>()
+        .get<vk::PhysicalDeviceSubgroupProperties>();
+    constexpr auto requiredOperations = vk::SubgroupFeatureFlagBits::eBasic | vk::SubgroupFeatureFlagBits::eArithmetic;
+    this->_subgroupArithmetic = this->_config.subgroupReductions
+        && (subgroupProperties.supportedStages & vk::ShaderStageFlagBits::eCompute)
+        && (subgroupProperties.supportedOperations & requiredOperations) == requiredOperations;
+    this->_subgroupSize = subgroupProperties.subgroupSize;
+
+    // rgba16f storage images are always supported, rg16f needs shaderStorageImageExtendedFormats
+    this->_halfPrecision = this->_config.halfPrecision && std::ranges::all_of(
+        std::array{vk::Format::eR16G16Sfloat, vk::Format::eR16G16B16A16Sfloat},
+        [this](const vk::Format format) {
+            constexpr auto required = vk::FormatFeatureFlagBits::eStorageImage;
+            return (this->_physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+        }
+    );
+
+    // core since 1.2, FrameSlot synchronization relies on it
+    vk::PhysicalDeviceVulkan12Features features12{
+        .timelineSemaphore = true,
+    };
+
     const vk::DeviceCreateInfo deviceCreateInfo{
+        .pNext = &features12,
         .queueCreateInfoCount = static_cast<uint32_t>(queues.size()),
         .pQueueCreateInfos = queues.data(),
         .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
@@ -463,6 +778,7 @@ void IQM::GPU::VulkanRuntime::initQueues() {
     };
 
     this->_device = vk::raii::Device{this->_physicalDevice, deviceCreateInfo};
+    this->_allocator = std::make_unique<VulkanAllocator>(this->_physicalDevice, this->_device);
     this->_queue = std::make_shared<vk::raii::Queue>(this->_device.getQueue(this->_queueFamilyIndex, 0));
 
     if (dedicatedTransferQueue) {
@@ -480,72 +796,345 @@ void IQM::GPU::VulkanRuntime::initQueues() {
 
     vk::CommandBufferAllocateInfo commandBufferAllocateInfo{
         .commandPool = *this->_commandPool,
-        .commandBufferCount = 2,
+        .commandBufferCount = 1,
     };
 
-    auto bufs = vk::raii::CommandBuffers{this->_device, commandBufferAllocateInfo};
-    this->_cmd_buffer = std::make_shared<vk::raii::CommandBuffer>(std::move(bufs[0]));
-    this->_cmd_bufferTransfer = std::make_shared<vk::raii::CommandBuffer>(std::move(bufs[1]));
+    this->_cmd_buffer = std::make_shared<vk::raii::CommandBuffer>(std::move(vk::raii::CommandBuffers{this->_device, commandBufferAllocateInfo}.front()));
 
-    if (dedicatedTransferQueue) {
-        vk::CommandPoolCreateInfo commandPoolCreateInfoTransfer {
+    this->initSlots(computeQueueIndex, transferQueueIndex, dedicatedTransferQueue);
+}
+
+void IQM::GPU::VulkanRuntime::initSlots(const int computeQueueIndex, const int transferQueueIndex, const bool dedicatedTransferQueue) {
+    const auto count = std::max(1u, this->_config.framesInFlight);
+
+    if (this->_config.gpuTimers) {
+        const auto validBits = this->_physicalDevice.getQueueFamilyProperties()[computeQueueIndex].timestampValidBits;
+        this->_timestampPeriod = this->_physicalDevice.getProperties().limits.timestampPeriod;
+        this->_timestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{1} << validBits) - 1;
+        this->_gpuTimers = validBits > 0 && this->_timestampPeriod > 0;
+        if (!this->_gpuTimers) {
+            std::cerr << "GPU timers are not supported by the compute queue" << std::endl;
+        }
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        auto slot = std::make_unique<FrameSlot>();
+        slot->index = i;
+        slot->descriptors = std::make_unique<VulkanDescriptorAllocator>(this->_device);
+
+        const vk::CommandPoolCreateInfo commandPoolCreateInfo{
             .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-            .queueFamilyIndex = static_cast<unsigned>(transferQueueIndex),
+            .queueFamilyIndex = static_cast<unsigned>(computeQueueIndex),
+        };
+        slot->commandPool = vk::raii::CommandPool{this->_device, commandPoolCreateInfo};
+
+        vk::CommandBufferAllocateInfo commandBufferAllocateInfo{
+            .commandPool = *slot->commandPool,
+            .commandBufferCount = dedicatedTransferQueue ? 1u : 2u,
         };
 
-        this->_commandPoolTransfer = std::make_shared<vk::raii::CommandPool>(vk::raii::CommandPool{this->_device, commandPoolCreateInfoTransfer});
+        auto bufs = vk::raii::CommandBuffers{this->_device, commandBufferAllocateInfo};
+        slot->cmd = std::make_shared<vk::raii::CommandBuffer>(std::move(bufs[0]));
+
+        if (dedicatedTransferQueue) {
+            const vk::CommandPoolCreateInfo commandPoolCreateInfoTransfer{
+                .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                .queueFamilyIndex = static_cast<unsigned>(transferQueueIndex),
+            };
+            slot->commandPoolTransfer = vk::raii::CommandPool{this->_device, commandPoolCreateInfoTransfer};
+
+            commandBufferAllocateInfo = {
+                .commandPool = *slot->commandPoolTransfer,
+                .commandBufferCount = 1,
+            };
+
+            slot->cmdTransfer = std::make_shared<vk::raii::CommandBuffer>(std::move(vk::raii::CommandBuffers{this->_device, commandBufferAllocateInfo}.front()));
+        } else {
+            slot->cmdTransfer = std::make_shared<vk::raii::CommandBuffer>(std::move(bufs[1]));
+        }
 
-        commandBufferAllocateInfo = {
-            .commandPool = *this->_commandPoolTransfer,
+        if (this->_gpuTimers) {
+            const vk::QueryPoolCreateInfo queryPoolInfo{
+                .queryType = vk::QueryType::eTimestamp,
+                .queryCount = MAX_GPU_TIMERS * 2,
+            };
+            slot->queryPool = vk::raii::QueryPool{this->_device, queryPoolInfo};
+        }
+
+        this->_slots.push_back(std::move(slot));
+    }
+
+    vk::SemaphoreTypeCreateInfo timelineInfo{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0,
+    };
+    const vk::SemaphoreCreateInfo semaphoreInfo{
+        .pNext = &timelineInfo,
+    };
+    this->_timelineCompute = vk::raii::Semaphore{this->_device, semaphoreInfo};
+    this->_timelineTransfer = vk::raii::Semaphore{this->_device, semaphoreInfo};
+}
+
+IQM::GPU::FrameSlotLease::~FrameSlotLease() {
+    if (this->slot != nullptr) {
+        this->runtime->releaseSlot(*this->slot);
+    }
+}
+
+IQM::GPU::FrameSlotLease IQM::GPU::VulkanRuntime::acquireSlot() const {
+    FrameSlot *slot = nullptr;
+    {
+        std::unique_lock lock(this->_slotMutex);
+        this->_slotReleased.wait(lock, [&] {
+            // round robin, so the slot that finished longest ago is reused first
+            for (unsigned i = 0; i < this->_slots.size(); i++) {
+                auto &candidate = this->_slots[(this->_nextSlot + i) % this->_slots.size()];
+                if (!candidate->acquired) {
+                    slot = candidate.get();
+                    return true;
+                }
+            }
+            return false;
+        });
+        slot->acquired = true;
+        this->_nextSlot = (slot->index + 1) % this->_slots.size();
+    }
+
+    this->waitForSlot(*slot);
+    // timers of a previous user that never collected them
+    slot->timerNames.clear();
+    slot->openTimers.clear();
+    // the previous work of the slot has finished, so its transient sets are no longer in use
+    slot->descriptors->reset();
+    // and so are its staging ranges, the previous user already read back everything it needed
+    this->_uploadRing->reclaim(*slot);
+    this->_readbackRing->reclaim(*slot);
+    // the previous user's inputs may already be gone
+    slot->importedBuffers.clear();
+
+    return FrameSlotLease{*this, *slot};
+}
+
+void IQM::GPU::VulkanRuntime::releaseSlot(FrameSlot &slot) const {
+    {
+        std::lock_guard lock(this->_slotMutex);
+        slot.acquired = false;
+    }
+    this->_slotReleased.notify_one();
+}
+
+void IQM::GPU::VulkanRuntime::submitSlot(FrameSlot &slot, const SlotQueue queue) const {
+    std::lock_guard lock(this->_queueMutex);
+
+    if (queue == SlotQueue::Transfer) {
+        const auto value = ++this->_timelineTransferValue;
+        const vk::TimelineSemaphoreSubmitInfo timelineInfo{
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &value,
+        };
+        const vk::SubmitInfo submitInfo{
+            .pNext = &timelineInfo,
             .commandBufferCount = 1,
+            .pCommandBuffers = &**slot.cmdTransfer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &*this->_timelineTransfer,
         };
 
-        this->_cmd_bufferTransfer = std::make_shared<vk::raii::CommandBuffer>(std::move(vk::raii::CommandBuffers{this->_device, commandBufferAllocateInfo}.front()));
+        this->_transferQueue->submit(submitInfo);
+        slot.transferValue = value;
+        slot.uploadValue = value;
+        return;
     }
+
+    const auto value = ++this->_timelineComputeValue;
+    const auto waitMask = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer};
+    const auto waitCount = slot.uploadValue != 0 ? 1u : 0u;
+    const vk::TimelineSemaphoreSubmitInfo timelineInfo{
+        .waitSemaphoreValueCount = waitCount,
+        .pWaitSemaphoreValues = &slot.uploadValue,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &value,
+    };
+    const vk::SubmitInfo submitInfo{
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = waitCount,
+        .pWaitSemaphores = &*this->_timelineTransfer,
+        .pWaitDstStageMask = &waitMask,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &**slot.cmd,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &*this->_timelineCompute,
+    };
+
+    this->_queue->submit(submitInfo);
+    slot.computeValue = value;
+    slot.uploadValue = 0;
 }
 
-void IQM::GPU::VulkanRuntime::initDescriptors() {
-    this->_descLayoutThreeImage = std::move(this->createDescLayout({
-        {vk::DescriptorType::eStorageImage, 1},
-        {vk::DescriptorType::eStorageImage, 1},
-        {vk::DescriptorType::eStorageImage, 1},
-    }));
+void IQM::GPU::VulkanRuntime::waitForSlot(FrameSlot &slot) const {
+    // waiting for an already reached value (or 0) returns immediately
+    const std::array semaphores = {*this->_timelineCompute, *this->_timelineTransfer};
+    const std::array values = {slot.computeValue, slot.transferValue};
+    const vk::SemaphoreWaitInfo waitInfo{
+        .semaphoreCount = static_cast<uint32_t>(semaphores.size()),
+        .pSemaphores = semaphores.data(),
+        .pValues = values.data(),
+    };
 
-    this->_descLayoutTwoImage = std::move(this->createDescLayout({
-        {vk::DescriptorType::eStorageImage, 1},
-        {vk::DescriptorType::eStorageImage, 1},
-    }));
+    if (this->_device.waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for timeline semaphore");
+    }
 
-    this->_descLayoutOneImage = std::move(this->createDescLayout({
-        {vk::DescriptorType::eStorageImage, 1},
-    }));
+    slot.uploadValue = 0;
+}
 
-    this->_descLayoutBuffer = std::move(this->createDescLayout({
-        {vk::DescriptorType::eStorageBuffer, 1},
-        {vk::DescriptorType::eStorageBuffer, 1},
-    }));
+void IQM::GPU::VulkanRuntime::beginGpuTimer(FrameSlot &slot, const std::string &name) const {
+    if (!this->_gpuTimers) {
+        return;
+    }
 
-    this->_descLayoutImageBuffer = std::move(this->createDescLayout({
-        {vk::DescriptorType::eStorageImage, 1},
-        {vk::DescriptorType::eStorageBuffer, 1},
-    }));
+    if (slot.timerNames.size() >= MAX_GPU_TIMERS) {
+        slot.openTimers.push_back(-1);
+        return;
+    }
 
-    std::vector poolSizes = {
-        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage, .descriptorCount = 128},
-        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 32}
-    };
+    const auto index = static_cast<uint32_t>(slot.timerNames.size());
+    slot.timerNames.push_back(name);
+    slot.openTimers.push_back(static_cast<int>(index));
+
+    slot.cmd->resetQueryPool(slot.queryPool, index * 2, 2);
+    slot.cmd->writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, slot.queryPool, index * 2);
+}
+
+void IQM::GPU::VulkanRuntime::endGpuTimer(FrameSlot &slot) const {
+    if (!this->_gpuTimers || slot.openTimers.empty()) {
+        return;
+    }
+
+    const auto index = slot.openTimers.back();
+    slot.openTimers.pop_back();
+    if (index < 0) {
+        return;
+    }
+
+    slot.cmd->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, slot.queryPool, index * 2 + 1);
+}
+
+std::vector<GpuTimestamp> IQM::GPU::VulkanRuntime::collectGpuTimers(FrameSlot &slot) const {
+    std::vector<GpuTimestamp> timers;
+    if (!this->_gpuTimers || slot.timerNames.empty()) {
+        return timers;
+    }
+
+    const auto queryCount = static_cast<uint32_t>(slot.timerNames.size() * 2);
+    auto [res, ticks] = slot.queryPool.getResults<uint64_t>(
+        0,
+        queryCount,
+        queryCount * sizeof(uint64_t),
+        sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait
+    );
+    if (res != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to read GPU timers");
+    }
+
+    for (auto &tick : ticks) {
+        tick &= this->_timestampMask;
+    }
 
-    vk::DescriptorPoolCreateInfo dsCreateInfo{
-        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-        .maxSets = 64,
-        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-        .pPoolSizes = poolSizes.data()
+    // timers from several submissions of the same queue share one clock
+    uint64_t origin = std::numeric_limits<uint64_t>::max();
+    for (uint32_t i = 0; i < queryCount; i += 2) {
+        origin = std::min(origin, ticks[i]);
+    }
+
+    const auto toMillis = [this](const uint64_t ticks) {
+        return std::chrono::duration<double, std::milli>(static_cast<double>(ticks) * this->_timestampPeriod / 1e6);
     };
 
-    this->_descPool = std::move(vk::raii::DescriptorPool{this->_device, dsCreateInfo});
+    for (size_t i = 0; i < slot.timerNames.size(); i++) {
+        const auto start = ticks[i * 2];
+        const auto end = std::max(start, ticks[i * 2 + 1]);
+        timers.push_back(GpuTimestamp{
+            .name = slot.timerNames[i],
+            .start = toMillis(start - origin),
+            .duration = toMillis(end - start),
+        });
+    }
+
+    slot.timerNames.clear();
+    slot.openTimers.clear();
+
+    return timers;
+}
+
+void IQM::GPU::VulkanRuntime::initDescriptors() {
+    // grows with the number of metric instances, every slot may be used by its own one
+    this->_descriptors = std::make_unique<VulkanDescriptorAllocator>(this->_device);
+}
+
+void IQM::GPU::VulkanRuntime::initStaging() {
+    // ring buffers are created with the first reservation, so unused directions cost nothing
+    this->_uploadRing = std::make_unique<VulkanStagingRing>(
+        *this,
+        vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    );
+    // cached memory is much faster to read from on the host
+    this->_readbackRing = std::make_unique<VulkanStagingRing>(
+        *this,
+        vk::BufferUsageFlagBits::eTransferDst,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached
+    );
+}
+
+void IQM::GPU::VulkanRuntime::initZeroCopy() {
+    if (!this->_config.zeroCopyInputs) {
+        return;
+    }
+
+    constexpr auto format = vk::Format::eR8G8B8A8Unorm;
+    if (!(this->_physicalDevice.getFormatProperties(format).linearTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage)) {
+        return;
+    }
+
+    vk::ImageFormatProperties formatProperties;
+    try {
+        formatProperties = this->_physicalDevice.getImageFormatProperties(format, vk::ImageType::e2D, vk::ImageTiling::eLinear, vk::ImageUsageFlagBits::eStorage, {});
+    } catch (const vk::SystemError &) {
+        return;
+    }
+
+    // memory types of an image only depend on its tiling, usage and format, not on its size
+    const vk::raii::Image probe{this->_device, hostInputImageInfo(vk::ImageCreateInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = format,
+        .extent = vk::Extent3D(16, 16, 1),
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .sharingMode = vk::SharingMode::eExclusive,
+    })};
+    const auto typeBits = probe.getMemoryRequirements().memoryTypeBits;
+
+    // a 256 MiB heap is the legacy BAR window of discrete GPUs, a few large inputs would exhaust it
+    constexpr vk::DeviceSize minHeapSize = 256 * 1024 * 1024;
+    const auto memoryProperties = this->_physicalDevice.getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        const auto &type = memoryProperties.memoryTypes[i];
+        if ((typeBits & (1u << i)) && (type.propertyFlags & ZERO_COPY_MEMORY) == ZERO_COPY_MEMORY && memoryProperties.memoryHeaps[type.heapIndex].size > minHeapSize) {
+            this->_zeroCopyInputs = true;
+            this->_zeroCopyMaxExtent = formatProperties.maxExtent;
+            return;
+        }
+    }
 }
 
-std::vector<const char *> IQM::GPU::VulkanRuntime::getLayers() {
+std::vector<const char *> IQM::GPU::VulkanRuntime::getLayers(const VulkanRuntimeConfig &config) {
+    if (!config.validation) {
+        return {};
+    }
+
     uint32_t layerCount;
     vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
 
@@ -559,10 +1148,37 @@ std::vector<const char *> IQM::GPU::VulkanRuntime::getLayers() {
         }
     }
 
+    std::cerr << LAYER_VALIDATION << " is not installed, running without validation" << std::endl;
     return {};
 }
 
-vk::raii::DescriptorSetLayout IQM::GPU::VulkanRuntime::createDescLayout(const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub) const {
+static VKAPI_ATTR VkBool32 VKAPI_CALL debugMessengerCallback(
+    const VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+    VkDebugUtilsMessageTypeFlagsEXT,
+    const VkDebugUtilsMessengerCallbackDataEXT *data,
+    void *
+) {
+    const char *label = severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT ? "error"
+        : severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT ? "warning" : "info";
+    std::cerr << "[vulkan " << label << "] " << data->pMessage << std::endl;
+
+    // the call that triggered the message is not aborted
+    return VK_FALSE;
+}
+
+void IQM::GPU::VulkanRuntime::initDebugMessenger() {
+    // filled as the C struct, the callback type of the Vulkan-Hpp one differs between versions, the layout does not
+    const VkDebugUtilsMessengerCreateInfoEXT createInfo{
+        .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+        .messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+        .messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+        .pfnUserCallback = debugMessengerCallback,
+    };
+
+    this->_debugMessenger = vk::raii::DebugUtilsMessengerEXT{this->_instance, *reinterpret_cast<const vk::DebugUtilsMessengerCreateInfoEXT *>(&createInfo)};
+}
+
+vk::raii::DescriptorSetLayout IQM::GPU::VulkanRuntime::createDescLayout(const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub, const bool push) const {
     auto bindings = std::vector<vk::DescriptorSetLayoutBinding>(stub.size());
 
     for (unsigned i = 0; i < stub.size(); i++) {
@@ -577,6 +1193,7 @@ vk::raii::DescriptorSetLayout IQM::GPU::VulkanRuntime::createDescLayout(const st
     }
 
     auto info = vk::DescriptorSetLayoutCreateInfo {
+        .flags = push ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR : vk::DescriptorSetLayoutCreateFlags{},
         .bindingCount = static_cast<uint32_t>(bindings.size()),
         .pBindings = bindings.data()
     };
@@ -607,13 +1224,6 @@ std::vector<vk::DescriptorImageInfo> IQM::GPU::VulkanRuntime::createImageInfos(c
     return vec;
 }
 
-void IQM::GPU::VulkanRuntime::waitForFence(const vk::raii::Fence &fence) const {
-    auto res = this->_device.waitForFences({fence}, true, std::numeric_limits<uint64_t>::max());
-    if (res != vk::Result::eSuccess) {
-        throw std::runtime_error("Failed to wait for fence");
-    }
-}
-
 vk::WriteDescriptorSet IQM::GPU::VulkanRuntime::createWriteSet(const vk::DescriptorSet &descSet, uint32_t dstBinding, const std::vector<vk::DescriptorImageInfo> &imgInfos) {
     vk::WriteDescriptorSet writeSet{
         .dstSet = descSet,
@@ -644,3 +1254,181 @@ vk::WriteDescriptorSet IQM::GPU::VulkanRuntime::createWriteSet(const vk::Descrip
     return writeSet;
 }
 
+
+std::optional<std::string> IQM::GPU::VulkanRuntimeConfig::defaultPipelineCachePath() {
+    std::filesystem::path dir;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && xdg[0] != '\0') {
+        dir = xdg;
+    } else if (const char *home = std::getenv("HOME"); home != nullptr && home[0] != '\0') {
+        dir = std::filesystem::path(home) / ".cache";
+    } else {
+        return std::nullopt;
+    }
+
+    return (dir / "iqm" / "pipeline_cache.bin").string();
+}
+
+void IQM::GPU::VulkanRuntime::initPipelineCache() {
+    std::vector<char> initialData;
+
+    if (this->_config.pipelineCachePath.has_value()) {
+        const auto deviceProperties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+        const auto &properties = deviceProperties.get<vk::PhysicalDeviceProperties2>().properties;
+        const auto &idProperties = deviceProperties.get<vk::PhysicalDeviceIDProperties>();
+
+        std::ifstream file(this->_config.pipelineCachePath.value(), std::ios::binary);
+        PipelineCacheFileHeader header{};
+        vk::PipelineCacheHeaderVersionOne driverHeader{};
+
+        if (!file) {
+            this->_pipelineCacheStats.rejectReason = "no cache file";
+        } else if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != PIPELINE_CACHE_MAGIC) {
+            this->_pipelineCacheStats.rejectReason = "invalid cache file";
+        } else if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+            this->_pipelineCacheStats.rejectReason = "different device";
+        } else if (memcmp(header.driverUUID, idProperties.driverUUID.data(), VK_UUID_SIZE) != 0) {
+            this->_pipelineCacheStats.rejectReason = "different driver";
+        } else {
+            initialData.resize(header.dataSize);
+            if (header.dataSize < sizeof(driverHeader) || !file.read(initialData.data(), header.dataSize)) {
+                this->_pipelineCacheStats.rejectReason = "truncated cache file";
+                initialData.clear();
+            } else {
+                // drivers should reject mismatching data themselves, but not all of them do
+                memcpy(&driverHeader, initialData.data(), sizeof(driverHeader));
+                if (driverHeader.headerVersion != vk::PipelineCacheHeaderVersion::eOne
+                    || driverHeader.vendorID != properties.vendorID
+                    || driverHeader.deviceID != properties.deviceID
+                    || driverHeader.pipelineCacheUUID != properties.pipelineCacheUUID) {
+                    this->_pipelineCacheStats.rejectReason = "incompatible cache data";
+                    initialData.clear();
+                }
+            }
+        }
+    } else {
+        this->_pipelineCacheStats.rejectReason = "cache disabled";
+    }
+
+    const vk::PipelineCacheCreateInfo cacheCreateInfo{
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+    this->_pipelineCache = vk::raii::PipelineCache{this->_device, cacheCreateInfo};
+
+    this->_pipelineCacheStats.warm = !initialData.empty();
+    this->_pipelineCacheStats.loadedBytes = initialData.size();
+}
+
+void IQM::GPU::VulkanRuntime::savePipelineCache() const {
+    if (!this->_config.pipelineCachePath.has_value() || !*this->_pipelineCache) {
+        return;
+    }
+
+    const auto data = this->_pipelineCache.getData();
+    // nothing new was compiled, skip the write
+    if (this->_pipelineCacheStats.warm && data.size() == this->_pipelineCacheStats.loadedBytes) {
+        return;
+    }
+
+    const auto deviceProperties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto &properties = deviceProperties.get<vk::PhysicalDeviceProperties2>().properties;
+    const auto &idProperties = deviceProperties.get<vk::PhysicalDeviceIDProperties>();
+
+    PipelineCacheFileHeader header{
+        .magic = PIPELINE_CACHE_MAGIC,
+        .dataSize = static_cast<uint32_t>(data.size()),
+        .vendorID = properties.vendorID,
+        .deviceID = properties.deviceID,
+    };
+    memcpy(header.driverUUID, idProperties.driverUUID.data(), VK_UUID_SIZE);
+
+    const std::filesystem::path path = this->_config.pipelineCachePath.value();
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path());
+    }
+
+    // write next to the target and rename, so concurrent runs never see a partial file
+    auto tmpPath = path;
+    tmpPath += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tmpPath);
+            throw std::runtime_error("failed to write " + tmpPath.string());
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+}
+
+std::optional<std::string> IQM::GPU::VulkanRuntimeConfig::defaultWorkgroupSizesDir() {
+    const auto cachePath = defaultPipelineCachePath();
+    if (!cachePath.has_value()) {
+        return std::nullopt;
+    }
+
+    return (std::filesystem::path(cachePath.value()).parent_path() / "workgroups").string();
+}
+
+void IQM::GPU::VulkanRuntime::initWorkgroupSizes() {
+    if (!this->_config.workgroupSizesDir.has_value()) {
+        return;
+    }
+
+    const auto deviceProperties = this->_physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto &properties = deviceProperties.get<vk::PhysicalDeviceProperties2>().properties;
+    const auto &deviceUUID = deviceProperties.get<vk::PhysicalDeviceIDProperties>().deviceUUID;
+
+    // some software implementations leave the UUID zeroed, fall back to the ids and driver version
+    std::string name;
+    if (std::ranges::any_of(deviceUUID, [](const uint8_t byte) { return byte != 0; })) {
+        constexpr auto digits = "0123456789abcdef";
+        for (const auto byte : deviceUUID) {
+            name += digits[byte >> 4];
+            name += digits[byte & 0xF];
+        }
+    } else {
+        name = std::to_string(properties.vendorID) + "-" + std::to_string(properties.deviceID) + "-" + std::to_string(properties.driverVersion);
+    }
+
+    this->_workgroupSizesPath = (std::filesystem::path(this->_config.workgroupSizesDir.value()) / (name + ".txt")).string();
+    this->_workgroupSizes.load(this->_workgroupSizesPath);
+}
+
+IQM::GPU::WorkgroupSize IQM::GPU::VulkanRuntime::workgroupSize(const std::string &kernel, const WorkgroupSize fallback) const {
+    const auto size = this->_workgroupSizes.get(kernel, fallback);
+    // tables copied from another machine with the same device may not fit a different driver
+    if (!this->supportsWorkgroupSize(size)) {
+        return fallback;
+    }
+    return size;
+}
+
+bool IQM::GPU::VulkanRuntime::supportsWorkgroupSize(const WorkgroupSize size) const {
+    const auto limits = this->_physicalDevice.getProperties().limits;
+    return size.x > 0 && size.y > 0
+        && size.x <= limits.maxComputeWorkGroupSize[0]
+        && size.y <= limits.maxComputeWorkGroupSize[1]
+        && size.invocations() <= limits.maxComputeWorkGroupInvocations;
+}
+
+vk::Format IQM::GPU::VulkanRuntime::intermediateFormat(const unsigned channels) const {
+    switch (channels) {
+        case 2:
+            return this->_halfPrecision ? vk::Format::eR16G16Sfloat : vk::Format::eR32G32Sfloat;
+        case 4:
+            return this->_halfPrecision ? vk::Format::eR16G16B16A16Sfloat : vk::Format::eR32G32B32A32Sfloat;
+        default:
+            throw std::runtime_error("no intermediate format with " + std::to_string(channels) + " channels");
+    }
+}
+
+void IQM::GPU::VulkanRuntime::saveWorkgroupSizes() const {
+    if (this->_workgroupSizesPath.empty()) {
+        throw std::runtime_error("tuned workgroup sizes are disabled");
+    }
+
+    this->_workgroupSizes.save(this->_workgroupSizesPath);
+}
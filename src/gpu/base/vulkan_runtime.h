@@ -6,25 +6,129 @@
 #ifndef VULKANRUNTIME_H
 #define VULKANRUNTIME_H
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include "../../input_image.h"
+#include "../../timestamps.h"
+#include "vulkan_allocator.h"
+#include "vulkan_descriptor_allocator.h"
 #include "vulkan_image.h"
+#include "vulkan_image_cache.h"
+#include "vulkan_push_descriptors.h"
+#include "vulkan_staging_ring.h"
+#include "vulkan_runtime_config.h"
+#include "vulkan_specialization.h"
+#include "vulkan_workgroup_sizes.h"
 
 namespace IQM::GPU {
+    struct PipelineCacheStats {
+        // cache data was loaded and accepted by the header validation
+        bool warm = false;
+        size_t loadedBytes = 0;
+        // why the cache file was not used, empty if it was
+        std::string rejectReason;
+        unsigned pipelineCount = 0;
+        std::chrono::duration<double, std::milli> creationTime{};
+    };
+
+    enum class SlotQueue {
+        Compute,
+        Transfer,
+    };
+
+    // caller memory used as a Vulkan buffer; members are destroyed in reverse order,
+    // so the buffer goes before its memory and the host pixels outlive the memory imported from them
+    struct ImportedHostBuffer {
+        std::shared_ptr<const void> pixels;
+        vk::raii::DeviceMemory memory = VK_NULL_HANDLE;
+        vk::raii::Buffer buffer = VK_NULL_HANDLE;
+    };
+
+    /**
+     * One frame in flight, metrics record their work into the command buffers of the slot they are given.
+     * Each slot has its own command pools, so slots can be recorded from different threads at the same time.
+     */
+    struct FrameSlot {
+        unsigned index = 0;
+        vk::raii::CommandPool commandPool = VK_NULL_HANDLE;
+        // only created with a dedicated transfer queue, cmdTransfer comes from commandPool otherwise
+        vk::raii::CommandPool commandPoolTransfer = VK_NULL_HANDLE;
+        std::shared_ptr<vk::raii::CommandBuffer> cmd;
+        std::shared_ptr<vk::raii::CommandBuffer> cmdTransfer;
+        // transient descriptor sets, reset when the slot is acquired
+        std::unique_ptr<VulkanDescriptorAllocator> descriptors;
+        // host memory imported for uploads of this slot, released when the slot is acquired
+        std::vector<ImportedHostBuffer> importedBuffers;
+        // timeline values signaled by the last submissions of this slot, 0 if there were none
+        uint64_t computeValue = 0;
+        uint64_t transferValue = 0;
+        // transfer value the next compute submission waits for, 0 if there is nothing to wait for
+        uint64_t uploadValue = 0;
+        bool acquired = false;
+        // two queries per timer, only created with VulkanRuntimeConfig::gpuTimers
+        vk::raii::QueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<std::string> timerNames;
+        // indices into timerNames, -1 for timers dropped because the pool was full
+        std::vector<int> openTimers;
+    };
+
+    class VulkanRuntime;
+
+    // returns the slot to the ring when destroyed
+    class FrameSlotLease {
+    public:
+        FrameSlotLease(const VulkanRuntime &runtime, FrameSlot &slot) : runtime(&runtime), slot(&slot) {}
+        ~FrameSlotLease();
+        FrameSlotLease(FrameSlotLease &&other) noexcept : runtime(other.runtime), slot(other.slot) { other.slot = nullptr; }
+        FrameSlotLease(const FrameSlotLease &) = delete;
+        FrameSlotLease &operator=(const FrameSlotLease &) = delete;
+        FrameSlotLease &operator=(FrameSlotLease &&) = delete;
+        FrameSlot &operator*() const { return *this->slot; }
+        FrameSlot *operator->() const { return this->slot; }
+    private:
+        const VulkanRuntime *runtime;
+        FrameSlot *slot;
+    };
+
     class VulkanRuntime {
     public:
-        VulkanRuntime();
+        explicit VulkanRuntime(const VulkanRuntimeConfig &config = {});
+        ~VulkanRuntime();
+        VulkanRuntime(const VulkanRuntime &) = delete;
+        VulkanRuntime &operator=(const VulkanRuntime &) = delete;
+        // names of all physical devices, indices match the `device` option of VulkanRuntimeConfig
+        static std::vector<std::string> enumerateDevices();
         [[nodiscard]] vk::raii::ShaderModule createShaderModule(const uint32_t *spvCode, size_t size) const;
         [[nodiscard]] vk::raii::PipelineLayout createPipelineLayout(const std::vector<vk::DescriptorSetLayout> &layouts, const std::vector<vk::PushConstantRange> &ranges) const;
-        [[nodiscard]] vk::raii::Pipeline createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout) const;
-        [[nodiscard]] std::pair<vk::raii::Buffer, vk::raii::DeviceMemory> createBuffer(unsigned bufferSize, vk::BufferUsageFlags bufferFlags, vk::MemoryPropertyFlags memoryFlags) const;
-        [[nodiscard]] VulkanImage createImage(const vk::ImageCreateInfo &imageInfo) const;
-        [[nodiscard]] vk::raii::DescriptorSetLayout createDescLayout(const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub) const;
+        // thread-safe, the pipeline cache is internally synchronized and the stats are guarded by _pipelineStatsMutex
+        // specialization constants are optional, see SpecializationConstants and PipelineVariants
+        [[nodiscard]] vk::raii::Pipeline createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const vk::SpecializationInfo *specialization = nullptr) const;
+        // for shaders where only the workgroup size is specialized, see WorkgroupSize::constants
+        [[nodiscard]] vk::raii::Pipeline createComputePipeline(const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, WorkgroupSize workgroupSize) const;
+        // consistent copy, pipelines may be created concurrently
+        [[nodiscard]] PipelineCacheStats pipelineCacheStats() const;
+        // summed over FrameSlot::descriptors of all slots, where the per frame sets of the metrics come from
+        [[nodiscard]] VulkanDescriptorAllocatorStats slotDescriptorStats() const;
+        // returned buffer is already bound to its memory
+        [[nodiscard]] std::pair<vk::raii::Buffer, VulkanAllocation> createBuffer(vk::DeviceSize bufferSize, vk::BufferUsageFlags bufferFlags, vk::MemoryPropertyFlags memoryFlags) const;
+        [[nodiscard]] VulkanImage createImage(const vk::ImageCreateInfo &imageInfo, vk::MemoryPropertyFlags memoryFlags = vk::MemoryPropertyFlagBits::eDeviceLocal) const;
+        // RGBA8 input written by the host straight into device local memory, nullptr if the device or the size does not allow it
+        [[nodiscard]] std::shared_ptr<VulkanImage> acquireHostInputImage(const vk::ImageCreateInfo &imageInfo) const;
+        // host written input if possible, cached optimal image otherwise
+        [[nodiscard]] std::shared_ptr<VulkanImage> acquireInputImage(const vk::ImageCreateInfo &imageInfo) const;
+        // writes RGBA8 pixels into an input image, directly if it is host visible, otherwise copies them from
+        // the imported input memory or through the upload ring; input must stay alive until the slot is waited for.
+        // returns whether anything was recorded into slot.cmdTransfer, its submission can be skipped if not
+        bool uploadInputImage(FrameSlot &slot, const std::shared_ptr<VulkanImage> &image, const InputImage &input) const;
+        // push layouts can only be used with VK_KHR_push_descriptor, see PushDescriptorLayout
+        [[nodiscard]] vk::raii::DescriptorSetLayout createDescLayout(const std::vector<std::pair<vk::DescriptorType, uint32_t>> &stub, bool push = false) const;
         [[nodiscard]] vk::raii::DescriptorSetLayout createDescLayout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings) const;
         void setImageLayout(const std::shared_ptr<vk::raii::CommandBuffer> &cmd_buf, const vk::raii::Image &image, vk::ImageLayout srcLayout, vk::ImageLayout targetLayout) const;
         static void initImages(const std::shared_ptr<vk::raii::CommandBuffer> &cmd_buf, const std::vector<std::shared_ptr<VulkanImage>> &images);
-        void nuke() const;
         static std::vector<vk::PushConstantRange> createPushConstantRange(unsigned size);
         static std::vector<vk::DescriptorImageInfo> createImageInfos(const std::vector<std::shared_ptr<VulkanImage>> &images);
         static std::pair<uint32_t, uint32_t> compute2DGroupCounts(const int width, const int height, const int tileSize) {
@@ -39,7 +143,34 @@ namespace IQM::GPU {
 
             return std::make_pair(groupsX, groupsY);
         }
-        void waitForFence(const vk::raii::Fence&) const;
+        static std::pair<uint32_t, uint32_t> compute2DGroupCounts(const uint32_t width, const uint32_t height, const WorkgroupSize size) {
+            return std::make_pair((width + size.x - 1) / size.x, (height + size.y - 1) / size.y);
+        }
+        // tuned size of the kernel on this device, fallback if it was not tuned
+        [[nodiscard]] WorkgroupSize workgroupSize(const std::string &kernel, WorkgroupSize fallback) const;
+        // within the compute limits of the device
+        [[nodiscard]] bool supportsWorkgroupSize(WorkgroupSize size) const;
+        // float format with 2 or 4 channels for intermediate images, 16 bit if _halfPrecision is set
+        [[nodiscard]] vk::Format intermediateFormat(unsigned channels) const;
+        // writes _workgroupSizes to the file of this device, see VulkanRuntimeConfig::workgroupSizesDir
+        void saveWorkgroupSizes() const;
+        [[nodiscard]] const VulkanRuntimeConfig &config() const { return this->_config; }
+        // blocks until a slot is free and its previous work has finished
+        [[nodiscard]] FrameSlotLease acquireSlot() const;
+        void releaseSlot(FrameSlot &slot) const;
+        // submits the recorded (and already ended) command buffer of the slot, compute waits for the last transfer
+        // the command buffer must not be recorded again before waitForSlot
+        void submitSlot(FrameSlot &slot, SlotQueue queue = SlotQueue::Compute) const;
+        // blocks until all submitted work of the slot has finished
+        void waitForSlot(FrameSlot &slot) const;
+        // queues are externally synchronized, hold this when using them outside of submitSlot
+        [[nodiscard]] std::unique_lock<std::mutex> lockQueues() const { return std::unique_lock(this->_queueMutex); }
+        [[nodiscard]] unsigned slotCount() const { return this->_slots.size(); }
+        // timers around commands recorded into slot.cmd, no-ops if disabled or unsupported by the queue
+        void beginGpuTimer(FrameSlot &slot, const std::string &name) const;
+        void endGpuTimer(FrameSlot &slot) const;
+        // reads and clears the timers of the slot, all its work has to be finished
+        [[nodiscard]] std::vector<GpuTimestamp> collectGpuTimers(FrameSlot &slot) const;
 
         static vk::WriteDescriptorSet createWriteSet(const vk::DescriptorSet &descSet, uint32_t dstBinding, const std::vector<vk::DescriptorImageInfo> &imgInfos);
         static vk::WriteDescriptorSet createWriteSet(const vk::DescriptorSet &descSet, uint32_t dstBinding, const std::vector<vk::DescriptorBufferInfo> &bufInfos);
@@ -49,22 +180,52 @@ namespace IQM::GPU {
         vk::raii::Context _context;
         // assigned VK_NULL_HANDLE to sidestep accidental usage of deleted constructor
         vk::raii::Instance _instance = VK_NULL_HANDLE;
+        // only with VulkanRuntimeConfig::debugMessenger, declared after the instance so it's destroyed before it
+        vk::raii::DebugUtilsMessengerEXT _debugMessenger = VK_NULL_HANDLE;
         vk::raii::PhysicalDevice _physicalDevice = VK_NULL_HANDLE;
         vk::raii::Device _device = VK_NULL_HANDLE;
+        // declared after device, so it's destroyed before it
+        std::unique_ptr<VulkanAllocator> _allocator;
+        // descriptor sets living as long as their owner, per frame sets come from FrameSlot::descriptors
+        std::unique_ptr<VulkanDescriptorAllocator> _descriptors;
+        // VK_KHR_push_descriptor is enabled, PushDescriptorLayout falls back to update templates otherwise
+        bool _pushDescriptors = false;
+        uint32_t _maxPushDescriptors = 0;
+        // persistently mapped staging memory, host to device and device to host
+        std::unique_ptr<VulkanStagingRing> _uploadRing;
+        std::unique_ptr<VulkanStagingRing> _readbackRing;
+        // images reused between computations of the same resolution
+        std::unique_ptr<VulkanImageCache> _imageCache;
+        // inputs skip the staging copy, see initZeroCopy
+        bool _zeroCopyInputs = false;
+        vk::Extent3D _zeroCopyMaxExtent;
+        // VK_EXT_external_memory_host is enabled, inputs are copied from their own memory instead of a staging buffer
+        bool _externalMemoryHost = false;
+        vk::DeviceSize _minImportedHostPointerAlignment = 0;
+        // compute shaders can use subgroupAdd, see SumReduction
+        bool _subgroupArithmetic = false;
+        uint32_t _subgroupSize = 0;
+        // metrics use 16 bit float intermediates, see intermediateFormat
+        bool _halfPrecision = false;
         std::shared_ptr<vk::raii::Queue> _queue = VK_NULL_HANDLE;
         uint32_t _queueFamilyIndex;
         std::shared_ptr<vk::raii::Queue> _transferQueue = VK_NULL_HANDLE;
         uint32_t _transferQueueFamilyIndex;
+        // runtime's own work (swapchain setup), metrics record into FrameSlots
         std::shared_ptr<vk::raii::CommandPool> _commandPool = VK_NULL_HANDLE;
-        std::shared_ptr<vk::raii::CommandPool> _commandPoolTransfer = VK_NULL_HANDLE;
         std::shared_ptr<vk::raii::CommandBuffer> _cmd_buffer = VK_NULL_HANDLE;
-        std::shared_ptr<vk::raii::CommandBuffer> _cmd_bufferTransfer = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout _descLayoutThreeImage = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout _descLayoutTwoImage = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout _descLayoutOneImage = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout _descLayoutBuffer = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout _descLayoutImageBuffer = VK_NULL_HANDLE;
-        vk::raii::DescriptorPool _descPool = VK_NULL_HANDLE;
+        std::vector<std::unique_ptr<FrameSlot>> _slots;
+        // one timeline per queue, so the signal values increase in the order the queue executes them
+        vk::raii::Semaphore _timelineCompute = VK_NULL_HANDLE;
+        vk::raii::Semaphore _timelineTransfer = VK_NULL_HANDLE;
+        vk::raii::PipelineCache _pipelineCache = VK_NULL_HANDLE;
+        // written by createComputePipeline from any thread, read through pipelineCacheStats()
+        mutable PipelineCacheStats _pipelineCacheStats;
+        mutable std::mutex _pipelineStatsMutex;
+        // loaded for the selected device, modified by the autotuner; metrics read it when they create their pipelines
+        WorkgroupSizes _workgroupSizes;
+        // file of the selected device, empty if tuned sizes are disabled
+        std::string _workgroupSizesPath;
 
 #ifdef PROFILE
         void createSwapchain(vk::SurfaceKHR surface);
@@ -78,7 +239,38 @@ namespace IQM::GPU {
     private:
         void initQueues();
         void initDescriptors();
-        static std::vector<const char *> getLayers();
+        void initStaging();
+        void initZeroCopy();
+        void initSlots(int computeQueueIndex, int transferQueueIndex, bool dedicatedTransferQueue);
+        [[nodiscard]] const vk::raii::Buffer *importHostPixels(FrameSlot &slot, const InputImage &input) const;
+        void initPipelineCache();
+        void savePipelineCache() const;
+        void initWorkgroupSizes();
+        void initDebugMessenger();
+        // prepended to the driver blob, the driver header alone does not identify the driver version
+        struct PipelineCacheFileHeader {
+            uint32_t magic;
+            uint32_t dataSize;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint8_t driverUUID[VK_UUID_SIZE];
+        };
+        static constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x31435149; // "IQC1"
+
+        VulkanRuntimeConfig _config;
+        static constexpr unsigned MAX_GPU_TIMERS = 128;
+        bool _gpuTimers = false;
+        float _timestampPeriod = 0;
+        uint64_t _timestampMask = 0;
+        mutable std::mutex _slotMutex;
+        mutable std::condition_variable _slotReleased;
+        mutable unsigned _nextSlot = 0;
+        mutable std::mutex _queueMutex;
+        // last values handed out for the timelines, guarded by _queueMutex
+        mutable uint64_t _timelineComputeValue = 0;
+        mutable uint64_t _timelineTransferValue = 0;
+        // validation layer if the config asks for it and it is installed
+        static std::vector<const char *> getLayers(const VulkanRuntimeConfig &config);
     };
 }
 
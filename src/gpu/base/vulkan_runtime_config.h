@@ -0,0 +1,65 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_RUNTIME_CONFIG_H
+#define VULKAN_RUNTIME_CONFIG_H
+
+#include <optional>
+#include <string>
+
+namespace IQM::GPU {
+    struct VulkanRuntimeConfig {
+        // device index or case-insensitive part of its name, the best scoring device is used if not set
+        std::optional<std::string> device;
+        // pipeline cache is not loaded nor saved if not set
+        std::optional<std::string> pipelineCachePath;
+        // directory with the tuned workgroup sizes of each device, kernels use their default sizes if not set
+        std::optional<std::string> workgroupSizesDir;
+        // number of FrameSlots, each can have its own work in flight
+        unsigned framesInFlight = 2;
+        // records GPU timestamps around metric passes, see VulkanRuntime::beginGpuTimer
+        bool gpuTimers = false;
+        // inputs are written straight into host visible device local memory if the device has enough of it
+        bool zeroCopyInputs = true;
+        // otherwise inputs are imported with VK_EXT_external_memory_host if possible, staged if not
+        bool importHostMemory = true;
+        // sums use subgroup operations where the device supports them, shared memory trees otherwise
+        bool subgroupReductions = true;
+        // bandwidth bound intermediate images are stored as 16 bit floats, shaders still compute in 32 bits
+        bool halfPrecision = false;
+
+        // debugging aids, all of them are off in the default production profile
+        // VK_LAYER_KHRONOS_validation, skipped with a warning if it is not installed
+        bool validation = false;
+        // VK_EXT_debug_utils with a messenger printing validation messages to stderr
+        bool debugMessenger = false;
+        // RenderDoc captures around the computation, only in builds with ENABLE_RENDERDOC
+        bool renderDoc = false;
+
+        // --debug-gpu, turns on all debugging aids
+        void enableDebugProfile() {
+            this->validation = true;
+            this->debugMessenger = true;
+            this->renderDoc = true;
+        }
+        // reported together with the startup time, "custom" if only some debugging aids are enabled
+        [[nodiscard]] std::string profileName() const {
+            if (!this->validation && !this->debugMessenger && !this->renderDoc) {
+                return "production";
+            }
+            if (this->validation && this->debugMessenger && this->renderDoc) {
+                return "debug";
+            }
+            return "custom";
+        }
+
+        // $XDG_CACHE_HOME/iqm/pipeline_cache.bin, falls back to ~/.cache
+        static std::optional<std::string> defaultPipelineCachePath();
+        // $XDG_CACHE_HOME/iqm/workgroups, falls back to ~/.cache
+        static std::optional<std::string> defaultWorkgroupSizesDir();
+    };
+}
+
+#endif //VULKAN_RUNTIME_CONFIG_H
@@ -0,0 +1,94 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_specialization.h"
+
+#include <bit>
+
+#include "vulkan_runtime.h"
+
+IQM::GPU::SpecializationConstants &IQM::GPU::SpecializationConstants::add(const int32_t value) {
+    return this->addRaw(std::bit_cast<uint32_t>(value));
+}
+
+IQM::GPU::SpecializationConstants &IQM::GPU::SpecializationConstants::add(const uint32_t value) {
+    return this->addRaw(value);
+}
+
+IQM::GPU::SpecializationConstants &IQM::GPU::SpecializationConstants::add(const float value) {
+    return this->addRaw(std::bit_cast<uint32_t>(value));
+}
+
+IQM::GPU::SpecializationConstants &IQM::GPU::SpecializationConstants::add(const bool value) {
+    // bool constants are VkBool32 on the API side
+    return this->addRaw(value ? VK_TRUE : VK_FALSE);
+}
+
+IQM::GPU::SpecializationConstants &IQM::GPU::SpecializationConstants::addRaw(const uint32_t bits) {
+    const auto id = static_cast<uint32_t>(this->_values.size());
+    this->_entries.push_back(vk::SpecializationMapEntry{
+        .constantID = id,
+        .offset = id * static_cast<uint32_t>(sizeof(uint32_t)),
+        .size = sizeof(uint32_t),
+    });
+    this->_values.push_back(bits);
+    return *this;
+}
+
+vk::SpecializationInfo IQM::GPU::SpecializationConstants::info() const {
+    return vk::SpecializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(this->_entries.size()),
+        .pMapEntries = this->_entries.data(),
+        .dataSize = this->_values.size() * sizeof(uint32_t),
+        .pData = this->_values.data(),
+    };
+}
+
+IQM::GPU::PipelineVariants::PipelineVariants(const size_t maxVariants): _maxVariants(maxVariants) {}
+
+void IQM::GPU::PipelineVariants::preload(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants) {
+    if (const auto it = this->_pipelines.find(constants.values()); it != this->_pipelines.end()) {
+        it->second.preloaded = true;
+        return;
+    }
+
+    this->create(runtime, shader, layout, constants).preloaded = true;
+}
+
+const vk::raii::Pipeline &IQM::GPU::PipelineVariants::get(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants) {
+    if (const auto it = this->_pipelines.find(constants.values()); it != this->_pipelines.end()) {
+        it->second.lastUse = ++this->_useCounter;
+        return it->second.pipeline;
+    }
+
+    if (this->_pipelines.size() >= this->_maxVariants) {
+        this->evictLeastRecentlyUsed();
+    }
+
+    return this->create(runtime, shader, layout, constants).pipeline;
+}
+
+IQM::GPU::PipelineVariants::Variant &IQM::GPU::PipelineVariants::create(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants) {
+    const auto info = constants.info();
+    auto [it, _] = this->_pipelines.emplace(constants.values(), Variant{
+        .pipeline = runtime.createComputePipeline(shader, layout, &info),
+        .lastUse = ++this->_useCounter,
+    });
+    return it->second;
+}
+
+void IQM::GPU::PipelineVariants::evictLeastRecentlyUsed() {
+    auto oldest = this->_pipelines.end();
+    for (auto it = this->_pipelines.begin(); it != this->_pipelines.end(); ++it) {
+        if (!it->second.preloaded && (oldest == this->_pipelines.end() || it->second.lastUse < oldest->second.lastUse)) {
+            oldest = it;
+        }
+    }
+
+    // only preloaded variants left, those stay even above the limit
+    if (oldest != this->_pipelines.end()) {
+        this->_pipelines.erase(oldest);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_SPECIALIZATION_H
+#define VULKAN_SPECIALIZATION_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+
+    /**
+     * Values for the specialization constants of a shader, constant_id is the order they were added in.
+     * All of them are 4 bytes wide, which covers the int, uint, float and bool constants the shaders use.
+     */
+    class SpecializationConstants {
+    public:
+        SpecializationConstants &add(int32_t value);
+        SpecializationConstants &add(uint32_t value);
+        SpecializationConstants &add(float value);
+        SpecializationConstants &add(bool value);
+
+        // points into this object, valid until it is modified or destroyed
+        [[nodiscard]] vk::SpecializationInfo info() const;
+        // raw values, two sets of constants specialize a shader the same way if these are equal
+        [[nodiscard]] const std::vector<uint32_t> &values() const { return this->_values; }
+
+    private:
+        SpecializationConstants &addRaw(uint32_t bits);
+
+        std::vector<uint32_t> _values;
+        std::vector<vk::SpecializationMapEntry> _entries;
+    };
+
+    /**
+     * Pipelines of a single shader and layout, specialized for different constants.
+     * A variant is created the first time its constants are used and kept after that,
+     * so parameters repeating between computations only cost a lookup.
+     *
+     * At most maxVariants are kept, when a new one does not fit the least recently used variant
+     * that was not preloaded is destroyed, so clients cycling through parameters cannot grow it without a limit.
+     */
+    class PipelineVariants {
+    public:
+        static constexpr size_t DEFAULT_MAX_VARIANTS = 8;
+
+        explicit PipelineVariants(size_t maxVariants = DEFAULT_MAX_VARIANTS);
+
+        // for the constants most computations use, created right away and never destroyed by get()
+        void preload(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants);
+        // valid until the next get(), all work using the other variants must have finished before calling it
+        [[nodiscard]] const vk::raii::Pipeline &get(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants);
+        [[nodiscard]] size_t size() const { return this->_pipelines.size(); }
+
+    private:
+        struct Variant {
+            vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
+            uint64_t lastUse = 0;
+            bool preloaded = false;
+        };
+
+        Variant &create(const VulkanRuntime &runtime, const vk::raii::ShaderModule &shader, const vk::raii::PipelineLayout &layout, const SpecializationConstants &constants);
+        void evictLeastRecentlyUsed();
+
+        size_t _maxVariants;
+        uint64_t _useCounter = 0;
+        // std::map keeps references to pipelines valid while new variants are added
+        std::map<std::vector<uint32_t>, Variant> _pipelines;
+    };
+}
+
+#endif //VULKAN_SPECIALIZATION_H
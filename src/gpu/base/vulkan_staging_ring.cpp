@@ -0,0 +1,138 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_staging_ring.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "vulkan_runtime.h"
+
+static vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+IQM::GPU::VulkanStagingRing::VulkanStagingRing(const VulkanRuntime &runtime, const vk::BufferUsageFlags usage, const vk::MemoryPropertyFlags memoryFlags, const vk::DeviceSize size):
+_runtime(runtime),
+_usage(usage),
+_memoryFlags(memoryFlags),
+_initialSize(std::max<vk::DeviceSize>(size, 1))
+{}
+
+std::unique_ptr<IQM::GPU::VulkanStagingBlock> IQM::GPU::VulkanStagingRing::createBlock(const vk::DeviceSize size) const {
+    auto block = std::make_unique<VulkanStagingBlock>();
+    auto [buffer, memory] = this->_runtime.createBuffer(size, this->_usage, this->_memoryFlags);
+    if (memory.map() == nullptr) {
+        throw std::runtime_error("Staging ring memory is not host visible");
+    }
+    block->buffer = std::move(buffer);
+    block->memory = std::move(memory);
+    block->size = size;
+    return block;
+}
+
+bool IQM::GPU::VulkanStagingRing::tryReserve(VulkanStagingBlock &block, const vk::DeviceSize size, const vk::DeviceSize alignment, vk::DeviceSize &offset) {
+    if (block.ranges.empty()) {
+        block.head = 0;
+    }
+
+    if (block.ranges.empty() || block.head > block.ranges.front().offset) {
+        // free space is after the head and before the oldest range, at the start of the buffer
+        const auto aligned = alignUp(block.head, alignment);
+        if (aligned + size <= block.size) {
+            offset = aligned;
+            return true;
+        }
+        if (!block.ranges.empty() && size <= block.ranges.front().offset) {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // already wrapped around, free space is only between the head and the oldest range
+    const auto aligned = alignUp(block.head, alignment);
+    if (aligned + size <= block.ranges.front().offset) {
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+IQM::GPU::StagingRange IQM::GPU::VulkanStagingRing::reserve(const FrameSlot &slot, vk::DeviceSize size, vk::DeviceSize alignment) {
+    std::lock_guard lock(this->_mutex);
+
+    // empty ranges would be indistinguishable from a full ring
+    size = std::max<vk::DeviceSize>(size, 1);
+    alignment = std::max<vk::DeviceSize>(alignment, 1);
+
+    vk::DeviceSize offset = 0;
+    if (this->_blocks.empty() || !tryReserve(*this->_blocks.back(), size, alignment, offset)) {
+        auto blockSize = this->_initialSize;
+        if (!this->_blocks.empty()) {
+            blockSize = this->_blocks.back()->size * 2;
+            this->_stats.growths++;
+        }
+        this->_blocks.push_back(this->createBlock(std::max(blockSize, size)));
+        this->_stats.blockCount++;
+        this->_stats.bytesReserved += this->_blocks.back()->size;
+
+        if (!tryReserve(*this->_blocks.back(), size, alignment, offset)) {
+            throw std::runtime_error("Staging reservation does not fit into an empty ring");
+        }
+    }
+
+    auto &block = *this->_blocks.back();
+    block.head = offset + size;
+    block.ranges.push_back(VulkanStagingBlock::Range{
+        .offset = offset,
+        .size = size,
+        .slot = slot.index,
+        .reclaimed = false,
+    });
+
+    this->_stats.reservations++;
+    this->_stats.bytesInFlight += size;
+    this->_stats.peakBytesInFlight = std::max(this->_stats.peakBytesInFlight, this->_stats.bytesInFlight);
+
+    StagingRange range;
+    range._block = &block;
+    range._offset = offset;
+    range._size = size;
+    return range;
+}
+
+void IQM::GPU::VulkanStagingRing::reclaim(const FrameSlot &slot) {
+    std::lock_guard lock(this->_mutex);
+
+    for (auto &block : this->_blocks) {
+        for (auto &range : block->ranges) {
+            if (range.slot == slot.index && !range.reclaimed) {
+                range.reclaimed = true;
+                this->_stats.bytesInFlight -= range.size;
+            }
+        }
+        // ranges of other slots may still be in use, the space behind them is freed once they are reclaimed too
+        while (!block->ranges.empty() && block->ranges.front().reclaimed) {
+            block->ranges.pop_front();
+        }
+    }
+
+    // only the newest block takes new reservations, older ones are useless once empty
+    for (size_t i = 0; i + 1 < this->_blocks.size();) {
+        if (this->_blocks[i]->ranges.empty()) {
+            this->_stats.bytesReserved -= this->_blocks[i]->size;
+            this->_stats.blockCount--;
+            this->_blocks.erase(this->_blocks.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            i++;
+        }
+    }
+}
+
+IQM::GPU::VulkanStagingRingStats IQM::GPU::VulkanStagingRing::stats() const {
+    std::lock_guard lock(this->_mutex);
+    return this->_stats;
+}
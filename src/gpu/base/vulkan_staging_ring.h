@@ -0,0 +1,119 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_STAGING_RING_H
+#define VULKAN_STAGING_RING_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vulkan_allocator.h"
+
+namespace IQM::GPU {
+    class VulkanRuntime;
+    struct FrameSlot;
+
+    struct VulkanStagingRingStats {
+        // ring buffers currently alive, older ones are kept until all their ranges are reclaimed
+        uint64_t blockCount = 0;
+        // times a reservation did not fit and a larger ring buffer was created
+        uint64_t growths = 0;
+        // number of reserve() calls over the lifetime of the ring
+        uint64_t reservations = 0;
+        vk::DeviceSize bytesReserved = 0;
+        vk::DeviceSize bytesInFlight = 0;
+        vk::DeviceSize peakBytesInFlight = 0;
+    };
+
+    // one ring buffer of VulkanStagingRing, mapped for its whole lifetime
+    struct VulkanStagingBlock {
+        vk::raii::Buffer buffer = VK_NULL_HANDLE;
+        VulkanAllocation memory = VK_NULL_HANDLE;
+        vk::DeviceSize size = 0;
+        // next free byte, wraps around to the start once the end is reached
+        vk::DeviceSize head = 0;
+
+        struct Range {
+            vk::DeviceSize offset;
+            vk::DeviceSize size;
+            unsigned slot;
+            bool reclaimed;
+        };
+        // in reservation order, the front is the oldest range still in use
+        std::deque<Range> ranges;
+    };
+
+    /**
+     * Part of a staging ring reserved for a single transfer.
+     * Valid until the slot it was reserved for is acquired again, the ring reuses the memory after that.
+     */
+    class StagingRange {
+    public:
+        StagingRange() = default;
+        // allows the same `= VK_NULL_HANDLE` member initialization as raii handles
+        StagingRange(std::nullptr_t) {}
+
+        [[nodiscard]] const vk::raii::Buffer &buffer() const { return this->_block->buffer; }
+        [[nodiscard]] vk::DeviceSize offset() const { return this->_offset; }
+        [[nodiscard]] vk::DeviceSize size() const { return this->_size; }
+        [[nodiscard]] void *data() const { return static_cast<char *>(this->_block->memory.map()) + this->_offset; }
+        // after host writes to an upload range, before the transfer is submitted
+        void flush() const { this->_block->memory.flush(this->_offset, this->_size); }
+        // after the readback finished, before the host reads the range
+        void invalidate() const { this->_block->memory.invalidate(this->_offset, this->_size); }
+
+    private:
+        friend class VulkanStagingRing;
+        VulkanStagingBlock *_block = nullptr;
+        vk::DeviceSize _offset = 0;
+        vk::DeviceSize _size = 0;
+    };
+
+    /**
+     * Persistently mapped host visible buffer, handing out ranges for uploads or readbacks
+     * so metrics do not create and map a new staging buffer for every transfer.
+     *
+     * Ranges are reserved for a frame slot and reclaimed when the slot is acquired again,
+     * acquireSlot() waits for the slot's timeline values first, so the GPU is done with them by then.
+     * A reservation that does not fit into the free part of the ring creates a new, larger ring buffer,
+     * the old one is destroyed once its last range is reclaimed.
+     */
+    class VulkanStagingRing {
+    public:
+        static constexpr vk::DeviceSize DEFAULT_SIZE = 32 * 1024 * 1024;
+        // enough for copies to and from any format the metrics use
+        static constexpr vk::DeviceSize DEFAULT_ALIGNMENT = 16;
+
+        VulkanStagingRing(const VulkanRuntime &runtime, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags memoryFlags, vk::DeviceSize size = DEFAULT_SIZE);
+        VulkanStagingRing(const VulkanStagingRing &) = delete;
+        VulkanStagingRing &operator=(const VulkanStagingRing &) = delete;
+
+        [[nodiscard]] StagingRange reserve(const FrameSlot &slot, vk::DeviceSize size, vk::DeviceSize alignment = DEFAULT_ALIGNMENT);
+        // all earlier reservations for the slot are no longer used, neither by the GPU nor by the host
+        void reclaim(const FrameSlot &slot);
+
+        [[nodiscard]] VulkanStagingRingStats stats() const;
+
+    private:
+        [[nodiscard]] std::unique_ptr<VulkanStagingBlock> createBlock(vk::DeviceSize size) const;
+        static bool tryReserve(VulkanStagingBlock &block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize &offset);
+
+        const VulkanRuntime &_runtime;
+        vk::BufferUsageFlags _usage;
+        vk::MemoryPropertyFlags _memoryFlags;
+        vk::DeviceSize _initialSize;
+        // newest last, only the newest one takes new reservations
+        std::vector<std::unique_ptr<VulkanStagingBlock>> _blocks;
+        VulkanStagingRingStats _stats;
+        mutable std::mutex _mutex;
+    };
+}
+
+#endif //VULKAN_STAGING_RING_H
@@ -0,0 +1,76 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "vulkan_workgroup_sizes.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+IQM::GPU::SpecializationConstants IQM::GPU::WorkgroupSize::constants() const {
+    SpecializationConstants constants;
+    constants.add(this->x).add(this->y);
+    return constants;
+}
+
+IQM::GPU::WorkgroupSize IQM::GPU::WorkgroupSizes::get(const std::string &kernel, const WorkgroupSize fallback) const {
+    if (const auto it = this->_sizes.find(kernel); it != this->_sizes.end()) {
+        return it->second;
+    }
+    return fallback;
+}
+
+void IQM::GPU::WorkgroupSizes::set(const std::string &kernel, const WorkgroupSize size) {
+    this->_sizes[kernel] = size;
+}
+
+bool IQM::GPU::WorkgroupSizes::load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        std::string kernel;
+        WorkgroupSize size;
+        if (stream >> kernel >> size.x >> size.y && size.x > 0 && size.y > 0) {
+            this->_sizes[kernel] = size;
+        }
+    }
+
+    return true;
+}
+
+void IQM::GPU::WorkgroupSizes::save(const std::string &path) const {
+    const std::filesystem::path target = path;
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path());
+    }
+
+    // same as the pipeline cache, concurrent runs never see a partial file
+    auto tmpPath = target;
+    tmpPath += ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << "# kernel x y, written by IQM --autotune" << std::endl;
+        for (const auto &[kernel, size] : this->_sizes) {
+            file << kernel << " " << size.x << " " << size.y << std::endl;
+        }
+        if (!file) {
+            file.close();
+            std::filesystem::remove(tmpPath);
+            throw std::runtime_error("failed to write " + tmpPath.string());
+        }
+    }
+    std::filesystem::rename(tmpPath, target);
+}
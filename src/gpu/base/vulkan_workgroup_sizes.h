@@ -0,0 +1,46 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef VULKAN_WORKGROUP_SIZES_H
+#define VULKAN_WORKGROUP_SIZES_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "vulkan_specialization.h"
+
+namespace IQM::GPU {
+    struct WorkgroupSize {
+        uint32_t x = 1;
+        uint32_t y = 1;
+
+        // for shaders declaring local_size_x_id = 0 and local_size_y_id = 1, their other constants follow
+        [[nodiscard]] SpecializationConstants constants() const;
+        [[nodiscard]] uint32_t invocations() const { return this->x * this->y; }
+        bool operator==(const WorkgroupSize &) const = default;
+    };
+
+    /**
+     * Workgroup sizes picked by `IQM --autotune` for a single device, keyed by kernel name.
+     * Kernels missing from the table use the size they were written for.
+     * Stored as text, one `name x y` line per kernel.
+     */
+    class WorkgroupSizes {
+    public:
+        [[nodiscard]] WorkgroupSize get(const std::string &kernel, WorkgroupSize fallback) const;
+        void set(const std::string &kernel, WorkgroupSize size);
+        [[nodiscard]] const std::map<std::string, WorkgroupSize> &entries() const { return this->_sizes; }
+
+        // returns false if there is no table at the path, malformed lines are skipped
+        bool load(const std::string &path);
+        void save(const std::string &path) const;
+
+    private:
+        std::map<std::string, WorkgroupSize> _sizes;
+    };
+}
+
+#endif //VULKAN_WORKGROUP_SIZES_H
@@ -30,194 +30,123 @@ static uint32_t srcErrCombine[] =
 #include <flip/combine_error_maps.inc>
 ;
 
-IQM::GPU::FLIP::FLIP(const VulkanRuntime &runtime): colorPipeline(runtime) {
-    this->inputConvertKernel = runtime.createShaderModule(srcInputConvert, sizeof(srcInputConvert));
+static uint32_t srcInputConvertFp16[] =
+#include <flip/srgb_to_ycxcz_fp16.inc>
+;
+
+static uint32_t srcFeatureFilterHorizontalFp16[] =
+#include <flip/feature_filter_horizontal_fp16.inc>
+;
+
+static uint32_t srcFeatureDetectFp16[] =
+#include <flip/feature_detection_fp16.inc>
+;
+
+static IQM::GPU::SpecializationConstants featureFilterConstants(const float pixels_per_degree) {
+    IQM::GPU::SpecializationConstants constants;
+    constants.add(pixels_per_degree);
+    return constants;
+}
+
+double IQM::GPU::FLIPArguments::pixelsPerDegree() const {
+    return this->monitor_distance * (this->monitor_resolution_x / this->monitor_width) * (std::numbers::pi / 180.0);
+}
+
+IQM::GPU::FLIP::FLIP(const VulkanRuntime &runtime, const FLIPArguments &expected): colorPipeline(runtime, static_cast<float>(expected.pixelsPerDegree())) {
+    // YCxCz and filtered images are 16 bit, filters and error maps stay 32 bit
+    if (runtime._halfPrecision) {
+        this->inputConvertKernel = runtime.createShaderModule(srcInputConvertFp16, sizeof(srcInputConvertFp16));
+        this->featureFilterHorizontalKernel = runtime.createShaderModule(srcFeatureFilterHorizontalFp16, sizeof(srcFeatureFilterHorizontalFp16));
+        this->featureDetectKernel = runtime.createShaderModule(srcFeatureDetectFp16, sizeof(srcFeatureDetectFp16));
+    } else {
+        this->inputConvertKernel = runtime.createShaderModule(srcInputConvert, sizeof(srcInputConvert));
+        this->featureFilterHorizontalKernel = runtime.createShaderModule(srcFeatureFilterHorizontal, sizeof(srcFeatureFilterHorizontal));
+        this->featureDetectKernel = runtime.createShaderModule(srcFeatureDetect, sizeof(srcFeatureDetect));
+    }
     this->featureFilterCreateKernel = runtime.createShaderModule(srcFeatureFilterCreate, sizeof(srcFeatureFilterCreate));
     this->featureFilterNormalizeKernel = runtime.createShaderModule(srcFeatureFilterNormalize, sizeof(srcFeatureFilterNormalize));
-    this->featureFilterHorizontalKernel = runtime.createShaderModule(srcFeatureFilterHorizontal, sizeof(srcFeatureFilterHorizontal));
-    this->featureDetectKernel = runtime.createShaderModule(srcFeatureDetect, sizeof(srcFeatureDetect));
     this->errorCombineKernel = runtime.createShaderModule(srcErrCombine, sizeof(srcErrCombine));
 
-    this->inputConvertDescSetLayout = runtime.createDescLayout({
+    this->inputConvertLayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 2},
-    });
+    }, {}};
+    this->inputConvertSize = runtime.workgroupSize("flip_ycxcz", {16, 16});
+    this->inputConvertPipeline = runtime.createComputePipeline(this->inputConvertKernel, this->inputConvertLayout.pipelineLayout(), this->inputConvertSize);
 
-    this->featureFilterCreateDescSetLayout = runtime.createDescLayout({
+    this->featureFilterCreateLayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 1},
-    });
+    }, {}};
+    this->featureFilterNormalizePipeline = runtime.createComputePipeline(this->featureFilterNormalizeKernel, this->featureFilterCreateLayout.pipelineLayout());
+    this->featureFilterCreatePipelines.preload(runtime, this->featureFilterCreateKernel, this->featureFilterCreateLayout.pipelineLayout(), featureFilterConstants(static_cast<float>(expected.pixelsPerDegree())));
 
-    this->featureFilterHorizontalDescSetLayout = runtime.createDescLayout({
+    this->featureFilterHorizontalLayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 1},
-    });
+    }, {}};
+    this->featureFilterHorizontalSize = runtime.workgroupSize("flip_feature_filter_horizontal", {16, 16});
+    this->featureFilterHorizontalPipeline = runtime.createComputePipeline(this->featureFilterHorizontalKernel, this->featureFilterHorizontalLayout.pipelineLayout(), this->featureFilterHorizontalSize);
 
-    this->errorCombineDescSetLayout = runtime.createDescLayout({
+    const std::vector<std::pair<vk::DescriptorType, uint32_t>> errorCombineBindings = {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 1},
         {vk::DescriptorType::eStorageImage, 1},
-    });
-
-    const std::vector descLayouts = {
-        *this->inputConvertDescSetLayout,
-    };
-
-    const std::vector descLayoutsFeatureFilters = {
-        *this->featureFilterCreateDescSetLayout,
-    };
-
-    const std::vector descLayoutFilterHorizontal = {
-        *this->featureFilterHorizontalDescSetLayout,
-    };
-
-    const std::vector descLayoutErrorCombine = {
-        *this->errorCombineDescSetLayout,
-    };
-
-    const std::vector allDescLayouts = {
-        *this->inputConvertDescSetLayout,
-        *this->featureFilterCreateDescSetLayout,
-        *this->featureFilterHorizontalDescSetLayout,
-        *this->errorCombineDescSetLayout,
-        *this->errorCombineDescSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(allDescLayouts.size()),
-        .pSetLayouts = allDescLayouts.data()
     };
 
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->inputConvertDescSet = std::move(sets[0]);
-    this->featureFilterCreateDescSet = std::move(sets[1]);
-    this->featureFilterHorizontalDescSet = std::move(sets[2]);
-    this->featureDetectDescSet = std::move(sets[3]);
-    this->errorCombineDescSet = std::move(sets[4]);
-
-    this->inputConvertLayout = runtime.createPipelineLayout(descLayouts, {});
-    this->inputConvertPipeline = runtime.createComputePipeline(this->inputConvertKernel, this->inputConvertLayout);
-
-    const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(float));
-    this->featureFilterCreateLayout = runtime.createPipelineLayout(descLayoutsFeatureFilters, ranges);
-    this->featureFilterCreatePipeline = runtime.createComputePipeline(this->featureFilterCreateKernel, this->featureFilterCreateLayout);
-    this->featureFilterNormalizePipeline = runtime.createComputePipeline(this->featureFilterNormalizeKernel, this->featureFilterCreateLayout);
-
-    this->featureFilterHorizontalLayout = runtime.createPipelineLayout(descLayoutFilterHorizontal, {});
-    this->featureFilterHorizontalPipeline = runtime.createComputePipeline(this->featureFilterHorizontalKernel, this->featureFilterHorizontalLayout);
-
-    this->featureDetectLayout = runtime.createPipelineLayout(descLayoutErrorCombine, {});
-    this->featureDetectPipeline = runtime.createComputePipeline(this->featureDetectKernel, this->featureDetectLayout);
+    this->featureDetectLayout = PushDescriptorLayout{runtime, errorCombineBindings, {}};
+    this->featureDetectSize = runtime.workgroupSize("flip_feature_detect", {16, 16});
+    this->featureDetectPipeline = runtime.createComputePipeline(this->featureDetectKernel, this->featureDetectLayout.pipelineLayout(), this->featureDetectSize);
 
-    this->errorCombineLayout = runtime.createPipelineLayout(descLayoutErrorCombine, {});
-    this->errorCombinePipeline = runtime.createComputePipeline(this->errorCombineKernel, this->errorCombineLayout);
-
-    this->uploadDone = runtime._device.createSemaphore(vk::SemaphoreCreateInfo{});
-    this->computeDone = runtime._device.createSemaphore(vk::SemaphoreCreateInfo{});
-    this->transferFence = runtime._device.createFence(vk::FenceCreateInfo{});
+    this->errorCombineLayout = PushDescriptorLayout{runtime, errorCombineBindings, {}};
+    this->errorCombineSize = runtime.workgroupSize("flip_error_combine", {16, 16});
+    this->errorCombinePipeline = runtime.createComputePipeline(this->errorCombineKernel, this->errorCombineLayout.pipelineLayout(), this->errorCombineSize);
 }
 
-IQM::GPU::FLIPResult IQM::GPU::FLIP::computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref, const FLIPArguments &args) {
+IQM::GPU::FLIPResult IQM::GPU::FLIP::computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref, const FLIPArguments &args) {
     FLIPResult res;
-    runtime._device.resetFences({this->transferFence});
 
-    auto pixels_per_degree = args.monitor_distance * (args.monitor_resolution_x / args.monitor_width) * (std::numbers::pi / 180.0);
+    auto pixels_per_degree = args.pixelsPerDegree();
     int gaussian_kernel_size = 2 * static_cast<int>(std::ceil(3 * 0.5 * 0.082 * pixels_per_degree)) + 1;
     int spatial_kernel_size = 2 * static_cast<int>(std::ceil(3 * std::sqrt(0.04 / (2.0 * std::pow(std::numbers::pi, 2.0))) * pixels_per_degree)) + 1;
 
-    this->startTransferCommandList(runtime);
-    this->prepareImageStorage(runtime, image, ref, gaussian_kernel_size);
-    this->colorPipeline.prepareStorage(runtime, spatial_kernel_size, this->imageParameters);
-    this->endTransferCommandList(runtime);
+    this->startTransferCommandList(runtime, slot);
+    this->prepareImageStorage(runtime, slot, image, ref, gaussian_kernel_size);
+    this->colorPipeline.prepareStorage(runtime, this->graph, spatial_kernel_size, this->imageParameters);
+    this->endTransferCommandList(runtime, slot);
     res.timestamps.mark("Image storage prepared");
 
-    this->setUpDescriptors(runtime);
-    this->colorPipeline.setUpDescriptors(runtime, this->imageYccInput, this->imageYccRef);
-    res.timestamps.mark("Descriptors set up");
-
-    this->convertToYCxCz(runtime);
+    this->convertToYCxCz();
     this->createFeatureFilters(runtime, pixels_per_degree, gaussian_kernel_size);
-    this->computeFeatureErrorMap(runtime);
-    this->colorPipeline.prefilter(runtime, this->imageParameters, pixels_per_degree);
-    this->colorPipeline.computeErrorMap(runtime, this->imageParameters);
-    this->computeFinalErrorMap(runtime);
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
+    this->computeFeatureErrorMap();
+    this->colorPipeline.prefilter(runtime, this->graph, this->imageYccInput, this->imageYccRef, this->imageParameters, pixels_per_degree);
+    this->colorPipeline.computeErrorMap(this->graph, this->imageParameters);
+    this->computeFinalErrorMap();
+    this->graph.compile(runtime);
+    res.timestamps.mark("Graph compiled");
 
-    auto mask = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eComputeShader};
-    const vk::SubmitInfo submitInfo{
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &*this->uploadDone,
-        .pWaitDstStageMask = &mask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data(),
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &*this->computeDone
+    const vk::CommandBufferBeginInfo beginInfo = {
+        .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
+    slot.cmd->begin(beginInfo);
+    this->graph.execute(runtime, slot);
+    slot.cmd->end();
 
     res.timestamps.mark("GPU work prepared");
 
-    runtime._queue->submit(submitInfo, {});
-    runtime._device.waitIdle();
-    //runtime.waitForFence(this->transferFence);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
+    res.timestamps.addGpu(runtime.collectGpuTimers(slot));
 
     res.timestamps.mark("GPU work done");
 
     return res;
 }
 
-void IQM::GPU::FLIP::prepareImageStorage(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref, int kernel_size) {
-    // always 4 channels on input, with 1B per channel
-    const auto size = image.width * image.height * 4;
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    auto [stgRefBuf, stgRefMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-
-    const auto colorMapSize = 256 * 4 * sizeof(float);
-    auto [stgColorMapBuf, stgColorMapMem] = runtime.createBuffer(
-        colorMapSize,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-
+void IQM::GPU::FLIP::prepareImageStorage(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref, int kernel_size) {
     this->imageParameters.height = image.height;
     this->imageParameters.width = image.width;
 
-    stgBuf.bindMemory(stgMem, 0);
-    stgRefBuf.bindMemory(stgRefMem, 0);
-    stgColorMapBuf.bindMemory(stgColorMapMem, 0);
-
-    void * inBufData = stgMem.mapMemory(0, size, {});
-    memcpy(inBufData, image.data.data(), size);
-    stgMem.unmapMemory();
-
-    inBufData = stgRefMem.mapMemory(0, size, {});
-    memcpy(inBufData, ref.data.data(), size);
-    stgRefMem.unmapMemory();
-
-    inBufData = stgColorMapMem.mapMemory(0, colorMapSize, {});
-    memcpy(inBufData, viridis, colorMapSize);
-    stgColorMapMem.unmapMemory();
-
-    this->stgInput = std::move(stgBuf);
-    this->stgInputMemory = std::move(stgMem);
-    this->stgRef = std::move(stgRefBuf);
-    this->stgRefMemory = std::move(stgRefMem);
-    this->stgColorMap = std::move(stgColorMapBuf);
-    this->stgColorMapMemory = std::move(stgColorMapMem);
-
     vk::ImageCreateInfo srcImageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -234,9 +163,12 @@ void IQM::GPU::FLIP::prepareImageStorage(const VulkanRuntime &runtime, const Inp
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    vk::ImageCreateInfo yccImageInfo {srcImageInfo};
-    yccImageInfo.format = vk::Format::eR32G32B32A32Sfloat;
-    yccImageInfo.usage = vk::ImageUsageFlagBits::eStorage;
+    vk::ImageCreateInfo outImageInfo {srcImageInfo};
+    outImageInfo.format = vk::Format::eR32G32B32A32Sfloat;
+    outImageInfo.usage = vk::ImageUsageFlagBits::eStorage;
+
+    vk::ImageCreateInfo yccImageInfo {outImageInfo};
+    yccImageInfo.format = runtime.intermediateFormat(4);
 
     vk::ImageCreateInfo errorImageInfo {srcImageInfo};
     errorImageInfo.format = vk::Format::eR32Sfloat;
@@ -262,333 +194,131 @@ void IQM::GPU::FLIP::prepareImageStorage(const VulkanRuntime &runtime, const Inp
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    this->imageInput = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-    this->imageRef = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-    this->imageYccInput = std::make_shared<VulkanImage>(runtime.createImage(yccImageInfo));
-    this->imageYccRef = std::make_shared<VulkanImage>(runtime.createImage(yccImageInfo));
-    this->imageOut = std::make_shared<VulkanImage>(runtime.createImage(yccImageInfo));
-    this->imageFilterTempInput = std::make_shared<VulkanImage>(runtime.createImage(yccImageInfo));
-    this->imageFilterTempRef = std::make_shared<VulkanImage>(runtime.createImage(yccImageInfo));
-    this->imageFeatureFilters = std::make_shared<VulkanImage>(runtime.createImage(featureFilterImageInfo));
-    this->imageFeatureError = std::make_shared<VulkanImage>(runtime.createImage(errorImageInfo));
-    this->imageColorMap = std::make_shared<VulkanImage>(runtime.createImage(colorMapImageInfo));
+    // intermediate images are kept by the graph and reused if the resolution did not change
+    this->graph.reset();
+    // dropped first, so the cache can hand them out again
+    this->imageInput.reset();
+    this->imageRef.reset();
+    this->imageOut.reset();
+    this->imageInput = runtime.acquireInputImage(srcImageInfo);
+    this->imageRef = runtime.acquireInputImage(srcImageInfo);
+    this->imageOut = runtime._imageCache->acquire(outImageInfo);
+    this->imageYccInput = this->graph.createTransientImage(runtime, yccImageInfo);
+    this->imageYccRef = this->graph.createTransientImage(runtime, yccImageInfo);
+    this->imageFilterTempInput = this->graph.createTransientImage(runtime, yccImageInfo);
+    this->imageFilterTempRef = this->graph.createTransientImage(runtime, yccImageInfo);
+    this->imageFeatureFilters = this->graph.createTransientImage(runtime, featureFilterImageInfo);
+    this->imageFeatureError = this->graph.createTransientImage(runtime, errorImageInfo);
+
+    VulkanRuntime::initImages(slot.cmdTransfer, {this->imageOut});
+
+    // the output is initialized here anyway, so the transfer submission cannot be skipped
+    runtime.uploadInputImage(slot, this->imageInput, image);
+    runtime.uploadInputImage(slot, this->imageRef, ref);
+
+    if (this->imageColorMap) {
+        return;
+    }
 
-    VulkanRuntime::initImages(runtime._cmd_bufferTransfer, {
-        this->imageInput,
-        this->imageRef,
-        this->imageYccInput,
-        this->imageYccRef,
-        this->imageFilterTempInput,
-        this->imageFilterTempRef,
-        this->imageFeatureFilters,
-        this->imageFeatureError,
-        this->imageOut,
-        this->imageColorMap,
-    });
-
-    vk::BufferImageCopy copyRegion{
-        .bufferOffset = 0,
-        .bufferRowLength = this->imageParameters.width,
-        .bufferImageHeight = this->imageParameters.height,
-        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
-        .imageOffset = vk::Offset3D{0, 0, 0},
-        .imageExtent = vk::Extent3D{this->imageParameters.width, this->imageParameters.height, 1}
-    };
-    runtime._cmd_bufferTransfer->copyBufferToImage(this->stgInput, this->imageInput->image,  vk::ImageLayout::eGeneral, copyRegion);
-    runtime._cmd_bufferTransfer->copyBufferToImage(this->stgRef, this->imageRef->image,  vk::ImageLayout::eGeneral, copyRegion);
+    const auto colorMapSize = 256 * 4 * sizeof(float);
+    const auto stgColorMap = runtime._uploadRing->reserve(slot, colorMapSize);
+    memcpy(stgColorMap.data(), viridis, colorMapSize);
+    stgColorMap.flush();
+
+    this->imageColorMap = std::make_shared<VulkanImage>(runtime.createImage(colorMapImageInfo));
+    VulkanRuntime::initImages(slot.cmdTransfer, {this->imageColorMap});
 
     vk::BufferImageCopy copyColorMapRegion{
-        .bufferOffset = 0,
+        .bufferOffset = stgColorMap.offset(),
         .bufferRowLength = 256,
         .bufferImageHeight = 1,
         .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
         .imageOffset = vk::Offset3D{0, 0, 0},
         .imageExtent = vk::Extent3D{256, 1, 1}
     };
-    runtime._cmd_bufferTransfer->copyBufferToImage(this->stgColorMap, this->imageColorMap->image,  vk::ImageLayout::eGeneral, copyColorMapRegion);
+    slot.cmdTransfer->copyBufferToImage(stgColorMap.buffer(), this->imageColorMap->image,  vk::ImageLayout::eGeneral, copyColorMapRegion);
 }
 
-void IQM::GPU::FLIP::convertToYCxCz(const VulkanRuntime &runtime) {
-    const vk::CommandBufferBeginInfo beginInfo = {
-        .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
-    };
-    runtime._cmd_buffer->begin(beginInfo);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->inputConvertPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->inputConvertLayout, 0, {this->inputConvertDescSet}, {});
+void IQM::GPU::FLIP::convertToYCxCz() {
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, this->inputConvertSize);
 
-    //shaders work in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 2);
+    this->graph.addPass("flip ycxcz", [this, groupsX, groupsY](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->inputConvertPipeline);
+        this->inputConvertLayout.push(slot, storageImages({this->imageInput, this->imageRef, this->imageYccInput, this->imageYccRef}));
+        cmd.dispatch(groupsX, groupsY, 2);
+    }).read(this->imageInput).read(this->imageRef).write(this->imageYccInput).write(this->imageYccRef);
 }
 
 void IQM::GPU::FLIP::createFeatureFilters(const VulkanRuntime &runtime, float pixels_per_degree, int kernel_size) {
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->featureFilterCreatePipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->featureFilterCreateLayout, 0, {this->featureFilterCreateDescSet}, {});
-    runtime._cmd_buffer->pushConstants<float>(this->featureFilterCreateLayout, vk::ShaderStageFlagBits::eCompute, 0, pixels_per_degree);
-
     //shaders work in 16x16 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(kernel_size, kernel_size, 16);
 
-    runtime._cmd_buffer->dispatch(groupsX, 1, 2);
-
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->imageFeatureFilters->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier}
-    );
+    const auto createPipeline = &this->featureFilterCreatePipelines.get(runtime, this->featureFilterCreateKernel, this->featureFilterCreateLayout.pipelineLayout(), featureFilterConstants(pixels_per_degree));
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->featureFilterNormalizePipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->featureFilterCreateLayout, 0, {this->featureFilterCreateDescSet}, {});
-    runtime._cmd_buffer->pushConstants<float>(this->featureFilterCreateLayout, vk::ShaderStageFlagBits::eCompute, 0, pixels_per_degree);
+    this->graph.addPass("flip feature_filter", [this, groupsX, createPipeline](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *createPipeline);
+        this->featureFilterCreateLayout.push(slot, storageImages({this->imageFeatureFilters}));
+        cmd.dispatch(groupsX, 1, 2);
+    }).write(this->imageFeatureFilters);
 
-    runtime._cmd_buffer->dispatch(groupsX, 1, 2);
+    this->graph.addPass("flip feature_filter_normalize", [this, groupsX](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->featureFilterNormalizePipeline);
+        this->featureFilterCreateLayout.push(slot, storageImages({this->imageFeatureFilters}));
+        cmd.dispatch(groupsX, 1, 2);
+    }).readWrite(this->imageFeatureFilters);
 }
 
-void IQM::GPU::FLIP::computeFeatureErrorMap(const VulkanRuntime &runtime) {
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->imageFeatureFilters->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    vk::ImageMemoryBarrier imageMemoryBarrierInput = {imageMemoryBarrier};
-    imageMemoryBarrierInput.image = this->imageYccInput->image;
-    vk::ImageMemoryBarrier imageMemoryBarrierRef = {imageMemoryBarrier};
-    imageMemoryBarrierRef.image = this->imageYccRef->image;
-
-    // wait here, so previous work can be run in parallel
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier, imageMemoryBarrierInput, imageMemoryBarrierRef}
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->featureFilterHorizontalPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->featureFilterHorizontalLayout, 0, {this->featureFilterHorizontalDescSet}, {});
-
-    //shaders work in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 2);
-
-    vk::ImageMemoryBarrier imageMemoryBarrierTempIn = {imageMemoryBarrier};
-    imageMemoryBarrierTempIn.image = this->imageFilterTempInput->image;
-    vk::ImageMemoryBarrier imageMemoryBarrierTempRef = {imageMemoryBarrier};
-    imageMemoryBarrierTempRef.image = this->imageFilterTempRef->image;
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier, imageMemoryBarrierInput, imageMemoryBarrierRef}
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->featureDetectPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->featureDetectLayout, 0, {this->featureDetectDescSet}, {});
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+void IQM::GPU::FLIP::computeFeatureErrorMap() {
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, this->featureFilterHorizontalSize);
+    auto [detectGroupsX, detectGroupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, this->featureDetectSize);
+
+    this->graph.addPass("flip feature_filter_horizontal", [this, groupsX, groupsY](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->featureFilterHorizontalPipeline);
+        this->featureFilterHorizontalLayout.push(slot, storageImages({
+            this->imageYccInput, this->imageYccRef,
+            this->imageFilterTempInput, this->imageFilterTempRef,
+            this->imageFeatureFilters,
+        }));
+        cmd.dispatch(groupsX, groupsY, 2);
+    }).read(this->imageYccInput).read(this->imageYccRef).read(this->imageFeatureFilters)
+      .write(this->imageFilterTempInput).write(this->imageFilterTempRef);
+
+    this->graph.addPass("flip feature_detect", [this, detectGroupsX, detectGroupsY](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->featureDetectPipeline);
+        this->featureDetectLayout.push(slot, storageImages({
+            this->imageFilterTempInput, this->imageFilterTempRef,
+            this->imageFeatureError,
+            this->imageFeatureFilters,
+        }));
+        cmd.dispatch(detectGroupsX, detectGroupsY, 1);
+    }).read(this->imageFilterTempInput).read(this->imageFilterTempRef).read(this->imageFeatureFilters)
+      .write(this->imageFeatureError);
 }
 
-void IQM::GPU::FLIP::computeFinalErrorMap(const VulkanRuntime &runtime) {
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->colorPipeline.imageColorError->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    // wait here, so previous work can be run in parallel
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier}
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->errorCombinePipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->errorCombineLayout, 0, {this->errorCombineDescSet}, {});
-
-    //shaders work in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+void IQM::GPU::FLIP::computeFinalErrorMap() {
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, this->errorCombineSize);
+
+    this->graph.addPass("flip error_combine", [this, groupsX, groupsY](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->errorCombinePipeline);
+        this->errorCombineLayout.push(slot, storageImages({
+            this->imageFeatureError, this->colorPipeline.imageColorError,
+            this->imageColorMap,
+            this->imageOut,
+        }));
+        cmd.dispatch(groupsX, groupsY, 1);
+    }).read(this->imageFeatureError).read(this->colorPipeline.imageColorError).read(this->imageColorMap)
+      .write(this->imageOut);
 }
 
-void IQM::GPU::FLIP::startTransferCommandList(const VulkanRuntime &runtime) {
+void IQM::GPU::FLIP::startTransferCommandList(const VulkanRuntime &runtime, FrameSlot &slot) {
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_bufferTransfer->begin(beginInfo);
+    slot.cmdTransfer->begin(beginInfo);
 }
 
-void IQM::GPU::FLIP::endTransferCommandList(const VulkanRuntime &runtime) {
-    runtime._cmd_bufferTransfer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_bufferTransfer
-    };
-
-    const vk::SubmitInfo submitInfoCopy{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data(),
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &*this->uploadDone
-    };
-
-    runtime._transferQueue->submit(submitInfoCopy, this->transferFence);
-}
+void IQM::GPU::FLIP::endTransferCommandList(const VulkanRuntime &runtime, FrameSlot &slot) {
+    slot.cmdTransfer->end();
 
-void IQM::GPU::FLIP::setUpDescriptors(const VulkanRuntime &runtime) {
-    auto imageInfos = VulkanRuntime::createImageInfos({
-        this->imageInput,
-        this->imageRef,
-    });
-
-    auto yccOutImageInfos = VulkanRuntime::createImageInfos({
-        this->imageYccInput,
-        this->imageYccRef,
-    });
-
-    auto featureFilterImageInfos = VulkanRuntime::createImageInfos({
-        this->imageFeatureFilters,
-    });
-
-    auto tempFeatureFilterImageInfos = VulkanRuntime::createImageInfos({
-        this->imageFilterTempInput,
-        this->imageFilterTempRef,
-    });
-
-    auto outFeatureImageInfos = VulkanRuntime::createImageInfos({
-        this->imageFeatureError,
-    });
-
-    auto colorMapImageInfos = VulkanRuntime::createImageInfos({
-        this->imageColorMap,
-    });
-
-    auto outImageInfos = VulkanRuntime::createImageInfos({
-        this->imageOut,
-    });
-
-    auto errorImageInfos = VulkanRuntime::createImageInfos({
-        this->imageFeatureError,
-        this->colorPipeline.imageColorError,
-    });
-
-    auto writeSetConvertInput = VulkanRuntime::createWriteSet(
-        this->inputConvertDescSet,
-        0,
-        imageInfos
-    );
-
-    auto writeSetConvertOutput = VulkanRuntime::createWriteSet(
-        this->inputConvertDescSet,
-        1,
-        yccOutImageInfos
-    );
-
-    auto writeSetFeatureFilter = VulkanRuntime::createWriteSet(
-        this->featureFilterCreateDescSet,
-        0,
-        featureFilterImageInfos
-    );
-
-    auto writeSetHorizontalInput = VulkanRuntime::createWriteSet(
-        this->featureFilterHorizontalDescSet,
-        0,
-        yccOutImageInfos
-    );
-
-    auto writeSetHorizontalOutput = VulkanRuntime::createWriteSet(
-        this->featureFilterHorizontalDescSet,
-        1,
-        tempFeatureFilterImageInfos
-    );
-
-    auto writeSetHorizontalFilters = VulkanRuntime::createWriteSet(
-        this->featureFilterHorizontalDescSet,
-        2,
-        featureFilterImageInfos
-    );
-
-    auto writeSetDetectInput = VulkanRuntime::createWriteSet(
-        this->featureDetectDescSet,
-        0,
-        tempFeatureFilterImageInfos
-    );
-
-    auto writeSetDetectOutput = VulkanRuntime::createWriteSet(
-        this->featureDetectDescSet,
-        1,
-        outFeatureImageInfos
-    );
-
-    auto writeSetDetectFilters = VulkanRuntime::createWriteSet(
-        this->featureDetectDescSet,
-        2,
-        featureFilterImageInfos
-    );
-
-    auto writeSetFinalIn = VulkanRuntime::createWriteSet(
-        this->errorCombineDescSet,
-        0,
-        errorImageInfos
-    );
-
-    auto writeSetFinalColorMap = VulkanRuntime::createWriteSet(
-        this->errorCombineDescSet,
-        1,
-        colorMapImageInfos
-    );
-
-    auto writeSetFinalOut = VulkanRuntime::createWriteSet(
-        this->errorCombineDescSet,
-        2,
-        outImageInfos
-    );
-
-    runtime._device.updateDescriptorSets({
-        writeSetConvertInput, writeSetConvertOutput,
-        writeSetFeatureFilter,
-        writeSetHorizontalInput, writeSetHorizontalFilters, writeSetHorizontalOutput,
-        writeSetDetectInput, writeSetDetectFilters, writeSetDetectOutput,
-        writeSetFinalIn, writeSetFinalColorMap, writeSetFinalOut
-    }, nullptr);
+    runtime.submitSlot(slot, SlotQueue::Transfer);
 }
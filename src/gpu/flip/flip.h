@@ -22,69 +22,61 @@ namespace IQM::GPU {
         float monitor_resolution_x = 2560;
         float monitor_distance = 0.7;
         float monitor_width = 0.6;
+
+        // the specialization constant of the filter pipelines
+        [[nodiscard]] double pixelsPerDegree() const;
     };
 
     class FLIP {
     public:
-        explicit FLIP(const VulkanRuntime &runtime);
-        FLIPResult computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref, const FLIPArguments &args);
+        // filter pipelines for the expected viewing condition are created here, other conditions on first use
+        explicit FLIP(const VulkanRuntime &runtime, const FLIPArguments &expected = {});
+        FLIPResult computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref, const FLIPArguments &args);
 
     private:
-        void prepareImageStorage(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref, int kernel_size);
-        void convertToYCxCz(const VulkanRuntime &runtime);
+        void prepareImageStorage(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref, int kernel_size);
+        // these only add passes to the graph, everything is recorded at once in computeMetric
+        void convertToYCxCz();
         void createFeatureFilters(const VulkanRuntime &runtime, float pixels_per_degree, int kernel_size);
-        void computeFeatureErrorMap(const VulkanRuntime &runtime);
-        void computeFinalErrorMap(const VulkanRuntime & runtime);
+        void computeFeatureErrorMap();
+        void computeFinalErrorMap();
 
-        void startTransferCommandList(const VulkanRuntime &runtime);
-        void endTransferCommandList(const VulkanRuntime &runtime);
-        void setUpDescriptors(const VulkanRuntime & runtime);
+        void startTransferCommandList(const VulkanRuntime &runtime, FrameSlot &slot);
+        void endTransferCommandList(const VulkanRuntime &runtime, FrameSlot &slot);
 
         FLIPColorPipeline colorPipeline;
 
         ImageParameters imageParameters;
 
         vk::raii::ShaderModule inputConvertKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout inputConvertLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout inputConvertLayout;
         vk::raii::Pipeline inputConvertPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout inputConvertDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet inputConvertDescSet = VK_NULL_HANDLE;
+        WorkgroupSize inputConvertSize;
 
         vk::raii::ShaderModule featureFilterCreateKernel = VK_NULL_HANDLE;
         vk::raii::ShaderModule featureFilterNormalizeKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout featureFilterCreateLayout = VK_NULL_HANDLE;
-        vk::raii::Pipeline featureFilterCreatePipeline = VK_NULL_HANDLE;
+        PushDescriptorLayout featureFilterCreateLayout;
+        // specialized for pixels per degree
+        PipelineVariants featureFilterCreatePipelines;
         vk::raii::Pipeline featureFilterNormalizePipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout featureFilterCreateDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet featureFilterCreateDescSet = VK_NULL_HANDLE;
 
         vk::raii::ShaderModule featureFilterHorizontalKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout featureFilterHorizontalLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout featureFilterHorizontalLayout;
         vk::raii::Pipeline featureFilterHorizontalPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout featureFilterHorizontalDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet featureFilterHorizontalDescSet = VK_NULL_HANDLE;
+        WorkgroupSize featureFilterHorizontalSize;
 
         vk::raii::ShaderModule featureDetectKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout featureDetectLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout featureDetectLayout;
         vk::raii::Pipeline featureDetectPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet featureDetectDescSet = VK_NULL_HANDLE;
+        WorkgroupSize featureDetectSize;
 
         vk::raii::ShaderModule errorCombineKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout errorCombineLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout errorCombineLayout;
         vk::raii::Pipeline errorCombinePipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout errorCombineDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet errorCombineDescSet = VK_NULL_HANDLE;
-
-        vk::raii::Semaphore uploadDone = VK_NULL_HANDLE;
-        vk::raii::Semaphore computeDone = VK_NULL_HANDLE;
-        vk::raii::Fence transferFence = VK_NULL_HANDLE;
+        WorkgroupSize errorCombineSize;
 
-        vk::raii::Buffer stgInput = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgInputMemory = VK_NULL_HANDLE;
-        vk::raii::Buffer stgRef = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgRefMemory = VK_NULL_HANDLE;
-        vk::raii::Buffer stgColorMap = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgColorMapMemory = VK_NULL_HANDLE;
+        // owns the memory of the transient images, including the ones of the color pipeline
+        RenderGraph graph;
 
         std::shared_ptr<VulkanImage> imageInput;
         std::shared_ptr<VulkanImage> imageRef;
@@ -94,6 +86,7 @@ namespace IQM::GPU {
         std::shared_ptr<VulkanImage> imageFilterTempRef;
         std::shared_ptr<VulkanImage> imageFeatureError;
 
+        // constant, uploaded with the first computed pair and kept for the following ones
         std::shared_ptr<VulkanImage> imageColorMap;
 
         std::shared_ptr<VulkanImage> imageFeatureFilters;
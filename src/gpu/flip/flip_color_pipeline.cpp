@@ -17,135 +17,83 @@ static uint32_t srcDetect[] =
 #include <flip/spatial_detection.inc>
 ;
 
-IQM::GPU::FLIPColorPipeline::FLIPColorPipeline(const VulkanRuntime &runtime) {
-    this->csfPrefilterHorizontalKernel = runtime.createShaderModule(srcHorizontal, sizeof(srcHorizontal));
-    this->csfPrefilterKernel = runtime.createShaderModule(srcPrefilter, sizeof(srcPrefilter));
-    this->spatialDetectKernel = runtime.createShaderModule(srcDetect, sizeof(srcDetect));
+static uint32_t srcHorizontalFp16[] =
+#include <flip/spatial_prefilter_horizontal_fp16.inc>
+;
+
+static uint32_t srcPrefilterFp16[] =
+#include <flip/spatial_prefilter_fp16.inc>
+;
+
+static uint32_t srcDetectFp16[] =
+#include <flip/spatial_detection_fp16.inc>
+;
+
+static IQM::GPU::SpecializationConstants prefilterConstants(const float pixels_per_degree) {
+    IQM::GPU::SpecializationConstants constants;
+    constants.add(pixels_per_degree);
+    return constants;
+}
 
-    this->csfPrefilterDescSetLayout = runtime.createDescLayout({
+IQM::GPU::FLIPColorPipeline::FLIPColorPipeline(const VulkanRuntime &runtime, const float expected_pixels_per_degree) {
+    if (runtime._halfPrecision) {
+        this->csfPrefilterHorizontalKernel = runtime.createShaderModule(srcHorizontalFp16, sizeof(srcHorizontalFp16));
+        this->csfPrefilterKernel = runtime.createShaderModule(srcPrefilterFp16, sizeof(srcPrefilterFp16));
+        this->spatialDetectKernel = runtime.createShaderModule(srcDetectFp16, sizeof(srcDetectFp16));
+    } else {
+        this->csfPrefilterHorizontalKernel = runtime.createShaderModule(srcHorizontal, sizeof(srcHorizontal));
+        this->csfPrefilterKernel = runtime.createShaderModule(srcPrefilter, sizeof(srcPrefilter));
+        this->spatialDetectKernel = runtime.createShaderModule(srcDetect, sizeof(srcDetect));
+    }
+
+    this->csfPrefilterLayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 2},
-    });
+    }, {}};
+    const auto constants = prefilterConstants(expected_pixels_per_degree);
+    this->csfPrefilterHorizontalPipelines.preload(runtime, this->csfPrefilterHorizontalKernel, this->csfPrefilterLayout.pipelineLayout(), constants);
+    this->csfPrefilterPipelines.preload(runtime, this->csfPrefilterKernel, this->csfPrefilterLayout.pipelineLayout(), constants);
 
-    this->spatialDetectDescSetLayout = runtime.createDescLayout({
+    this->spatialDetectLayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageImage, 1},
-    });
-
-    const std::vector descLayoutPrefilter = {
-        *this->csfPrefilterDescSetLayout,
-    };
-
-    const std::vector descLayoutDetect = {
-        *this->spatialDetectDescSetLayout,
-    };
-
-    const std::vector allDescLayouts = {
-        *this->csfPrefilterDescSetLayout,
-        *this->csfPrefilterDescSetLayout,
-        *this->spatialDetectDescSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(allDescLayouts.size()),
-        .pSetLayouts = allDescLayouts.data()
-    };
-
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->csfPrefilterHorizontalDescSet = std::move(sets[0]);
-    this->csfPrefilterDescSet = std::move(sets[1]);
-    this->spatialDetectDescSet = std::move(sets[2]);
-
-    const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(float));
-
-    this->csfPrefilterLayout = runtime.createPipelineLayout(descLayoutPrefilter, ranges);
-    this->csfPrefilterHorizontalPipeline = runtime.createComputePipeline(this->csfPrefilterHorizontalKernel, this->csfPrefilterLayout);
-    this->csfPrefilterPipeline = runtime.createComputePipeline(this->csfPrefilterKernel, this->csfPrefilterLayout);
-
-    this->spatialDetectLayout = runtime.createPipelineLayout(descLayoutDetect, {});
-    this->spatialDetectPipeline = runtime.createComputePipeline(this->spatialDetectKernel, this->spatialDetectLayout);
+    }, {}};
+    this->spatialDetectSize = runtime.workgroupSize("flip_spatial_detect", {16, 16});
+    this->spatialDetectPipeline = runtime.createComputePipeline(this->spatialDetectKernel, this->spatialDetectLayout.pipelineLayout(), this->spatialDetectSize);
 }
 
-void IQM::GPU::FLIPColorPipeline::prefilter(const VulkanRuntime &runtime, ImageParameters params, float pixels_per_degree) {
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->csfPrefilterHorizontalPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->csfPrefilterLayout, 0, {this->csfPrefilterHorizontalDescSet}, {});
-    runtime._cmd_buffer->pushConstants<float>(this->csfPrefilterLayout, vk::ShaderStageFlagBits::eCompute, 0, pixels_per_degree);
-
+void IQM::GPU::FLIPColorPipeline::prefilter(const VulkanRuntime &runtime, RenderGraph &graph, const std::shared_ptr<VulkanImage> &inputYcc, const std::shared_ptr<VulkanImage> &refYcc, ImageParameters params, float pixels_per_degree) {
     //shaders work in 16x16 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(params.width, params.height, 16);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 2);
-
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->inputPrefilterTemp->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-    vk::ImageMemoryBarrier imageMemoryBarrier_2 = {imageMemoryBarrier};
-    imageMemoryBarrier_2.image = this->refPrefilterTemp->image;
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier, imageMemoryBarrier_2}
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->csfPrefilterPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->csfPrefilterLayout, 0, {this->csfPrefilterDescSet}, {});
-    runtime._cmd_buffer->pushConstants<float>(this->csfPrefilterLayout, vk::ShaderStageFlagBits::eCompute, 0, pixels_per_degree);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 2);
+    const auto constants = prefilterConstants(pixels_per_degree);
+    const auto horizontalPipeline = &this->csfPrefilterHorizontalPipelines.get(runtime, this->csfPrefilterHorizontalKernel, this->csfPrefilterLayout.pipelineLayout(), constants);
+    const auto pipeline = &this->csfPrefilterPipelines.get(runtime, this->csfPrefilterKernel, this->csfPrefilterLayout.pipelineLayout(), constants);
+
+    graph.addPass("flip spatial_prefilter_horizontal", [this, inputYcc, refYcc, groupsX, groupsY, horizontalPipeline](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *horizontalPipeline);
+        this->csfPrefilterLayout.push(slot, storageImages({inputYcc, refYcc, this->inputPrefilterTemp, this->refPrefilterTemp}));
+        cmd.dispatch(groupsX, groupsY, 2);
+    }).read(inputYcc).read(refYcc).write(this->inputPrefilterTemp).write(this->refPrefilterTemp);
+
+    graph.addPass("flip spatial_prefilter", [this, groupsX, groupsY, pipeline](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+        this->csfPrefilterLayout.push(slot, storageImages({this->inputPrefilterTemp, this->refPrefilterTemp, this->inputPrefilter, this->refPrefilter}));
+        cmd.dispatch(groupsX, groupsY, 2);
+    }).read(this->inputPrefilterTemp).read(this->refPrefilterTemp).write(this->inputPrefilter).write(this->refPrefilter);
 }
 
-void IQM::GPU::FLIPColorPipeline::computeErrorMap(const VulkanRuntime &runtime, ImageParameters params) {
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->inputPrefilter->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    vk::ImageMemoryBarrier imageMemoryBarrier_2 = {imageMemoryBarrier};
-    imageMemoryBarrier_2.image = this->refPrefilter->image;
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, {imageMemoryBarrier, imageMemoryBarrier_2}
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->spatialDetectPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->spatialDetectLayout, 0, {this->spatialDetectDescSet}, {});
+void IQM::GPU::FLIPColorPipeline::computeErrorMap(RenderGraph &graph, ImageParameters params) {
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(params.width, params.height, this->spatialDetectSize);
 
-    //shaders work in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(params.width, params.height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    graph.addPass("flip spatial_detect", [this, groupsX, groupsY](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, this->spatialDetectPipeline);
+        this->spatialDetectLayout.push(slot, storageImages({this->inputPrefilter, this->refPrefilter, this->imageColorError}));
+        cmd.dispatch(groupsX, groupsY, 1);
+    }).read(this->inputPrefilter).read(this->refPrefilter).write(this->imageColorError);
 }
 
-void IQM::GPU::FLIPColorPipeline::prepareStorage(const VulkanRuntime &runtime, int spatial_kernel_size, ImageParameters params) {
+void IQM::GPU::FLIPColorPipeline::prepareStorage(const VulkanRuntime &runtime, RenderGraph &graph, int spatial_kernel_size, ImageParameters params) {
     vk::ImageCreateInfo filterImageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -165,7 +113,7 @@ void IQM::GPU::FLIPColorPipeline::prepareStorage(const VulkanRuntime &runtime, i
     vk::ImageCreateInfo prefilterImageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
-        .format = vk::Format::eR32G32B32A32Sfloat,
+        .format = runtime.intermediateFormat(4),
         .extent = vk::Extent3D(params.width, params.height, 1),
         .mipLevels = 1,
         .arrayLayers = 1,
@@ -181,78 +129,10 @@ void IQM::GPU::FLIPColorPipeline::prepareStorage(const VulkanRuntime &runtime, i
     vk::ImageCreateInfo colorErrorImageInfo = {prefilterImageInfo};
     colorErrorImageInfo.format = vk::Format::eR32Sfloat;
 
-    this->csfFilter = std::make_shared<VulkanImage>(runtime.createImage(filterImageInfo));
-    this->inputPrefilter = std::make_shared<VulkanImage>(runtime.createImage(prefilterImageInfo));
-    this->refPrefilter = std::make_shared<VulkanImage>(runtime.createImage(prefilterImageInfo));
-    this->inputPrefilterTemp = std::make_shared<VulkanImage>(runtime.createImage(prefilterImageInfo));
-    this->refPrefilterTemp = std::make_shared<VulkanImage>(runtime.createImage(prefilterImageInfo));
-    this->imageColorError = std::make_shared<VulkanImage>(runtime.createImage(colorErrorImageInfo));
-
-    VulkanRuntime::initImages(runtime._cmd_bufferTransfer, {
-        this->csfFilter,
-        this->inputPrefilter,
-        this->refPrefilter,
-        this->imageColorError,
-        this->inputPrefilterTemp,
-        this->refPrefilterTemp,
-    });
-}
-
-void IQM::GPU::FLIPColorPipeline::setUpDescriptors(const VulkanRuntime &runtime, const std::shared_ptr<VulkanImage> &inputYcc, const std::shared_ptr<VulkanImage> &refYcc) {
-    auto imageInfosPrefilterInput = VulkanRuntime::createImageInfos({
-        inputYcc,
-        refYcc,
-    });
-
-    auto imageInfosPrefilterOutput = VulkanRuntime::createImageInfos({
-        this->inputPrefilter,
-        this->refPrefilter,
-    });
-
-    auto imageInfosPrefilterTemp = VulkanRuntime::createImageInfos({
-        this->inputPrefilterTemp,
-        this->refPrefilterTemp,
-    });
-
-    auto imageInfosOutput = VulkanRuntime::createImageInfos({
-        this->imageColorError,
-    });
-
-    auto writeSetPrefilterHorInput = VulkanRuntime::createWriteSet(
-        this->csfPrefilterHorizontalDescSet,
-        0,
-        imageInfosPrefilterInput
-    );
-
-    auto writeSetPrefilterHorOutput = VulkanRuntime::createWriteSet(
-        this->csfPrefilterHorizontalDescSet,
-        1,
-        imageInfosPrefilterTemp
-    );
-
-    auto writeSetPrefilterVertInput = VulkanRuntime::createWriteSet(
-        this->csfPrefilterDescSet,
-        0,
-        imageInfosPrefilterTemp
-    );
-
-    auto writeSetPrefilterVertOutput = VulkanRuntime::createWriteSet(
-        this->csfPrefilterDescSet,
-        1,
-        imageInfosPrefilterOutput
-    );
-
-    auto writeSetDetectInput = VulkanRuntime::createWriteSet(
-        this->spatialDetectDescSet,
-        0,
-        imageInfosPrefilterOutput
-    );
-
-    auto writeSetDetectOutput = VulkanRuntime::createWriteSet(
-        this->spatialDetectDescSet,
-        1,
-        imageInfosOutput
-    );
-
-    runtime._device.updateDescriptorSets({writeSetPrefilterHorInput, writeSetPrefilterHorOutput, writeSetPrefilterVertInput, writeSetPrefilterVertOutput, writeSetDetectInput, writeSetDetectOutput}, nullptr);
+    this->csfFilter = graph.createTransientImage(runtime, filterImageInfo);
+    this->inputPrefilter = graph.createTransientImage(runtime, prefilterImageInfo);
+    this->refPrefilter = graph.createTransientImage(runtime, prefilterImageInfo);
+    this->inputPrefilterTemp = graph.createTransientImage(runtime, prefilterImageInfo);
+    this->refPrefilterTemp = graph.createTransientImage(runtime, prefilterImageInfo);
+    this->imageColorError = graph.createTransientImage(runtime, colorErrorImageInfo);
 }
@@ -6,36 +6,35 @@
 #ifndef FLIPCOLORPIPELINE_H
 #define FLIPCOLORPIPELINE_H
 
+#include "../base/render_graph.h"
 #include "../base/vulkan_runtime.h"
 #include "../img_params.h"
 
 namespace IQM::GPU {
     class FLIPColorPipeline {
     public:
-        explicit FLIPColorPipeline(const VulkanRuntime &runtime);
+        // prefilter pipelines for expected_pixels_per_degree are created here, other values on first use
+        FLIPColorPipeline(const VulkanRuntime &runtime, float expected_pixels_per_degree);
         void prepareSpatialFilters(const VulkanRuntime &runtime, int kernel_size, float pixels_per_degree);
-        void prefilter(const VulkanRuntime &runtime, ImageParameters params, float pixels_per_degree);
-        void computeErrorMap(const VulkanRuntime &runtime, ImageParameters params);
+        void prefilter(const VulkanRuntime &runtime, RenderGraph &graph, const std::shared_ptr<VulkanImage> &inputYcc, const std::shared_ptr<VulkanImage> &refYcc, ImageParameters params, float pixels_per_degree);
+        void computeErrorMap(RenderGraph &graph, ImageParameters params);
 
-        void prepareStorage(const VulkanRuntime &runtime, int spatial_kernel_size, ImageParameters params);
-        void setUpDescriptors(const VulkanRuntime &runtime, const std::shared_ptr<VulkanImage> &inputYcc, const std::shared_ptr<VulkanImage> &refYcc);
+        // all images of the pipeline are transient in the graph
+        void prepareStorage(const VulkanRuntime &runtime, RenderGraph &graph, int spatial_kernel_size, ImageParameters params);
 
         std::shared_ptr<VulkanImage> imageColorError;
     private:
         vk::raii::ShaderModule csfPrefilterKernel = VK_NULL_HANDLE;
         vk::raii::ShaderModule csfPrefilterHorizontalKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout csfPrefilterLayout = VK_NULL_HANDLE;
-        vk::raii::Pipeline csfPrefilterPipeline = VK_NULL_HANDLE;
-        vk::raii::Pipeline csfPrefilterHorizontalPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout csfPrefilterDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet csfPrefilterDescSet = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet csfPrefilterHorizontalDescSet = VK_NULL_HANDLE;
+        PushDescriptorLayout csfPrefilterLayout;
+        // specialized for pixels per degree
+        PipelineVariants csfPrefilterPipelines;
+        PipelineVariants csfPrefilterHorizontalPipelines;
 
         vk::raii::ShaderModule spatialDetectKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout spatialDetectLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout spatialDetectLayout;
         vk::raii::Pipeline spatialDetectPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout spatialDetectDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet spatialDetectDescSet = VK_NULL_HANDLE;
+        WorkgroupSize spatialDetectSize;
 
         std::shared_ptr<VulkanImage> csfFilter;
 
@@ -18,6 +18,18 @@ static uint32_t srcExtractLuma[] =
 #include <fsim/fsim_extractluma.inc>
 ;
 
+static uint32_t srcDownscaleFp16[] =
+#include <fsim/fsim_downsample_fp16.inc>
+;
+
+static uint32_t srcGradientFp16[] =
+#include <fsim/fsim_gradientmap_fp16.inc>
+;
+
+static uint32_t srcExtractLumaFp16[] =
+#include <fsim/fsim_extractluma_fp16.inc>
+;
+
 IQM::GPU::FSIM::FSIM(const VulkanRuntime &runtime):
 lowpassFilter(runtime),
 logGaborFilter(runtime),
@@ -29,123 +41,140 @@ estimateEnergy(runtime),
 phaseCongruency(runtime),
 final_multiply(runtime)
 {
-    this->downscaleKernel = runtime.createShaderModule(srcDownscale, sizeof(srcDownscale));
-    this->kernelGradientMap = runtime.createShaderModule(srcGradient, sizeof(srcGradient));
-    this->kernelExtractLuma = runtime.createShaderModule(srcExtractLuma, sizeof(srcExtractLuma));
-
-    const std::vector layout_2 = {
-        *runtime._descLayoutTwoImage,
-    };
-
-    const std::vector layout_imbuf = {
-        *runtime._descLayoutImageBuffer,
-    };
-
-    const std::vector allLayouts = {
-        *runtime._descLayoutTwoImage,
-        *runtime._descLayoutTwoImage,
-        *runtime._descLayoutTwoImage,
-        *runtime._descLayoutTwoImage,
-        *runtime._descLayoutImageBuffer,
-        *runtime._descLayoutImageBuffer,
-    };
+    // only the downscaled images are 16 bit, filters and FFT data are precision sensitive
+    if (runtime._halfPrecision) {
+        this->downscaleKernel = runtime.createShaderModule(srcDownscaleFp16, sizeof(srcDownscaleFp16));
+        this->kernelGradientMap = runtime.createShaderModule(srcGradientFp16, sizeof(srcGradientFp16));
+        this->kernelExtractLuma = runtime.createShaderModule(srcExtractLumaFp16, sizeof(srcExtractLumaFp16));
+    } else {
+        this->downscaleKernel = runtime.createShaderModule(srcDownscale, sizeof(srcDownscale));
+        this->kernelGradientMap = runtime.createShaderModule(srcGradient, sizeof(srcGradient));
+        this->kernelExtractLuma = runtime.createShaderModule(srcExtractLuma, sizeof(srcExtractLuma));
+    }
 
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(allLayouts.size()),
-        .pSetLayouts = allLayouts.data()
+    const std::vector<std::pair<vk::DescriptorType, uint32_t>> twoImages = {
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eStorageImage, 1},
     };
 
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->descSetDownscaleIn = std::move(sets[0]);
-    this->descSetDownscaleRef = std::move(sets[1]);
-    this->descSetGradientMapIn = std::move(sets[2]);
-    this->descSetGradientMapRef = std::move(sets[3]);
-    this->descSetExtractLumaIn = std::move(sets[4]);
-    this->descSetExtractLumaRef = std::move(sets[5]);
-
     // 1x int - kernel size
     const auto downsampleRanges = VulkanRuntime::createPushConstantRange(sizeof(int));
 
-    this->layoutDownscale = runtime.createPipelineLayout(layout_2, downsampleRanges);
-    this->pipelineDownscale = runtime.createComputePipeline(this->downscaleKernel, this->layoutDownscale);
+    this->layoutDownscale = PushDescriptorLayout{runtime, twoImages, downsampleRanges};
+    this->downscaleSize = runtime.workgroupSize("fsim_downsample", {8, 8});
+    this->pipelineDownscale = runtime.createComputePipeline(this->downscaleKernel, this->layoutDownscale.pipelineLayout(), this->downscaleSize);
+
+    this->layoutGradientMap = PushDescriptorLayout{runtime, twoImages, {}};
+    this->pipelineGradientMap = runtime.createComputePipeline(this->kernelGradientMap, this->layoutGradientMap.pipelineLayout());
+
+    this->layoutExtractLuma = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eStorageBuffer, 1},
+    }, {}};
+    this->pipelineExtractLuma = runtime.createComputePipeline(this->kernelExtractLuma, this->layoutExtractLuma.pipelineLayout());
 
-    this->layoutGradientMap = runtime.createPipelineLayout(layout_2, {});
-    this->pipelineGradientMap = runtime.createComputePipeline(this->kernelGradientMap, this->layoutGradientMap);
+    // VkFFT allocates and frees its own command buffers while building plans
+    this->fftCommandPool = vk::raii::CommandPool{runtime._device, vk::CommandPoolCreateInfo{
+        .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+        .queueFamilyIndex = runtime._queueFamilyIndex,
+    }};
+}
 
-    this->layoutExtractLuma = runtime.createPipelineLayout(layout_imbuf, {});
-    this->pipelineExtractLuma = runtime.createComputePipeline(this->kernelExtractLuma, this->layoutExtractLuma);
+IQM::GPU::FSIM::~FSIM() {
+    this->teardownFftLibrary();
 }
 
-IQM::GPU::FSIMResult IQM::GPU::FSIM::computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
+IQM::GPU::FSIMResult IQM::GPU::FSIM::computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref) {
     FSIMResult result;
 
     const int F = computeDownscaleFactor(image.width, image.height);
 
     result.timestamps.mark("downscale factor computed");
 
-    this->sendImagesToGpu(runtime, image, ref);
-
-    result.timestamps.mark("images sent to gpu");
-
     const auto widthDownscale = static_cast<int>(std::round(static_cast<float>(image.width) / static_cast<float>(F)));
     const auto heightDownscale = static_cast<int>(std::round(static_cast<float>(image.height) / static_cast<float>(F)));
 
+    this->createStorage(runtime, image.width, image.height, widthDownscale, heightDownscale);
+    result.transientMemory = this->transients.stats();
+
+    result.timestamps.mark("storage allocated");
+
+    this->sendImagesToGpu(runtime, slot, image, ref);
+
+    result.timestamps.mark("images sent to gpu");
+
     this->initFftLibrary(runtime, widthDownscale, heightDownscale);
     result.timestamps.mark("FFT library initialized");
 
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
-
-    this->createDownscaledImages(runtime, widthDownscale, heightDownscale);
-    this->computeDownscaledImages(runtime, F, widthDownscale, heightDownscale);
-    this->lowpassFilter.constructFilter(runtime, widthDownscale, heightDownscale);
-
-    vk::MemoryBarrier barrier{
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-    };
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup,
-        {barrier},
-        nullptr,
-        nullptr
-    );
-
-    this->createGradientMap(runtime, widthDownscale, heightDownscale);
-    this->logGaborFilter.constructFilter(runtime, this->lowpassFilter.imageLowpassFilter, widthDownscale, heightDownscale);
-    this->angularFilter.constructFilter(runtime, widthDownscale, heightDownscale);
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup,
-        {barrier},
-        nullptr,
-        nullptr
-    );
-
-    this->computeFft(runtime, widthDownscale, heightDownscale);
-    this->combinations.combineFilters(runtime, this->angularFilter, this->logGaborFilter, this->bufferFft, widthDownscale, heightDownscale);
-    this->computeMassInverseFft(runtime, this->combinations.fftBuffer);
-
-    this->sumFilterResponses.computeSums(runtime, this->combinations.fftBuffer, widthDownscale, heightDownscale);
+    slot.cmd->begin(beginInfo);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_DOWNSCALE);
+    runtime.beginGpuTimer(slot, "fsim downscale");
+    this->computeDownscaledImages(runtime, slot, F, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_LOWPASS);
+    runtime.beginGpuTimer(slot, "fsim lowpass filter");
+    this->lowpassFilter.constructFilter(runtime, slot, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_GRADIENT);
+    runtime.beginGpuTimer(slot, "fsim gradient map");
+    this->createGradientMap(runtime, slot, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_LOG_GABOR);
+    runtime.beginGpuTimer(slot, "fsim log gabor");
+    this->logGaborFilter.constructFilter(runtime, slot, this->lowpassFilter.imageLowpassFilter, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_ANGULAR);
+    runtime.beginGpuTimer(slot, "fsim angular filter");
+    this->angularFilter.constructFilter(runtime, slot, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_FFT);
+    runtime.beginGpuTimer(slot, "fsim forward FFT");
+    this->computeFft(runtime, slot, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_COMBINATIONS);
+    runtime.beginGpuTimer(slot, "fsim filter combinations");
+    this->combinations.combineFilters(runtime, slot, this->angularFilter, this->logGaborFilter, this->bufferFft, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_INVERSE_FFT);
+    runtime.beginGpuTimer(slot, "fsim inverse FFT");
+    this->computeMassInverseFft(runtime, slot, this->combinations.fftBuffer);
+    runtime.endGpuTimer(slot);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_SUM_RESPONSES);
+    runtime.beginGpuTimer(slot, "fsim sum filter responses");
+    this->sumFilterResponses.computeSums(runtime, slot, this->combinations.fftBuffer, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
     result.timestamps.mark("pre median work recorded");
 
-    this->noise_power.computeNoisePower(runtime, this->combinations.noiseLevels, this->combinations.fftBuffer, widthDownscale, heightDownscale);
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_NOISE_POWER);
+    this->noise_power.computeNoisePower(runtime, slot, this->combinations.noiseLevels, this->combinations.fftBuffer, widthDownscale, heightDownscale);
     result.timestamps.mark("noise powers computed");
 
-    this->estimateEnergy.estimateEnergy(runtime, this->combinations.fftBuffer, widthDownscale, heightDownscale);
+    // noise power waits for the slot to read its results back, the rest goes into a new submission
+    slot.cmd->begin(beginInfo);
+
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_ESTIMATE_ENERGY);
+    this->estimateEnergy.estimateEnergy(runtime, slot, this->combinations.fftBuffer, widthDownscale, heightDownscale);
 
-    this->phaseCongruency.compute(runtime, this->noise_power.noisePowers, this->estimateEnergy.energyBuffers, this->sumFilterResponses.filterResponsesInput, this->sumFilterResponses.filterResponsesRef, widthDownscale, heightDownscale);
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_PHASE_CONGRUENCY);
+    runtime.beginGpuTimer(slot, "fsim phase congruency");
+    this->phaseCongruency.compute(runtime, slot, this->noise_power.noisePowers, this->estimateEnergy.energyBuffers, this->sumFilterResponses.filterResponsesInput, this->sumFilterResponses.filterResponsesRef, widthDownscale, heightDownscale);
+    runtime.endGpuTimer(slot);
 
+    this->transients.beginStep(*slot.cmd, FSIM_STEP_FINAL_MULTIPLY);
     auto metrics = this->final_multiply.computeMetrics(
-        runtime,
+        runtime, slot,
         {this->imageInputDownscaled, this->imageRefDownscaled},
         {this->imageGradientMapInput, this->imageGradientMapRef},
         {this->phaseCongruency.pcInput, this->phaseCongruency.pcRef},
@@ -153,12 +182,11 @@ IQM::GPU::FSIMResult IQM::GPU::FSIM::computeMetric(const VulkanRuntime &runtime,
         heightDownscale
     );
     result.timestamps.mark("FSIM, FSIMc computed");
+    result.timestamps.addGpu(runtime.collectGpuTimers(slot));
 
     result.fsim = metrics.first;
     result.fsimc = metrics.second;
 
-    this->teardownFftLibrary();
-
     return result;
 }
 
@@ -167,37 +195,15 @@ int IQM::GPU::FSIM::computeDownscaleFactor(const int width, const int height) {
     return std::max(1, static_cast<int>(std::round(smallerDim / 256.0)));
 }
 
-void IQM::GPU::FSIM::sendImagesToGpu(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
-    const auto size = image.width * image.height * 4;
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    auto [stgRefBuf, stgRefMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-
-    auto imageParameters = ImageParameters(image.width, image.height);
+void IQM::GPU::FSIM::createStorage(const VulkanRuntime &runtime, const int width, const int height, const int widthDownscale, const int heightDownscale) {
+    // the slot was already waited for, resources of the previous computation are kept if the resolution did not change
+    this->transients.reset();
 
-    stgBuf.bindMemory(stgMem, 0);
-    stgRefBuf.bindMemory(stgRefMem, 0);
-
-    void * inBufData = stgMem.mapMemory(0, imageParameters.height * imageParameters.width * 4, {});
-    memcpy(inBufData, image.data.data(), imageParameters.height * imageParameters.width * 4);
-    stgMem.unmapMemory();
-
-    inBufData = stgRefMem.mapMemory(0, imageParameters.height * imageParameters.width * 4, {});
-    memcpy(inBufData, ref.data.data(), imageParameters.height * imageParameters.width * 4);
-    stgRefMem.unmapMemory();
-
-    vk::ImageCreateInfo srcImageInfo = {
+    const vk::ImageCreateInfo srcImageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
         .format = vk::Format::eR8G8B8A8Unorm,
-        .extent = vk::Extent3D(image.width, image.height, 1),
+        .extent = vk::Extent3D(width, height, 1),
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = vk::SampleCountFlagBits::e1,
@@ -209,54 +215,22 @@ void IQM::GPU::FSIM::sendImagesToGpu(const VulkanRuntime &runtime, const InputIm
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    this->imageInput = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-    this->imageRef = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-
-    // copy data to images, correct formats
-    const vk::CommandBufferBeginInfo beginInfo = {
-        .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
-    };
-    runtime._cmd_bufferTransfer->begin(beginInfo);
-
-    runtime.setImageLayout(runtime._cmd_bufferTransfer, this->imageInput->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-    runtime.setImageLayout(runtime._cmd_bufferTransfer, this->imageRef->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-    vk::BufferImageCopy copyRegion{
-        .bufferOffset = 0,
-        .bufferRowLength = imageParameters.width,
-        .bufferImageHeight = imageParameters.height,
-        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
-        .imageOffset = vk::Offset3D{0, 0, 0},
-        .imageExtent = vk::Extent3D{imageParameters.width, imageParameters.height, 1}
-    };
-    runtime._cmd_bufferTransfer->copyBufferToImage(stgBuf, this->imageInput->image,  vk::ImageLayout::eGeneral, copyRegion);
-    runtime._cmd_bufferTransfer->copyBufferToImage(stgRefBuf, this->imageRef->image,  vk::ImageLayout::eGeneral, copyRegion);
-
-    runtime._cmd_bufferTransfer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_bufferTransfer
-    };
-
-    auto maskCopy = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTransfer};
-    const vk::SubmitInfo submitInfoCopy{
-        .pWaitDstStageMask = &maskCopy,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data()
-    };
-
-    const vk::raii::Fence fenceCopy{runtime._device, vk::FenceCreateInfo{}};
-
-    runtime._transferQueue->submit(submitInfoCopy, *fenceCopy);
-    runtime.waitForFence(fenceCopy);
-}
+    // written by the host directly where the device allows it, these live outside of the transients
+    this->imageInput.reset();
+    this->imageRef.reset();
+    this->imageInput = runtime.acquireHostInputImage(srcImageInfo);
+    this->imageRef = runtime.acquireHostInputImage(srcImageInfo);
+    if (!this->imageInput || !this->imageRef) {
+        // full resolution images are needed only for downscaling, everything after that can reuse their memory
+        this->imageInput = this->transients.createUploadImage(runtime, srcImageInfo, FSIM_STEP_DOWNSCALE);
+        this->imageRef = this->transients.createUploadImage(runtime, srcImageInfo, FSIM_STEP_DOWNSCALE);
+    }
 
-void IQM::GPU::FSIM::createDownscaledImages(const VulkanRuntime &runtime, int width_downscale, int height_downscale) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
-        .format = vk::Format::eR32G32B32A32Sfloat,
-        .extent = vk::Extent3D(width_downscale, height_downscale, 1),
+        .format = runtime.intermediateFormat(4),
+        .extent = vk::Extent3D(widthDownscale, heightDownscale, 1),
         .mipLevels = 1,
         .arrayLayers = 1,
         .samples = vk::SampleCountFlagBits::e1,
@@ -272,104 +246,85 @@ void IQM::GPU::FSIM::createDownscaledImages(const VulkanRuntime &runtime, int wi
     imageFloatInfo.format = vk::Format::eR32Sfloat;
     imageFloatInfo.usage = vk::ImageUsageFlagBits::eStorage;
 
-    vk::ImageCreateInfo imageFftInfo = {imageFloatInfo};
-    imageFftInfo.format = vk::Format::eR32G32Sfloat;
-    imageFftInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferDst;
-
-    this->imageInputDownscaled = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-    this->imageRefDownscaled = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-    this->imageGradientMapInput = std::make_shared<VulkanImage>(runtime.createImage(imageFloatInfo));
-    this->imageGradientMapRef = std::make_shared<VulkanImage>(runtime.createImage(imageFloatInfo));
-
-    auto imageInfosInput = VulkanRuntime::createImageInfos({
-        this->imageInput,
-        this->imageInputDownscaled,
-    });
-
-    auto imageInfosRef = VulkanRuntime::createImageInfos({
-        this->imageRef,
-        this->imageRefDownscaled,
-    });
-
-    auto imageInfosGradIn = VulkanRuntime::createImageInfos({
-        this->imageInputDownscaled,
-        this->imageGradientMapInput,
-    });
-
-    auto imageInfosGradRef = VulkanRuntime::createImageInfos({
-        this->imageRefDownscaled,
-        this->imageGradientMapRef,
-    });
-
-    auto writeSetInput = VulkanRuntime::createWriteSet(
-        this->descSetDownscaleIn,
-        0,
-        imageInfosInput
-    );
-
-    auto writeSetRef = VulkanRuntime::createWriteSet(
-        this->descSetDownscaleRef,
-        0,
-        imageInfosRef
-    );
+    this->imageInputDownscaled = this->transients.createImage(runtime, imageInfo, FSIM_STEP_DOWNSCALE, FSIM_STEP_FINAL_MULTIPLY);
+    this->imageRefDownscaled = this->transients.createImage(runtime, imageInfo, FSIM_STEP_DOWNSCALE, FSIM_STEP_FINAL_MULTIPLY);
+    this->imageGradientMapInput = this->transients.createImage(runtime, imageFloatInfo, FSIM_STEP_GRADIENT, FSIM_STEP_FINAL_MULTIPLY);
+    this->imageGradientMapRef = this->transients.createImage(runtime, imageFloatInfo, FSIM_STEP_GRADIENT, FSIM_STEP_FINAL_MULTIPLY);
 
-    auto writeSetGradIn = VulkanRuntime::createWriteSet(
-        this->descSetGradientMapIn,
-        0,
-        imageInfosGradIn
+    // image size * 2 float components (complex numbers) * 2 batches
+    this->bufferFft = this->transients.createBuffer(
+        runtime,
+        widthDownscale * heightDownscale * sizeof(float) * 2 * 2,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+        FSIM_STEP_FFT,
+        FSIM_STEP_COMBINATIONS
     );
 
-    auto writeSetGradRef = VulkanRuntime::createWriteSet(
-        this->descSetGradientMapRef,
-        0,
-        imageInfosGradRef
-    );
+    this->lowpassFilter.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->logGaborFilter.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->angularFilter.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->combinations.createBufferStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->sumFilterResponses.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->noise_power.createBufferStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->estimateEnergy.createBufferStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->phaseCongruency.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+    this->final_multiply.createImageStorage(runtime, this->transients, widthDownscale, heightDownscale);
+
+    this->transients.allocate(runtime);
+}
 
-    const std::vector writes = {
-        writeSetRef, writeSetInput, writeSetGradIn, writeSetGradRef
+void IQM::GPU::FSIM::sendImagesToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref) {
+    // copy data to images, correct formats
+    const vk::CommandBufferBeginInfo beginInfo = {
+        .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
+    slot.cmdTransfer->begin(beginInfo);
+    const bool inputRecorded = runtime.uploadInputImage(slot, this->imageInput, image);
+    const bool refRecorded = runtime.uploadInputImage(slot, this->imageRef, ref);
+    slot.cmdTransfer->end();
+
+    // the first compute submission of the slot waits for this one, if there is one at all
+    if (inputRecorded || refRecorded) {
+        runtime.submitSlot(slot, SlotQueue::Transfer);
+    }
 }
 
-void IQM::GPU::FSIM::computeDownscaledImages(const VulkanRuntime &runtime, const int F, const int width, const int height) {
-    runtime.setImageLayout(runtime._cmd_buffer, this->imageInputDownscaled->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-    runtime.setImageLayout(runtime._cmd_buffer, this->imageRefDownscaled->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineDownscale);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutDownscale, 0, {this->descSetDownscaleIn}, {});
+void IQM::GPU::FSIM::computeDownscaledImages(const VulkanRuntime &runtime, FrameSlot &slot, const int F, const int width, const int height) {
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineDownscale);
+    this->layoutDownscale.push(slot, storageImages({this->imageInput, this->imageInputDownscaled}));
 
-    runtime._cmd_buffer->pushConstants<int>(this->layoutDownscale, vk::ShaderStageFlagBits::eCompute, 0, F);
+    slot.cmd->pushConstants<int>(this->layoutDownscale.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, F);
 
-    //shader works in 8x8 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 8);
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, this->downscaleSize);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutDownscale, 0, {this->descSetDownscaleRef}, {});
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    this->layoutDownscale.push(slot, storageImages({this->imageRef, this->imageRefDownscaled}));
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 }
 
-void IQM::GPU::FSIM::createGradientMap(const VulkanRuntime &runtime, int width, int height) {
-    runtime.setImageLayout(runtime._cmd_buffer, this->imageGradientMapInput->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-    runtime.setImageLayout(runtime._cmd_buffer, this->imageGradientMapRef->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineGradientMap);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutGradientMap, 0, {this->descSetGradientMapIn}, {});
+void IQM::GPU::FSIM::createGradientMap(const VulkanRuntime &runtime, FrameSlot &slot, int width, int height) {
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineGradientMap);
+    this->layoutGradientMap.push(slot, storageImages({this->imageInputDownscaled, this->imageGradientMapInput}));
 
     //shader works in 8x8 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 8);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutGradientMap, 0, {this->descSetGradientMapRef}, {});
+    this->layoutGradientMap.push(slot, storageImages({this->imageRefDownscaled, this->imageGradientMapRef}));
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 }
 
 void IQM::GPU::FSIM::initFftLibrary(const VulkanRuntime &runtime, const int width, const int height) {
+    if (this->fftInitialized && this->fftWidth == width && this->fftHeight == height) {
+        return;
+    }
+    this->teardownFftLibrary();
+
     // image size * 2 float components (complex numbers) * 2 batches
-    uint64_t bufferSize = width * height * sizeof(float) * 2 * 2;
+    this->fftBufferSize = width * height * sizeof(float) * 2 * 2;
 
     VkFFTApplication fftApp = {};
 
@@ -377,23 +332,25 @@ void IQM::GPU::FSIM::initFftLibrary(const VulkanRuntime &runtime, const int widt
     fftConfig.FFTdim = 2;
     fftConfig.size[0] = width;
     fftConfig.size[1] = height;
-    fftConfig.bufferSize = &bufferSize;
-
-    VkDevice deviceRef = *runtime._device;
-    VkPhysicalDevice physDeviceRef = *runtime._physicalDevice;
-    VkQueue queueRef = **runtime._queue;
-    VkCommandPool cmdPoolRef = **runtime._commandPool;
-    fftConfig.physicalDevice = &physDeviceRef;
-    fftConfig.device = &deviceRef;
-    fftConfig.queue = &queueRef;
-    fftConfig.commandPool = &cmdPoolRef;
+    fftConfig.bufferSize = &this->fftBufferSize;
+
+    this->fftDevice = *runtime._device;
+    this->fftPhysicalDevice = *runtime._physicalDevice;
+    this->fftQueue = **runtime._queue;
+    this->fftCommandPoolHandle = *this->fftCommandPool;
+    fftConfig.physicalDevice = &this->fftPhysicalDevice;
+    fftConfig.device = &this->fftDevice;
+    fftConfig.queue = &this->fftQueue;
+    fftConfig.commandPool = &this->fftCommandPoolHandle;
     fftConfig.numberBatches = 2;
     fftConfig.makeForwardPlanOnly = true;
 
     this->fftFence =  vk::raii::Fence{runtime._device, vk::FenceCreateInfo{}};
-    VkFence fenceRef = *this->fftFence;
-    fftConfig.fence = &fenceRef;
+    this->fftFenceHandle = *this->fftFence;
+    fftConfig.fence = &this->fftFenceHandle;
 
+    // VkFFT submits its own work during initialization, the queue is shared with the other slots
+    auto queueLock = runtime.lockQueues();
     if (initializeVkFFT(&fftApp, fftConfig) != VKFFT_SUCCESS) {
         throw std::runtime_error("failed to initialize FFT");
     }
@@ -401,7 +358,7 @@ void IQM::GPU::FSIM::initFftLibrary(const VulkanRuntime &runtime, const int widt
     this->fftApplication = fftApp;
 
     // (image size * 2 float components (complex numbers) ) * 16 filters * 3 cases (by itself, times input, times reference)
-    uint64_t bufferSizeInverse = width * height * sizeof(float) * 2 * FSIM_ORIENTATIONS * FSIM_SCALES * 3;
+    this->fftBufferSizeInverse = width * height * sizeof(float) * 2 * FSIM_ORIENTATIONS * FSIM_SCALES * 3;
 
     VkFFTApplication fftAppInverse = {};
 
@@ -409,113 +366,68 @@ void IQM::GPU::FSIM::initFftLibrary(const VulkanRuntime &runtime, const int widt
     fftConfigInverse.FFTdim = 2;
     fftConfigInverse.size[0] = width;
     fftConfigInverse.size[1] = height;
-    fftConfigInverse.bufferSize = &bufferSizeInverse;
+    fftConfigInverse.bufferSize = &this->fftBufferSizeInverse;
 
-    fftConfigInverse.physicalDevice = &physDeviceRef;
-    fftConfigInverse.device = &deviceRef;
-    fftConfigInverse.queue = &queueRef;
-    fftConfigInverse.commandPool = &cmdPoolRef;
+    fftConfigInverse.physicalDevice = &this->fftPhysicalDevice;
+    fftConfigInverse.device = &this->fftDevice;
+    fftConfigInverse.queue = &this->fftQueue;
+    fftConfigInverse.commandPool = &this->fftCommandPoolHandle;
     fftConfigInverse.numberBatches = 16 * 3;
     fftConfigInverse.makeInversePlanOnly = true;
     fftConfigInverse.normalize = true;
     fftConfigInverse.isCompilerInitialized = true;
 
     this->fftFenceInverse =  vk::raii::Fence{runtime._device, vk::FenceCreateInfo{}};
-    VkFence fenceRefInverse = *this->fftFenceInverse;
-    fftConfigInverse.fence = &fenceRefInverse;
+    this->fftFenceInverseHandle = *this->fftFenceInverse;
+    fftConfigInverse.fence = &this->fftFenceInverseHandle;
 
     if (initializeVkFFT(&fftAppInverse, fftConfigInverse) != VKFFT_SUCCESS) {
+        deleteVkFFT(&this->fftApplication);
         throw std::runtime_error("failed to initialize FFT");
     }
 
     this->fftApplicationInverse = fftAppInverse;
+    this->fftInitialized = true;
+    this->fftWidth = width;
+    this->fftHeight = height;
 }
 
 void IQM::GPU::FSIM::teardownFftLibrary() {
+    if (!this->fftInitialized) {
+        return;
+    }
+    // the forward plan initialized the compiler, so it is deleted last
     deleteVkFFT(&this->fftApplicationInverse);
     deleteVkFFT(&this->fftApplication);
+    this->fftInitialized = false;
 }
 
-void IQM::GPU::FSIM::computeFft(const VulkanRuntime &runtime, const int width, const int height) {
+void IQM::GPU::FSIM::computeFft(const VulkanRuntime &runtime, FrameSlot &slot, const int width, const int height) {
     // image size * 2 float components (complex numbers) * 2 batches
     uint64_t bufferSize = width * height * sizeof(float) * 2 * 2;
 
-    auto [fftBuf, fftMem] = runtime.createBuffer(
-        bufferSize,
-        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eDeviceLocal
-    );
-    fftBuf.bindMemory(fftMem, 0);
-
-    this->memoryFft = std::move(fftMem);
-    this->bufferFft = std::move(fftBuf);
-
-    std::vector bufIn = {
-        vk::DescriptorBufferInfo{
-            .buffer = this->bufferFft,
-            .offset = 0,
-            .range = bufferSize / 2,
-        }
-    };
-    auto imInfoInImage = VulkanRuntime::createImageInfos({
-        this->imageInputDownscaled,
-    });
-    auto writeSetInImage = VulkanRuntime::createWriteSet(
-        this->descSetExtractLumaIn,
-        0,
-        imInfoInImage
-    );
-
-    auto writeSetInBuf = VulkanRuntime::createWriteSet(
-        this->descSetExtractLumaIn,
-        1,
-        bufIn
-    );
-
-    std::vector bufRef = {
-        vk::DescriptorBufferInfo{
-            .buffer = this->bufferFft,
-            .offset = bufferSize / 2,
-            .range = bufferSize / 2,
-        }
-    };
-
-    auto imInfoRefImage = VulkanRuntime::createImageInfos({
-        this->imageRefDownscaled,
-    });
-    auto writeSetRefImage = VulkanRuntime::createWriteSet(
-        this->descSetExtractLumaRef,
-        0,
-        imInfoRefImage
-    );
-
-    auto writeSetRefBuf = VulkanRuntime::createWriteSet(
-        this->descSetExtractLumaRef,
-        1,
-        bufRef
-    );
-
-    const std::vector writes = {
-        writeSetInImage, writeSetInBuf, writeSetRefImage, writeSetRefBuf
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
-
     //shader works in 8x8 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 8);
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineExtractLuma);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutExtractLuma, 0, {this->descSetExtractLumaIn}, {});
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    // input and reference go into the two halves of the buffer, as two batches of the FFT
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineExtractLuma);
+    this->layoutExtractLuma.push(slot, {
+        PushDescriptor::storageImage(this->imageInputDownscaled),
+        PushDescriptor::storageBuffer(this->bufferFft, 0, bufferSize / 2),
+    });
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutExtractLuma, 0, {this->descSetExtractLumaRef}, {});
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    this->layoutExtractLuma.push(slot, {
+        PushDescriptor::storageImage(this->imageRefDownscaled),
+        PushDescriptor::storageBuffer(this->bufferFft, bufferSize / 2, bufferSize / 2),
+    });
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 
     vk::MemoryBarrier barrier{
         .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
         .dstAccessMask = vk::AccessFlagBits::eShaderRead,
     };
-    runtime._cmd_buffer->pipelineBarrier(
+    slot.cmd->pipelineBarrier(
         vk::PipelineStageFlagBits::eComputeShader,
         vk::PipelineStageFlagBits::eComputeShader,
         {},
@@ -525,7 +437,7 @@ void IQM::GPU::FSIM::computeFft(const VulkanRuntime &runtime, const int width, c
     );
 
     VkFFTLaunchParams launchParams = {};
-    VkCommandBuffer cmdBuf = **runtime._cmd_buffer;
+    VkCommandBuffer cmdBuf = **slot.cmd;
     launchParams.commandBuffer = &cmdBuf;
     VkBuffer fftBufRef = *this->bufferFft;
     launchParams.buffer = &fftBufRef;
@@ -536,10 +448,10 @@ void IQM::GPU::FSIM::computeFft(const VulkanRuntime &runtime, const int width, c
     }
 }
 
-void IQM::GPU::FSIM::computeMassInverseFft(const VulkanRuntime &runtime, const vk::raii::Buffer &buffer) {
+void IQM::GPU::FSIM::computeMassInverseFft(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &buffer) {
 
     VkFFTLaunchParams launchParams = {};
-    VkCommandBuffer cmdBuf = **runtime._cmd_buffer;
+    VkCommandBuffer cmdBuf = **slot.cmd;
     launchParams.commandBuffer = &cmdBuf;
     VkBuffer fftBufRef = *buffer;
     launchParams.buffer = &fftBufRef;
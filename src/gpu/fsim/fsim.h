@@ -9,6 +9,7 @@
 
 #include "../../input_image.h"
 #include "../../timestamps.h"
+#include "../base/transient_resources.h"
 #include "../base/vulkan_runtime.h"
 #include "steps/fsim_log_gabor.h"
 #include "steps/fsim_lowpass_filter.h"
@@ -24,27 +25,54 @@ namespace IQM::GPU {
     constexpr int FSIM_ORIENTATIONS = 4;
     constexpr int FSIM_SCALES = 4;
 
+    // steps of computeMetric in recording order, transient resources declare the range of steps they are used in
+    enum FSIMStep : unsigned {
+        FSIM_STEP_DOWNSCALE,
+        FSIM_STEP_LOWPASS,
+        FSIM_STEP_GRADIENT,
+        FSIM_STEP_LOG_GABOR,
+        FSIM_STEP_ANGULAR,
+        FSIM_STEP_FFT,
+        FSIM_STEP_COMBINATIONS,
+        FSIM_STEP_INVERSE_FFT,
+        FSIM_STEP_SUM_RESPONSES,
+        FSIM_STEP_NOISE_POWER,
+        FSIM_STEP_ESTIMATE_ENERGY,
+        FSIM_STEP_PHASE_CONGRUENCY,
+        FSIM_STEP_FINAL_MULTIPLY,
+    };
+
     struct FSIMResult {
         float fsim;
         float fsimc;
         Timestamps timestamps;
+        TransientResourcesStats transientMemory;
     };
 
     class FSIM {
     public:
         explicit FSIM(const VulkanRuntime &runtime);
-        FSIMResult computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref);
+        // the FFT plans are plain VkFFT structs, so they are released here and the metric cannot be copied
+        ~FSIM();
+        FSIM(const FSIM &) = delete;
+        FSIM &operator=(const FSIM &) = delete;
+        FSIMResult computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref);
 
     private:
         static int computeDownscaleFactor(int width, int height);
-        void sendImagesToGpu(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref);
-        void createDownscaledImages(const VulkanRuntime & runtime, int width_downscale, int height_downscale);
-        void computeDownscaledImages(const VulkanRuntime & runtime, int, int, int);
-        void createGradientMap(const VulkanRuntime & runtime, int, int);
+        // creates all device local storage of the metric up front, so that it can be aliased
+        void createStorage(const VulkanRuntime &runtime, int width, int height, int widthDownscale, int heightDownscale);
+        void sendImagesToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref);
+        void computeDownscaledImages(const VulkanRuntime &runtime, FrameSlot &slot, int, int, int);
+        void createGradientMap(const VulkanRuntime &runtime, FrameSlot &slot, int, int);
+        // builds the FFT plans only if the resolution differs from the one they were built for
         void initFftLibrary(const VulkanRuntime &runtime, int width, int height);
         void teardownFftLibrary();
-        void computeFft(const VulkanRuntime &runtime, int width, int height);
-        void computeMassInverseFft(const VulkanRuntime & runtime, const vk::raii::Buffer &buffer);
+        void computeFft(const VulkanRuntime &runtime, FrameSlot &slot, int width, int height);
+        void computeMassInverseFft(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &buffer);
+
+        // owns the memory of all intermediate images and buffers, declared first so it is destroyed last
+        TransientResources transients;
 
         FSIMLowpassFilter lowpassFilter;
         FSIMLogGabor logGaborFilter;
@@ -57,10 +85,9 @@ namespace IQM::GPU {
         FSIMFinalMultiply final_multiply;
 
         vk::raii::ShaderModule downscaleKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layoutDownscale = VK_NULL_HANDLE;
+        PushDescriptorLayout layoutDownscale;
         vk::raii::Pipeline pipelineDownscale = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetDownscaleIn = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetDownscaleRef = VK_NULL_HANDLE;
+        WorkgroupSize downscaleSize;
 
         std::shared_ptr<VulkanImage> imageInput;
         std::shared_ptr<VulkanImage> imageRef;
@@ -69,30 +96,39 @@ namespace IQM::GPU {
         std::shared_ptr<VulkanImage> imageRefDownscaled;
 
         // gradient map pass
-        vk::raii::PipelineLayout layoutGradientMap = VK_NULL_HANDLE;
+        PushDescriptorLayout layoutGradientMap;
         vk::raii::Pipeline pipelineGradientMap = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetGradientMapIn = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetGradientMapRef = VK_NULL_HANDLE;
         vk::raii::ShaderModule kernelGradientMap = VK_NULL_HANDLE;
 
         std::shared_ptr<VulkanImage> imageGradientMapInput;
         std::shared_ptr<VulkanImage> imageGradientMapRef;
 
         // extract luma for FFT library pass
-        vk::raii::PipelineLayout layoutExtractLuma = VK_NULL_HANDLE;
+        PushDescriptorLayout layoutExtractLuma;
         vk::raii::Pipeline pipelineExtractLuma = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetExtractLumaIn = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetExtractLumaRef = VK_NULL_HANDLE;
         vk::raii::ShaderModule kernelExtractLuma = VK_NULL_HANDLE;
 
-        vk::raii::DeviceMemory memoryFft = VK_NULL_HANDLE;
         vk::raii::Buffer bufferFft = VK_NULL_HANDLE;
 
-        // FFT lib
+        // FFT lib, plans are kept between computations of the same downscaled resolution
         VkFFTApplication fftApplication{};
         VkFFTApplication fftApplicationInverse{};
+        bool fftInitialized = false;
+        int fftWidth = 0;
+        int fftHeight = 0;
+        // used by VkFFT to upload its lookup tables while building the plans, not tied to any frame slot
+        vk::raii::CommandPool fftCommandPool = VK_NULL_HANDLE;
         vk::raii::Fence fftFence = VK_NULL_HANDLE;
         vk::raii::Fence fftFenceInverse = VK_NULL_HANDLE;
+        // VkFFT keeps pointers to its configuration values in the plans, so they have to live as long as the plans
+        VkDevice fftDevice = VK_NULL_HANDLE;
+        VkPhysicalDevice fftPhysicalDevice = VK_NULL_HANDLE;
+        VkQueue fftQueue = VK_NULL_HANDLE;
+        VkCommandPool fftCommandPoolHandle = VK_NULL_HANDLE;
+        VkFence fftFenceHandle = VK_NULL_HANDLE;
+        VkFence fftFenceInverseHandle = VK_NULL_HANDLE;
+        uint64_t fftBufferSize = 0;
+        uint64_t fftBufferSizeInverse = 0;
     };
 }
 
@@ -14,43 +14,25 @@ static uint32_t src[] =
 IQM::GPU::FSIMAngularFilter::FSIMAngularFilter(const VulkanRuntime &runtime) {
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
-    this->descSetLayout = std::move(runtime.createDescLayout({
+    this->layout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS},
-    }));
-
-    const std::vector layout = {
-        *this->descSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layout.size()),
-        .pSetLayouts = layout.data()
-    };
-
-    this->descSet = std::move(vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo}.front());
-
-    this->layout = runtime.createPipelineLayout(layout, {});
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    }, {}};
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout());
 
     this->imageAngularFilters = std::vector<std::shared_ptr<VulkanImage>>(FSIM_ORIENTATIONS);
 }
 
-void IQM::GPU::FSIMAngularFilter::constructFilter(const VulkanRuntime &runtime, int width, int height) {
-    this->prepareImageStorage(runtime, width, height);
-
-    VulkanRuntime::initImages(runtime._cmd_buffer, this->imageAngularFilters);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+void IQM::GPU::FSIMAngularFilter::constructFilter(const VulkanRuntime &runtime, FrameSlot &slot, int width, int height) {
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, storageImages(this->imageAngularFilters));
 
     //shader works in 16x16 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 16);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS);
+    slot.cmd->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS);
 }
 
-void IQM::GPU::FSIMAngularFilter::prepareImageStorage(const VulkanRuntime &runtime, int width, int height) {
+void IQM::GPU::FSIMAngularFilter::createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -68,19 +50,6 @@ void IQM::GPU::FSIMAngularFilter::prepareImageStorage(const VulkanRuntime &runti
     };
 
     for (unsigned i = 0; i < FSIM_ORIENTATIONS; i++) {
-        this->imageAngularFilters[i] = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
+        this->imageAngularFilters[i] = transients.createImage(runtime, imageInfo, FSIM_STEP_ANGULAR, FSIM_STEP_COMBINATIONS);
     }
-
-    auto imageInfos = VulkanRuntime::createImageInfos({this->imageAngularFilters});
-    const auto writeSet = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        imageInfos
-    );
-
-    const std::vector writes = {
-        writeSet,
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
 }
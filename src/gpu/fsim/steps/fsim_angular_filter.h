@@ -6,22 +6,20 @@
 #ifndef FSIM_ANGULAR_FILTER_H
 #define FSIM_ANGULAR_FILTER_H
 
+#include "../../base/transient_resources.h"
 #include "../../base/vulkan_runtime.h"
 
 namespace IQM::GPU {
     class FSIMAngularFilter {
     public:
         explicit FSIMAngularFilter(const VulkanRuntime &runtime);
-        void constructFilter(const VulkanRuntime &runtime, int width, int height);
+        void createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
+        void constructFilter(const VulkanRuntime &runtime, FrameSlot &slot, int width, int height);
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
         std::vector<std::shared_ptr<VulkanImage>> imageAngularFilters;
-    private:
-        void prepareImageStorage(const VulkanRuntime &runtime, int width, int height);
     };
 }
 
@@ -6,6 +6,8 @@
 #ifndef FSIM_ESTIMATE_ENERGY_H
 #define FSIM_ESTIMATE_ENERGY_H
 
+#include "../../base/transient_resources.h"
+#include "../../base/vulkan_reduction.h"
 #include "../../base/vulkan_runtime.h"
 
 namespace IQM::GPU {
@@ -15,24 +17,17 @@ namespace IQM::GPU {
     class FSIMEstimateEnergy {
     public:
         explicit FSIMEstimateEnergy(const VulkanRuntime &runtime);
-        void estimateEnergy(const VulkanRuntime &runtime, const vk::raii::Buffer& fftBuf, int width, int height);
+        void createBufferStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
+        void estimateEnergy(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer& fftBuf, int width, int height);
 
         vk::raii::ShaderModule estimateEnergyKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout estimateEnergyLayout = VK_NULL_HANDLE;
+        PushDescriptorLayout estimateEnergyLayout;
         vk::raii::Pipeline estimateEnergyPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout estimateEnergyDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet estimateEnergyDescSet = VK_NULL_HANDLE;
 
-        vk::raii::ShaderModule sumKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout sumLayout = VK_NULL_HANDLE;
-        vk::raii::Pipeline sumPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout sumDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet sumDescSet = VK_NULL_HANDLE;
+        // each energy buffer is summed into its first element
+        SumReduction sum;
 
         std::vector<vk::raii::Buffer> energyBuffers;
-        std::vector<vk::raii::DeviceMemory> energyBuffersMemory;
-    private:
-        void prepareBufferStorage(const VulkanRuntime& runtime, const vk::raii::Buffer &fftBuf, int width, int height);
     };
 }
 
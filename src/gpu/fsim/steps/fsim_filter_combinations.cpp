@@ -11,214 +11,75 @@ static uint32_t srcMultPack[] =
 #include <fsim/fsim_filter_combinations.inc>
 ;
 
-static uint32_t srcSum[] =
-#include <fsim/fsim_filter_noise.inc>
-;
-
-IQM::GPU::FSIMFilterCombinations::FSIMFilterCombinations(const VulkanRuntime &runtime) {
+IQM::GPU::FSIMFilterCombinations::FSIMFilterCombinations(const VulkanRuntime &runtime) : sum(runtime, FSIM_ORIENTATIONS) {
     this->multPackKernel = runtime.createShaderModule(srcMultPack, sizeof(srcMultPack));
-    this->sumKernel = runtime.createShaderModule(srcSum, sizeof(srcSum));
 
     //custom layout for this pass
-    this->multPackDescSetLayout = std::move(runtime.createDescLayout({
-        {vk::DescriptorType::eStorageImage, FSIM_SCALES},
+    this->multPacklayout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS},
+        {vk::DescriptorType::eStorageImage, FSIM_SCALES},
         {vk::DescriptorType::eStorageBuffer, 1},
         {vk::DescriptorType::eStorageBuffer, 1},
-    }));
-
-    this->sumDescSetLayout = std::move(runtime.createDescLayout({
-        {vk::DescriptorType::eStorageBuffer, 1},
-    }));
-
-    const std::vector layouts = {
-        *this->multPackDescSetLayout,
-        *this->sumDescSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->multPackDescSet = std::move(sets[0]);
-    this->sumDescSet = std::move(sets[1]);
-
-    // 3x int - buffer size, index of current execution, bool
-    const auto sumRanges = VulkanRuntime::createPushConstantRange(3 * sizeof(int));
-
-    this->multPacklayout = runtime.createPipelineLayout({this->multPackDescSetLayout}, {});
-    this->multPackPipeline = runtime.createComputePipeline(this->multPackKernel, this->multPacklayout);
-
-    this->sumLayout = runtime.createPipelineLayout({this->sumDescSetLayout}, sumRanges);
-    this->sumPipeline = runtime.createComputePipeline(this->sumKernel, this->sumLayout);
+    }, {}};
+    this->multPackSize = runtime.workgroupSize("fsim_filter_combinations", {16, 16});
+    this->multPackPipeline = runtime.createComputePipeline(this->multPackKernel, this->multPacklayout.pipelineLayout(), this->multPackSize);
 }
 
-void IQM::GPU::FSIMFilterCombinations::combineFilters(const VulkanRuntime &runtime, const FSIMAngularFilter &angulars, const FSIMLogGabor &logGabor, const vk::raii::Buffer& fftImages, int width, int height) {
-    this->prepareBufferStorage(runtime, angulars, logGabor, fftImages, width, height);
+void IQM::GPU::FSIMFilterCombinations::combineFilters(const VulkanRuntime &runtime, FrameSlot &slot, const FSIMAngularFilter &angulars, const FSIMLogGabor &logGabor, const vk::raii::Buffer& fftImages, int width, int height) {
+    uint64_t inFftBufSize = width * height * sizeof(float) * 2 * 2;
+    uint64_t outFftBufSize = width * height * sizeof(float) * 2 * FSIM_SCALES * FSIM_ORIENTATIONS * 3;
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->multPackPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->multPacklayout, 0, {this->multPackDescSet}, {});
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->multPackPipeline);
+    auto descriptors = storageImages(angulars.imageAngularFilters);
+    for (const auto &filter : logGabor.imageLogGaborFilters) {
+        descriptors.push_back(PushDescriptor::storageImage(filter));
+    }
+    descriptors.push_back(PushDescriptor::storageBuffer(fftImages, 0, inFftBufSize));
+    descriptors.push_back(PushDescriptor::storageBuffer(this->fftBuffer, 0, outFftBufSize));
+    this->multPacklayout.push(slot, descriptors);
 
-    //shader works in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 16);
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, this->multPackSize);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS * FSIM_SCALES);
+    slot.cmd->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS * FSIM_SCALES);
 
-    vk::MemoryBarrier barrier = {
+    const vk::MemoryBarrier barrier = {
         .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eTransferRead,
+        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
     };
-    runtime._cmd_buffer->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlagBits::eDeviceGroup, {barrier}, {}, {});
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->sumPipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->sumLayout, 0, {this->sumDescSet}, {});
+    slot.cmd->pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, {barrier}, {}, {});
 
-    uint64_t bufferSize = width * height * 2;
-    runtime._cmd_buffer->pushConstants<unsigned>(this->sumLayout, vk::ShaderStageFlagBits::eCompute, 0, bufferSize);
-
-    // parallel sum
+    // summed straight from the packed buffer, squared on the way
+    uint32_t bufferSize = width * height * 2;
+    std::vector<SumRequest> sums;
     for (unsigned n = 0; n < FSIM_ORIENTATIONS; n++) {
-        runtime._cmd_buffer->pushConstants<unsigned>(this->sumLayout, vk::ShaderStageFlagBits::eCompute, sizeof(unsigned), n);
-
-        vk::BufferCopy region {
-            .srcOffset = FSIM_ORIENTATIONS * n * bufferSize * sizeof(float),
-            .dstOffset = n * sizeof(float),
-            .size = bufferSize * sizeof(float),
-        };
-        runtime._cmd_buffer->copyBuffer(this->fftBuffer, this->noiseLevels, {region});
-
-        barrier = {
-            .srcAccessMask = vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eTransferRead,
-            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-        };
-        runtime._cmd_buffer->pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eComputeShader,
-            vk::DependencyFlagBits::eDeviceGroup,
-            {barrier},
-            {},
-            {}
-        );
-        uint64_t groups = (bufferSize / 128) + 1;
-        uint32_t size = bufferSize;
-        bool doPower = true;
-
-        for (;;) {
-            runtime._cmd_buffer->pushConstants<unsigned>(this->sumLayout, vk::ShaderStageFlagBits::eCompute, 0, size);
-            runtime._cmd_buffer->pushConstants<unsigned>(this->sumLayout, vk::ShaderStageFlagBits::eCompute, 2 * sizeof(unsigned), doPower);
-
-            runtime._cmd_buffer->dispatch(groups, 1, 1);
-
-            barrier = {
-                .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-                .dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite,
-            };
-            runtime._cmd_buffer->pipelineBarrier(
-                vk::PipelineStageFlagBits::eComputeShader,
-                vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                vk::DependencyFlagBits::eDeviceGroup,
-                {barrier},
-                {},
-                {}
-            );
-            if (groups == 1) {
-                break;
-            }
-            size = groups;
-            groups = (groups / 128) + 1;
-            doPower = false;
-        }
+        sums.push_back(SumRequest{
+            .input = &this->fftBuffer,
+            .offset = FSIM_ORIENTATIONS * n * bufferSize,
+            .count = bufferSize,
+            .output = &this->noiseLevels,
+            .outputIndex = n,
+        });
     }
+    this->sum.record(slot, sums, true);
 }
 
-void IQM::GPU::FSIMFilterCombinations::prepareBufferStorage(const VulkanRuntime &runtime, const FSIMAngularFilter &angulars, const FSIMLogGabor &logGabor, const vk::raii::Buffer& fftImages, int width, int height) {
-    uint64_t inFftBufSize = width * height * sizeof(float) * 2 * 2;
+void IQM::GPU::FSIMFilterCombinations::createBufferStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     uint64_t outFftBufSize = width * height * sizeof(float) * 2 * FSIM_SCALES * FSIM_ORIENTATIONS * 3;
 
-    // oversize, so parallel sum can be done directly there
-    uint64_t noiseLevelsBufferSize = (FSIM_ORIENTATIONS + (width * height * 2 * 2)) * sizeof(float);
-    auto [noiseLevelsBuf, noiseLevelsMemory] = runtime.createBuffer(
-            noiseLevelsBufferSize,
-            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-            vk::MemoryPropertyFlagBits::eDeviceLocal
-        );
-    noiseLevelsBuf.bindMemory(noiseLevelsMemory, 0);
-    this->noiseLevels = std::move(noiseLevelsBuf);
-    this->noiseLevelsMemory = std::move(noiseLevelsMemory);
-
-    auto [fftBuf, fftMem] = runtime.createBuffer(
-        outFftBufSize,
+    this->noiseLevels = transients.createBuffer(
+        runtime,
+        FSIM_ORIENTATIONS * sizeof(float),
         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eDeviceLocal
-    );
-    fftBuf.bindMemory(fftMem, 0);
-
-    this->fftBuffer = std::move(fftBuf);
-    this->fftMemory = std::move(fftMem);
-
-    auto angularInfos = VulkanRuntime::createImageInfos(angulars.imageAngularFilters);
-    auto logInfos = VulkanRuntime::createImageInfos(logGabor.imageLogGaborFilters);
-
-    const auto writeSetAngular = VulkanRuntime::createWriteSet(
-        this->multPackDescSet,
-        0,
-        angularInfos
-    );
-
-    const auto writeSetLogGabor = VulkanRuntime::createWriteSet(
-        this->multPackDescSet,
-        1,
-        logInfos
-    );
-
-    auto fftBufInfo = std::vector{
-        vk::DescriptorBufferInfo{
-            .buffer = fftImages,
-            .offset = 0,
-            .range = inFftBufSize,
-        }
-    };
-
-    const auto writeSetFftIn = VulkanRuntime::createWriteSet(
-        this->multPackDescSet,
-        2,
-        fftBufInfo
-    );
-
-    auto bufferInfo = std::vector{
-        vk::DescriptorBufferInfo{
-            .buffer = this->fftBuffer,
-            .offset = 0,
-            .range = outFftBufSize,
-        }
-    };
-
-    const auto writeSetBuf = VulkanRuntime::createWriteSet(
-        this->multPackDescSet,
-        3,
-        bufferInfo
+        FSIM_STEP_COMBINATIONS,
+        FSIM_STEP_NOISE_POWER
     );
 
-    auto bufferInfoSum = std::vector{
-        vk::DescriptorBufferInfo{
-            .buffer = this->noiseLevels,
-            .offset = 0,
-            .range = noiseLevelsBufferSize,
-        }
-    };
-
-    const auto writeSetNoise = VulkanRuntime::createWriteSet(
-        this->sumDescSet,
-        0,
-        bufferInfoSum
+    // read by everything up to energy estimation
+    this->fftBuffer = transients.createBuffer(
+        runtime,
+        outFftBufSize,
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+        FSIM_STEP_COMBINATIONS,
+        FSIM_STEP_ESTIMATE_ENERGY
     );
-
-    const std::vector writes = {
-        writeSetBuf, writeSetAngular, writeSetLogGabor, writeSetNoise, writeSetFftIn
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
 }
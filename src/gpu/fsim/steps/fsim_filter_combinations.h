@@ -7,6 +7,8 @@
 #define FSIM_FILTER_COMBINATIONS_H
 #include "fsim_angular_filter.h"
 #include "fsim_log_gabor.h"
+#include "../../base/transient_resources.h"
+#include "../../base/vulkan_reduction.h"
 #include "../../base/vulkan_runtime.h"
 
 namespace IQM::GPU {
@@ -30,8 +32,9 @@ namespace IQM::GPU {
     class FSIMFilterCombinations {
     public:
         explicit FSIMFilterCombinations(const VulkanRuntime &runtime);
+        void createBufferStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
         void combineFilters(
-            const VulkanRuntime &runtime,
+            const VulkanRuntime &runtime, FrameSlot &slot,
             const FSIMAngularFilter &angulars,
             const FSIMLogGabor &logGabor,
             const vk::raii::Buffer &fftImages,
@@ -39,31 +42,16 @@ namespace IQM::GPU {
         );
 
         vk::raii::ShaderModule multPackKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout multPacklayout = VK_NULL_HANDLE;
+        PushDescriptorLayout multPacklayout;
         vk::raii::Pipeline multPackPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout multPackDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet multPackDescSet = VK_NULL_HANDLE;
+        WorkgroupSize multPackSize;
 
         vk::raii::Buffer fftBuffer = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory fftMemory = VK_NULL_HANDLE;
 
-        // noise sum part
-        vk::raii::ShaderModule sumKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout sumLayout = VK_NULL_HANDLE;
-        vk::raii::Pipeline sumPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout sumDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet sumDescSet = VK_NULL_HANDLE;
+        // noise sum part, squared sums of the smallest scale of each orientation
+        SumReduction sum;
 
         vk::raii::Buffer noiseLevels = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory noiseLevelsMemory = VK_NULL_HANDLE;
-    private:
-        void prepareBufferStorage(
-            const VulkanRuntime &runtime,
-            const FSIMAngularFilter &angulars,
-            const FSIMLogGabor &logGabor,
-            const vk::raii::Buffer &fftImages,
-            int width, int height
-        );
     };
 }
 
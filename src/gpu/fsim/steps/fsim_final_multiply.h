@@ -5,6 +5,8 @@
 
 #ifndef FSIM_FINAL_MULTIPLY_H
 #define FSIM_FINAL_MULTIPLY_H
+#include "../../base/transient_resources.h"
+#include "../../base/vulkan_reduction.h"
 #include "../../base/vulkan_runtime.h"
 
 
@@ -12,8 +14,9 @@ namespace IQM::GPU {
     class FSIMFinalMultiply {
     public:
         explicit FSIMFinalMultiply(const VulkanRuntime& runtime);
+        void createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
         std::pair<float, float> computeMetrics(
-            const VulkanRuntime &runtime,
+            const VulkanRuntime &runtime, FrameSlot &slot,
             const std::vector<std::shared_ptr<VulkanImage>> &inputImgs,
             const std::vector<std::shared_ptr<VulkanImage>> &gradientImgs,
             const std::vector<std::shared_ptr<VulkanImage>> &pcImgs,
@@ -22,31 +25,18 @@ namespace IQM::GPU {
         );
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
+        WorkgroupSize workgroupSize;
 
         std::vector<std::shared_ptr<VulkanImage>> images;
 
-        vk::raii::ShaderModule sumKernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout sumLayout = VK_NULL_HANDLE;
-        vk::raii::Pipeline sumPipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout sumDescSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet sumDescSet = VK_NULL_HANDLE;
+        SumReduction sum;
 
+        // the three images one after another, their sums are written over the first three elements
         vk::raii::Buffer sumBuffer = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory sumMemory = VK_NULL_HANDLE;
     private:
-        void prepareImageStorage(
-            const VulkanRuntime &runtime,
-            const std::vector<std::shared_ptr<VulkanImage>> &inputImgs,
-            const std::vector<std::shared_ptr<VulkanImage>> &gradientImgs,
-            const std::vector<std::shared_ptr<VulkanImage>> &pcImgs,
-            int width,
-            int height
-        );
-        std::pair<float, float> sumImages(const VulkanRuntime & runtime, int width, int height);
+        std::pair<float, float> sumImages(const VulkanRuntime &runtime, FrameSlot &slot, int width, int height);
     };
 }
 
@@ -14,44 +14,29 @@ static uint32_t src[] =
 IQM::GPU::FSIMLogGabor::FSIMLogGabor(const VulkanRuntime &runtime) {
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
-    this->descSetLayout = std::move(runtime.createDescLayout({
+    // one filter per scale
+    this->layout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 1},
-        {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS},
-    }));
-
-    const std::vector layout = {
-        *this->descSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layout.size()),
-        .pSetLayouts = layout.data()
-    };
-
-    this->descSet = std::move(vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo}.front());
-
-    this->layout = runtime.createPipelineLayout(layout, {});
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+        {vk::DescriptorType::eStorageImage, FSIM_SCALES},
+    }, {}};
+    this->workgroupSize = runtime.workgroupSize("fsim_log_gabor", {16, 16});
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout(), this->workgroupSize);
 
     this->imageLogGaborFilters = std::vector<std::shared_ptr<VulkanImage>>(FSIM_SCALES);
 }
 
-void IQM::GPU::FSIMLogGabor::constructFilter(const VulkanRuntime &runtime, const std::shared_ptr<VulkanImage> &lowpass, int width, int height) {
-    this->prepareImageStorage(runtime, lowpass, width, height);
-
-    VulkanRuntime::initImages(runtime._cmd_buffer, this->imageLogGaborFilters);
+void IQM::GPU::FSIMLogGabor::constructFilter(const VulkanRuntime &runtime, FrameSlot &slot, const std::shared_ptr<VulkanImage> &lowpass, int width, int height) {
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    std::vector images = {lowpass};
+    images.insert(images.end(), this->imageLogGaborFilters.begin(), this->imageLogGaborFilters.end());
+    this->layout.push(slot, storageImages(images));
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, this->workgroupSize);
 
-    //shader works in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, FSIM_SCALES);
+    slot.cmd->dispatch(groupsX, groupsY, FSIM_SCALES);
 }
 
-void IQM::GPU::FSIMLogGabor::prepareImageStorage(const VulkanRuntime &runtime, const std::shared_ptr<VulkanImage> &lowpass, int width, int height) {
+void IQM::GPU::FSIMLogGabor::createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -69,27 +54,6 @@ void IQM::GPU::FSIMLogGabor::prepareImageStorage(const VulkanRuntime &runtime, c
     };
 
     for (unsigned i = 0; i < FSIM_SCALES; i++) {
-        this->imageLogGaborFilters[i] = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
+        this->imageLogGaborFilters[i] = transients.createImage(runtime, imageInfo, FSIM_STEP_LOG_GABOR, FSIM_STEP_COMBINATIONS);
     }
-
-    auto imageInfosLowpass = VulkanRuntime::createImageInfos({lowpass});
-    auto imageInfos = VulkanRuntime::createImageInfos(this->imageLogGaborFilters);
-
-    const auto writeSetLowpass = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        imageInfosLowpass
-    );
-
-    const auto writeSet = VulkanRuntime::createWriteSet(
-        this->descSet,
-        1,
-        imageInfos
-    );
-
-    const std::vector writes = {
-        writeSetLowpass, writeSet,
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
 }
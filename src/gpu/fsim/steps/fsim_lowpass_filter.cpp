@@ -5,6 +5,8 @@
 
 #include "fsim_lowpass_filter.h"
 
+#include <fsim.h>
+
 static uint32_t src[] =
 #include <fsim/fsim_lowpassfilter.inc>
 ;
@@ -12,48 +14,33 @@ static uint32_t src[] =
 IQM::GPU::FSIMLowpassFilter::FSIMLowpassFilter(const VulkanRuntime &runtime) {
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
-    const std::vector layouts = {
-        *runtime._descLayoutOneImage,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->descSet = std::move(sets[0]);
-
     // 1x float - cutoff, 1x int - order
     const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(int) + sizeof(float));
 
-    this->layout = runtime.createPipelineLayout(layouts, ranges);
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    this->layout = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageImage, 1},
+    }, ranges};
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout());
 }
 
 
-void IQM::GPU::FSIMLowpassFilter::constructFilter(const VulkanRuntime &runtime, const int width, const int height) {
-    this->prepareImageStorage(runtime, width, height);
-
-    runtime.setImageLayout(runtime._cmd_buffer, this->imageLowpassFilter->image, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+void IQM::GPU::FSIMLowpassFilter::constructFilter(const VulkanRuntime &runtime, FrameSlot &slot, const int width, const int height) {
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, storageImages({this->imageLowpassFilter}));
 
     int order = 15;
     float cutoff = 0.45;
 
-    runtime._cmd_buffer->pushConstants<float>(this->layout, vk::ShaderStageFlagBits::eCompute, 0, cutoff);
-    runtime._cmd_buffer->pushConstants<int>(this->layout, vk::ShaderStageFlagBits::eCompute, sizeof(float), order);
+    slot.cmd->pushConstants<float>(this->layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, cutoff);
+    slot.cmd->pushConstants<int>(this->layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, sizeof(float), order);
 
     //shader works in 16x16 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 16);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
+    slot.cmd->dispatch(groupsX, groupsY, 1);
 }
 
-void IQM::GPU::FSIMLowpassFilter::prepareImageStorage(const VulkanRuntime &runtime, int width, int height) {
+void IQM::GPU::FSIMLowpassFilter::createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -70,21 +57,5 @@ void IQM::GPU::FSIMLowpassFilter::prepareImageStorage(const VulkanRuntime &runti
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    this->imageLowpassFilter = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-
-    auto imageInfos = VulkanRuntime::createImageInfos({
-        this->imageLowpassFilter,
-    });
-
-    const auto writeSet = VulkanRuntime::createWriteSet(
-        descSet,
-        0,
-        imageInfos
-    );
-
-    const std::vector writes = {
-        writeSet
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
+    this->imageLowpassFilter = transients.createImage(runtime, imageInfo, FSIM_STEP_LOWPASS, FSIM_STEP_LOG_GABOR);
 }
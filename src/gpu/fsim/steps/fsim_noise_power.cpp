@@ -14,181 +14,109 @@ static uint32_t src[] =
 #include <fsim/fsim_pack_for_median.inc>
 ;
 
+// the staging ring memory is read on the host right after the slot is waited for
+static void hostReadBarrier(const IQM::GPU::FrameSlot &slot) {
+    const vk::MemoryBarrier barrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
+    };
+    slot.cmd->pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eHost,
+        {},
+        {barrier},
+        {},
+        {}
+    );
+}
+
 IQM::GPU::FSIMNoisePower::FSIMNoisePower(const VulkanRuntime &runtime) {
     auto [buf, mem] = runtime.createBuffer(
         2 * FSIM_ORIENTATIONS * sizeof(float),
         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
         vk::MemoryPropertyFlagBits::eDeviceLocal
     );
-    buf.bindMemory(mem, 0);
     this->noisePowers = std::move(buf);
     this->noisePowersMemory = std::move(mem);
 
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
-    //custom layout for this pass
-    this->descSetLayout = std::move(runtime.createDescLayout({
-        {vk::DescriptorType::eStorageBuffer, 1},
-        {vk::DescriptorType::eStorageBuffer, 1},
-    }));
-
-    const std::vector layouts = {
-        *this->descSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-
-    this->descSet = std::move(vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo}.front());
-
     // 1x uint - buffer size
     const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(unsigned));
 
-    this->layout = runtime.createPipelineLayout({this->descSetLayout}, {ranges});
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    //custom layout for this pass
+    this->layout = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageBuffer, 1},
+        {vk::DescriptorType::eStorageBuffer, 1},
+    }, ranges};
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout());
 }
 
-void IQM::GPU::FSIMNoisePower::copyBackToGpu(const VulkanRuntime &runtime, const vk::raii::Buffer& stgBuf) {
+void IQM::GPU::FSIMNoisePower::copyBackToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgBuf) {
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
+    slot.cmd->begin(beginInfo);
 
     vk::BufferCopy region {
-        .srcOffset = 0,
+        .srcOffset = stgBuf.offset(),
         .dstOffset = 0,
         .size = 2 * FSIM_ORIENTATIONS * sizeof(float),
     };
-    runtime._cmd_buffer->copyBuffer(stgBuf, this->noisePowers, {region});
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
-
-    const vk::SubmitInfo submitInfo{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data()
-    };
+    slot.cmd->copyBuffer(stgBuf.buffer(), this->noisePowers, {region});
 
-    const vk::raii::Fence fence{runtime._device, vk::FenceCreateInfo{}};
+    slot.cmd->end();
 
-    runtime._queue->submit(submitInfo, *fence);
-    runtime.waitForFence(fence);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 }
 
-void IQM::GPU::FSIMNoisePower::computeNoisePower(const VulkanRuntime &runtime, const vk::raii::Buffer& filterSums, const vk::raii::Buffer& fftBuffer, int width, int height) {
-    auto [bufTemp, memTemp] = runtime.createBuffer(
+void IQM::GPU::FSIMNoisePower::createBufferStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
+    this->tempBuffer = transients.createBuffer(
+        runtime,
         2 * FSIM_ORIENTATIONS * width * height * sizeof(float),
         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eDeviceLocal
-    );
-    bufTemp.bindMemory(memTemp, 0);
-
-    auto bufInfoIn = std::vector {
-        vk::DescriptorBufferInfo {
-            .buffer = fftBuffer,
-            .offset = 0,
-            .range = 2 * width * height * sizeof(float) * FSIM_ORIENTATIONS * FSIM_SCALES * 3,
-        }
-    };
-
-    auto bufInfoOut = std::vector {
-        vk::DescriptorBufferInfo {
-            .buffer = bufTemp,
-            .offset = 0,
-            .range = width * height * sizeof(float) * FSIM_ORIENTATIONS * 2,
-        }
-    };
-
-    const auto writeSetIn = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        bufInfoIn
-    );
-
-    const auto writeSetOut = VulkanRuntime::createWriteSet(
-        this->descSet,
-        1,
-        bufInfoOut
+        FSIM_STEP_NOISE_POWER,
+        FSIM_STEP_NOISE_POWER
     );
+}
 
-    const std::vector writes = {
-        writeSetIn, writeSetOut,
-    };
-
-    vk::MemoryBarrier barrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .dstAccessMask = vk::AccessFlagBits::eShaderRead,
-    };
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup,
-        {barrier},
-        {},
-        {}
-    );
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+void IQM::GPU::FSIMNoisePower::computeNoisePower(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer& filterSums, const vk::raii::Buffer& fftBuffer, int width, int height) {
+    runtime.beginGpuTimer(slot, "fsim noise power");
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, {
+        PushDescriptor::storageBuffer(fftBuffer, 0, 2 * width * height * sizeof(float) * FSIM_ORIENTATIONS * FSIM_SCALES * 3),
+        PushDescriptor::storageBuffer(this->tempBuffer, 0, width * height * sizeof(float) * FSIM_ORIENTATIONS * 2),
+    });
 
-    runtime._cmd_buffer->pushConstants<unsigned>(this->layout, vk::ShaderStageFlagBits::eCompute, 0, width * height);
+    slot.cmd->pushConstants<unsigned>(this->layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, width * height);
 
     auto groups = (width * height) / 256 + 1;
 
-    runtime._cmd_buffer->dispatch(groups, 1, 1);
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
+    slot.cmd->dispatch(groups, 1, 1);
+    runtime.endGpuTimer(slot);
 
-    const vk::SubmitInfo submitInfo{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data()
-    };
+    slot.cmd->end();
 
-    const vk::raii::Fence fence{runtime._device, vk::FenceCreateInfo{}};
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 
-    runtime._queue->submit(submitInfo, *fence);
-    runtime.waitForFence(fence);
+    const auto stgBuf = runtime._uploadRing->reserve(slot, 2 * FSIM_ORIENTATIONS * sizeof(float));
+    auto * bufData = static_cast<float*>(stgBuf.data());
 
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        2 * FSIM_ORIENTATIONS * sizeof(float),
-        vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    stgBuf.bindMemory(stgMem, 0);
-    auto * bufData = static_cast<float*>(stgMem.mapMemory(0,  2 * FSIM_ORIENTATIONS * sizeof(float), {}));
+    const auto filterSumsCpuBuf = runtime._readbackRing->reserve(slot, FSIM_ORIENTATIONS * sizeof(float));
+    this->copyFilterSumsToCpu(runtime, slot, filterSums, filterSumsCpuBuf);
 
-    auto [filterSumsCpuBuf, filterSumsCpuMem] = runtime.createBuffer(
-        FSIM_ORIENTATIONS * sizeof(float),
-        vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    filterSumsCpuBuf.bindMemory(filterSumsCpuMem, 0);
-    this->copyFilterSumsToCpu(runtime, filterSums, filterSumsCpuBuf);
-
-    auto * filterSumsCpu = static_cast<float*>(filterSumsCpuMem.mapMemory(0,  FSIM_ORIENTATIONS * sizeof(float), {}));
+    filterSumsCpuBuf.invalidate();
+    auto * filterSumsCpu = static_cast<float*>(filterSumsCpuBuf.data());
 
     uint64_t largeBufSize = width * height * sizeof(float) * 2 * FSIM_ORIENTATIONS;
-    auto [stgBufLarge, stgMemLarge] = runtime.createBuffer(
-        largeBufSize,
-        vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    stgBufLarge.bindMemory(stgMemLarge, 0);
-    auto * bufDataLarge = static_cast<float*>(stgMemLarge.mapMemory(0, largeBufSize, {}));
+    const auto stgBufLarge = runtime._readbackRing->reserve(slot, largeBufSize);
 
-    this->copyFilterToCpu(runtime, bufTemp, stgBufLarge, width, height);
+    this->copyFilterToCpu(runtime, slot, this->tempBuffer, stgBufLarge, width, height);
+
+    stgBufLarge.invalidate();
+    auto * bufDataLarge = static_cast<float*>(stgBufLarge.data());
 
     std::vector<float> sortBuf(width * height * 2 * FSIM_ORIENTATIONS);
     memcpy(sortBuf.data(), bufDataLarge, largeBufSize);
@@ -201,71 +129,49 @@ void IQM::GPU::FSIMNoisePower::computeNoisePower(const VulkanRuntime &runtime, c
 
         bufData[i] = mean / filterSumsCpu[i % FSIM_ORIENTATIONS];
     }
+    stgBuf.flush();
 
-    copyBackToGpu(runtime, stgBuf);
-
-    stgMemLarge.unmapMemory();
-    stgMem.unmapMemory();
+    copyBackToGpu(runtime, slot, stgBuf);
 }
 
-void IQM::GPU::FSIMNoisePower::copyFilterToCpu(const VulkanRuntime &runtime, const vk::raii::Buffer& tempBuf, const vk::raii::Buffer& target, int width, int height) {
+void IQM::GPU::FSIMNoisePower::copyFilterToCpu(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer& tempBuf, const StagingRange &target, int width, int height) {
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
+    slot.cmd->begin(beginInfo);
 
     uint64_t filterSize = width * height * sizeof(float) * 2 * FSIM_ORIENTATIONS;
 
     vk::BufferCopy region {
         .srcOffset = 0,
-        .dstOffset = 0,
+        .dstOffset = target.offset(),
         .size = filterSize,
     };
-    runtime._cmd_buffer->copyBuffer(tempBuf, target, {region});
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
+    slot.cmd->copyBuffer(tempBuf, target.buffer(), {region});
+    hostReadBarrier(slot);
 
-    const vk::SubmitInfo submitInfo{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data()
-    };
-
-    const vk::raii::Fence fence{runtime._device, vk::FenceCreateInfo{}};
+    slot.cmd->end();
 
-    runtime._queue->submit(submitInfo, *fence);
-    runtime.waitForFence(fence);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 }
 
-void IQM::GPU::FSIMNoisePower::copyFilterSumsToCpu(const VulkanRuntime &runtime, const vk::raii::Buffer &gpuSrc, const vk::raii::Buffer &cpuTarget) {
+void IQM::GPU::FSIMNoisePower::copyFilterSumsToCpu(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &gpuSrc, const StagingRange &cpuTarget) {
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
+    slot.cmd->begin(beginInfo);
 
     vk::BufferCopy region {
         .srcOffset = 0,
-        .dstOffset = 0,
+        .dstOffset = cpuTarget.offset(),
         .size = FSIM_ORIENTATIONS * sizeof(float),
     };
-    runtime._cmd_buffer->copyBuffer(gpuSrc, cpuTarget, {region});
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
-
-    const vk::SubmitInfo submitInfo{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data()
-    };
+    slot.cmd->copyBuffer(gpuSrc, cpuTarget.buffer(), {region});
+    hostReadBarrier(slot);
 
-    const vk::raii::Fence fence{runtime._device, vk::FenceCreateInfo{}};
+    slot.cmd->end();
 
-    runtime._queue->submit(submitInfo, *fence);
-    runtime.waitForFence(fence);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 }
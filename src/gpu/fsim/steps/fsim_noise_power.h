@@ -6,26 +6,28 @@
 #ifndef FSIM_NOISE_POWER_H
 #define FSIM_NOISE_POWER_H
 
+#include "../../base/transient_resources.h"
 #include "../../base/vulkan_runtime.h"
 
 namespace IQM::GPU {
     class FSIMNoisePower {
     public:
         explicit FSIMNoisePower(const VulkanRuntime &runtime);
-        void computeNoisePower(const VulkanRuntime &runtime, const vk::raii::Buffer &filterSums, const vk::raii::Buffer &fftBuffer, int width, int height);
+        void createBufferStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
+        void computeNoisePower(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &filterSums, const vk::raii::Buffer &fftBuffer, int width, int height);
 
-        vk::raii::DeviceMemory noisePowersMemory = VK_NULL_HANDLE;
+        VulkanAllocation noisePowersMemory = VK_NULL_HANDLE;
         vk::raii::Buffer noisePowers = VK_NULL_HANDLE;
+        // filter responses packed for the median, read back to the host
+        vk::raii::Buffer tempBuffer = VK_NULL_HANDLE;
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
     private:
-        void copyBackToGpu(const VulkanRuntime &runtime, const vk::raii::Buffer &stgBuf);
-        void copyFilterToCpu(const VulkanRuntime &runtime, const vk::raii::Buffer &tempBuf, const vk::raii::Buffer &target, int width, int height);
-        void copyFilterSumsToCpu(const VulkanRuntime & runtime, const vk::raii::Buffer & buffer, const vk::raii::Buffer & vk_buffer);
+        void copyBackToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgBuf);
+        void copyFilterToCpu(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &tempBuf, const StagingRange &target, int width, int height);
+        void copyFilterSumsToCpu(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &gpuSrc, const StagingRange &cpuTarget);
     };
 }
 
@@ -15,32 +15,18 @@ IQM::GPU::FSIMPhaseCongruency::FSIMPhaseCongruency(const VulkanRuntime &runtime)
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
     //custom layout for this pass
-    this->descSetLayout = std::move(runtime.createDescLayout({
+    this->layout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, 2},
         {vk::DescriptorType::eStorageBuffer, 1},
         {vk::DescriptorType::eStorageBuffer, FSIM_ORIENTATIONS * 2},
         {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS * 2},
-    }));
-
-    const std::vector layouts = {
-        *this->descSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->descSet = std::move(sets[0]);
-
-    this->layout = runtime.createPipelineLayout(layouts, {});
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    }, {}};
+    this->workgroupSize = runtime.workgroupSize("fsim_phase_congruency", {8, 8});
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout(), this->workgroupSize);
 }
 
 void IQM::GPU::FSIMPhaseCongruency::compute(
-    const VulkanRuntime &runtime,
+    const VulkanRuntime &runtime, FrameSlot &slot,
     const vk::raii::Buffer &noiseLevels,
     const std::vector<vk::raii::Buffer> &energyEstimates,
     const std::vector<std::shared_ptr<VulkanImage>> &filterResInput,
@@ -48,31 +34,27 @@ void IQM::GPU::FSIMPhaseCongruency::compute(
     int width,
     int height
     ) {
-    std::vector<std::shared_ptr<VulkanImage>> filterRes;
-    filterRes.insert(filterRes.end(), filterResInput.begin(), filterResInput.end());
-    filterRes.insert(filterRes.end(), filterResRef.begin(), filterResRef.end());
-
-    this->prepareImageStorage(runtime, noiseLevels, energyEstimates, filterRes, width, height);
-
-    VulkanRuntime::initImages(runtime._cmd_buffer, {this->pcInput, this->pcRef});
+    auto descriptors = storageImages({this->pcInput, this->pcRef});
+    descriptors.push_back(PushDescriptor::storageBuffer(noiseLevels, 0, 2 * FSIM_ORIENTATIONS * sizeof(float)));
+    for (const auto &energy : energyEstimates) {
+        descriptors.push_back(PushDescriptor::storageBuffer(energy, 0, sizeof(float)));
+    }
+    for (const auto &image : filterResInput) {
+        descriptors.push_back(PushDescriptor::storageImage(image));
+    }
+    for (const auto &image : filterResRef) {
+        descriptors.push_back(PushDescriptor::storageImage(image));
+    }
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, descriptors);
 
-    //shader works in 8x8 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 8);
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, this->workgroupSize);
 
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 2);
+    slot.cmd->dispatch(groupsX, groupsY, 2);
 }
 
-void IQM::GPU::FSIMPhaseCongruency::prepareImageStorage(
-    const VulkanRuntime &runtime,
-    const vk::raii::Buffer &noiseLevels,
-    const std::vector<vk::raii::Buffer> &energyEstimates,
-    const std::vector<std::shared_ptr<VulkanImage>> &filterRes,
-    int width,
-    int height
-    ) {
+void IQM::GPU::FSIMPhaseCongruency::createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -89,55 +71,6 @@ void IQM::GPU::FSIMPhaseCongruency::prepareImageStorage(
         .initialLayout = vk::ImageLayout::eUndefined,
     };
 
-    this->pcInput = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-    this->pcRef = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-
-    auto images = VulkanRuntime::createImageInfos({this->pcInput, this->pcRef});
-
-    const auto writePc = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        images
-    );
-
-     auto noiseBuf = std::vector{
-         vk::DescriptorBufferInfo {
-            .buffer = noiseLevels,
-            .offset = 0,
-            .range = 2 * FSIM_ORIENTATIONS * sizeof(float),
-         }
-    };
-
-    const auto writeNoiseLevelsSum = VulkanRuntime::createWriteSet(
-        this->descSet,
-        1,
-        noiseBuf
-    );
-
-    std::vector<vk::DescriptorBufferInfo> energyBufs(2 * FSIM_ORIENTATIONS);
-    for (int i = 0; i < 2 * FSIM_ORIENTATIONS; i++) {
-        energyBufs[i].buffer = energyEstimates[i];
-        energyBufs[i].offset = 0;
-        energyBufs[i].range = sizeof(float);
-    }
-
-    const auto writeEnergyLevels = VulkanRuntime::createWriteSet(
-        this->descSet,
-        2,
-        energyBufs
-    );
-
-    auto filterResInfos = VulkanRuntime::createImageInfos(filterRes);
-
-    const auto writeFilterRes = VulkanRuntime::createWriteSet(
-        this->descSet,
-        3,
-        filterResInfos
-    );
-
-    const std::vector writes = {
-        writePc, writeNoiseLevelsSum, writeEnergyLevels, writeFilterRes
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
+    this->pcInput = transients.createImage(runtime, imageInfo, FSIM_STEP_PHASE_CONGRUENCY, FSIM_STEP_FINAL_MULTIPLY);
+    this->pcRef = transients.createImage(runtime, imageInfo, FSIM_STEP_PHASE_CONGRUENCY, FSIM_STEP_FINAL_MULTIPLY);
 }
@@ -7,6 +7,7 @@
 #define FSIM_PHASE_CONGRUENCY_H
 #include <memory>
 
+#include "../../base/transient_resources.h"
 #include "../../base/vulkan_runtime.h"
 #include "../../base/vulkan_image.h"
 
@@ -14,23 +15,19 @@ namespace IQM::GPU {
     class FSIMPhaseCongruency {
     public:
         explicit FSIMPhaseCongruency(const VulkanRuntime &runtime);
-        void compute(const VulkanRuntime &runtime, const vk::raii::Buffer &noiseLevels, const std::vector<vk::raii::Buffer> &energyEstimates, const
+        void createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
+        void compute(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &noiseLevels, const std::vector<vk::raii::Buffer> &energyEstimates, const
                      std::vector<std::shared_ptr<VulkanImage>> &filterResInput, const std::vector<std::shared_ptr<VulkanImage>> &
                      filterResRef, int
                      width, int height);
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
+        WorkgroupSize workgroupSize;
 
         std::shared_ptr<VulkanImage> pcInput;
         std::shared_ptr<VulkanImage> pcRef;
-    private:
-        void prepareImageStorage(const VulkanRuntime &runtime, const vk::raii::Buffer &noiseLevels, const std::vector<vk::raii::Buffer> &energyEstimates, const
-                                 std::vector<std::shared_ptr<VulkanImage>> &filterRes, int
-                                 width, int height);
     };
 }
 
@@ -15,50 +15,34 @@ IQM::GPU::FSIMSumFilterResponses::FSIMSumFilterResponses(const VulkanRuntime &ru
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
     //custom layout for this pass
-    this->descSetLayout = std::move(runtime.createDescLayout({
+    this->layout = PushDescriptorLayout{runtime, {
         {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS},
         {vk::DescriptorType::eStorageImage, FSIM_ORIENTATIONS},
         {vk::DescriptorType::eStorageBuffer, 1},
-    }));
-
-    const std::vector layouts = {
-        *this->descSetLayout,
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(layouts.size()),
-        .pSetLayouts = layouts.data()
-    };
-
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->descSet = std::move(sets[0]);
-
-    this->layout = runtime.createPipelineLayout(layouts, {});
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    }, {}};
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout());
 
     this->filterResponsesInput = std::vector<std::shared_ptr<VulkanImage>>(FSIM_ORIENTATIONS);
     this->filterResponsesRef = std::vector<std::shared_ptr<VulkanImage>>(FSIM_ORIENTATIONS);
 }
 
-void IQM::GPU::FSIMSumFilterResponses::computeSums(const VulkanRuntime &runtime, const vk::raii::Buffer &filters, int width, int height) {
-    this->prepareImageStorage(runtime, filters, width, height);
+void IQM::GPU::FSIMSumFilterResponses::computeSums(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer &filters, int width, int height) {
+    auto images = this->filterResponsesInput;
+    images.insert(images.end(),this->filterResponsesRef.begin(),this->filterResponsesRef.end());
+
+    auto descriptors = storageImages(images);
+    descriptors.push_back(PushDescriptor::storageBuffer(filters, 0, sizeof(float) * width * height * 2 * FSIM_ORIENTATIONS * FSIM_SCALES * 3));
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, descriptors);
 
     //shader works in 16x16 tiles
     auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(width, height, 16);
 
-    // create only one barrier for all images
-    auto images = this->filterResponsesInput;
-    images.insert(images.end(),this->filterResponsesRef.begin(),this->filterResponsesRef.end());
-    VulkanRuntime::initImages(runtime._cmd_buffer, images);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS);
+    slot.cmd->dispatch(groupsX, groupsY, FSIM_ORIENTATIONS);
 }
 
-void IQM::GPU::FSIMSumFilterResponses::prepareImageStorage(const VulkanRuntime &runtime, const vk::raii::Buffer &filters, int width, int height) {
+void IQM::GPU::FSIMSumFilterResponses::createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, const int width, const int height) {
     const vk::ImageCreateInfo imageInfo = {
         .flags = {},
         .imageType = vk::ImageType::e2D,
@@ -76,42 +60,7 @@ void IQM::GPU::FSIMSumFilterResponses::prepareImageStorage(const VulkanRuntime &
     };
 
     for (int i = 0; i < FSIM_ORIENTATIONS; i++) {
-        this->filterResponsesInput[i] = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
-        this->filterResponsesRef[i] = std::make_shared<VulkanImage>(runtime.createImage(imageInfo));
+        this->filterResponsesInput[i] = transients.createImage(runtime, imageInfo, FSIM_STEP_SUM_RESPONSES, FSIM_STEP_PHASE_CONGRUENCY);
+        this->filterResponsesRef[i] = transients.createImage(runtime, imageInfo, FSIM_STEP_SUM_RESPONSES, FSIM_STEP_PHASE_CONGRUENCY);
     }
-
-    auto imageInfosIn = VulkanRuntime::createImageInfos(this->filterResponsesInput);
-    auto imageInfosRef = VulkanRuntime::createImageInfos(this->filterResponsesRef);
-
-    const auto writeSetIn = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        imageInfosIn
-    );
-
-    const auto writeSetRef = VulkanRuntime::createWriteSet(
-        this->descSet,
-        1,
-        imageInfosRef
-    );
-
-    const auto bufferInfo = std::vector{
-        vk::DescriptorBufferInfo {
-            .buffer = filters,
-            .offset = 0,
-            .range = sizeof(float) * width * height * 2 * FSIM_ORIENTATIONS * FSIM_SCALES * 3,
-        }
-    };
-
-    const auto writeSetBuf = VulkanRuntime::createWriteSet(
-        this->descSet,
-        2,
-        bufferInfo
-    );
-
-    const std::vector writes = {
-        writeSetIn, writeSetRef, writeSetBuf
-    };
-
-    runtime._device.updateDescriptorSets(writes, nullptr);
 }
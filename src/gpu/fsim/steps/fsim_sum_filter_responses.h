@@ -6,6 +6,7 @@
 #ifndef FSIM_SUM_FILTER_RESPONSES_H
 #define FSIM_SUM_FILTER_RESPONSES_H
 
+#include "../../base/transient_resources.h"
 #include "../../base/vulkan_runtime.h"
 
 namespace IQM::GPU {
@@ -15,18 +16,15 @@ namespace IQM::GPU {
     class FSIMSumFilterResponses {
     public:
         explicit FSIMSumFilterResponses(const VulkanRuntime &runtime);
-        void computeSums(const VulkanRuntime &runtime, const vk::raii::Buffer& filters, int width, int height);
+        void createImageStorage(const VulkanRuntime &runtime, TransientResources &transients, int width, int height);
+        void computeSums(const VulkanRuntime &runtime, FrameSlot &slot, const vk::raii::Buffer& filters, int width, int height);
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
 
         std::vector<std::shared_ptr<VulkanImage>> filterResponsesInput;
         std::vector<std::shared_ptr<VulkanImage>> filterResponsesRef;
-    private:
-        void prepareImageStorage(const VulkanRuntime &runtime, const vk::raii::Buffer& filters, int width, int height);
     };
 }
 
@@ -17,36 +17,31 @@ static uint32_t srcGaussInput[] =
 #include <ssim/ssim_gaussinput.inc>
 ;
 
-IQM::GPU::SSIM::SSIM(const VulkanRuntime &runtime) {
-    this->kernel = runtime.createShaderModule(src, sizeof(src));
-    this->kernelLumapack = runtime.createShaderModule(srcLumapack, sizeof(srcLumapack));
-    this->kernelGaussInput = runtime.createShaderModule(srcGaussInput, sizeof(srcGaussInput));
-
-    const std::vector layouts_3 = {
-        *runtime._descLayoutThreeImage
-    };
-
-    const std::vector layouts_2 = {
-        *runtime._descLayoutTwoImage
-    };
+static uint32_t srcFp16[] =
+#include <ssim/ssim_fp16.inc>
+;
 
-    const std::vector allocateLayouts = {
-        *runtime._descLayoutThreeImage,
-        *runtime._descLayoutThreeImage,
-        *runtime._descLayoutTwoImage
-    };
+static uint32_t srcLumapackFp16[] =
+#include <ssim/ssim_lumapack_fp16.inc>
+;
 
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = static_cast<uint32_t>(allocateLayouts.size()),
-        .pSetLayouts = allocateLayouts.data()
-    };
+static uint32_t srcGaussInputFp16[] =
+#include <ssim/ssim_gaussinput_fp16.inc>
+;
 
-    auto sets = vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo};
-    this->descSetLumapack = std::move(sets[0]);
-    this->descSet = std::move(sets[1]);
-    this->descSetGaussInput = std::move(sets[2]);
+IQM::GPU::SSIM::SSIM(const VulkanRuntime &runtime) {
+    // the luma images are 16 bit, everything else stays the same
+    if (runtime._halfPrecision) {
+        this->kernel = runtime.createShaderModule(srcFp16, sizeof(srcFp16));
+        this->kernelLumapack = runtime.createShaderModule(srcLumapackFp16, sizeof(srcLumapackFp16));
+        this->kernelGaussInput = runtime.createShaderModule(srcGaussInputFp16, sizeof(srcGaussInputFp16));
+    } else {
+        this->kernel = runtime.createShaderModule(src, sizeof(src));
+        this->kernelLumapack = runtime.createShaderModule(srcLumapack, sizeof(srcLumapack));
+        this->kernelGaussInput = runtime.createShaderModule(srcGaussInput, sizeof(srcGaussInput));
+    }
 
+    // only read by the dynamic variants, the specialized ones have the values baked in
     // 1x int - kernel size
     // 3x float - K_1, K_2, sigma
     const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(int) * 1 + sizeof(float) * 3);
@@ -55,23 +50,31 @@ IQM::GPU::SSIM::SSIM(const VulkanRuntime &runtime) {
     // 1x float - sigma
     const auto rangesGauss = VulkanRuntime::createPushConstantRange(sizeof(int) + sizeof(float));
 
-    this->layout = runtime.createPipelineLayout(layouts_3, ranges);
-    this->layoutLumapack = runtime.createPipelineLayout(layouts_3, {});
-    this->layoutGaussInput = runtime.createPipelineLayout(layouts_2, rangesGauss);
+    const std::vector<std::pair<vk::DescriptorType, uint32_t>> threeImages = {
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eStorageImage, 1},
+    };
 
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
-    this->pipelineLumapack = runtime.createComputePipeline(this->kernelLumapack, this->layoutLumapack);
-    this->pipelineGaussInput = runtime.createComputePipeline(this->kernelGaussInput, this->layoutGaussInput);
+    this->layout = PushDescriptorLayout{runtime, threeImages, ranges};
+    this->layoutLumapack = PushDescriptorLayout{runtime, threeImages, {}};
+    this->layoutGaussInput = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageImage, 1},
+        {vk::DescriptorType::eStorageImage, 1},
+    }, rangesGauss};
 
-    this->uploadDone = runtime._device.createSemaphore(vk::SemaphoreCreateInfo{});
-    this->computeDone = runtime._device.createSemaphore(vk::SemaphoreCreateInfo{});
-    this->transferFence = runtime._device.createFence(vk::FenceCreateInfo{});
-}
+    this->workgroupSize = runtime.workgroupSize("ssim", this->workgroupSize);
 
-IQM::GPU::SSIMResult IQM::GPU::SSIM::computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
-    runtime._device.resetFences({this->transferFence});
+    // variants for the default parameters are ready before the images are, other parameters are created on first use
+    const auto constants = this->passConstants();
+    this->pipelinesLumapack.preload(runtime, this->kernelLumapack, this->layoutLumapack.pipelineLayout(), constants.lumapack);
+    this->pipelinesGaussInput.preload(runtime, this->kernelGaussInput, this->layoutGaussInput.pipelineLayout(), constants.gaussInput);
+    this->pipelines.preload(runtime, this->kernel, this->layout.pipelineLayout(), constants.ssim);
+}
 
-    this->prepareImages(runtime, image, ref);
+IQM::GPU::SSIMResult IQM::GPU::SSIM::computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref) {
+    this->prepareImages(runtime, slot, image, ref);
+    this->buildGraph(runtime);
 
     SSIMResult res;
 
@@ -80,160 +83,25 @@ IQM::GPU::SSIMResult IQM::GPU::SSIM::computeMetric(const VulkanRuntime &runtime,
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineLumapack);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutLumapack, 0, {this->descSetLumapack}, {});
-
-    //shaders work in 16x16 tiles
-    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, 16);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
-
-    vk::ImageMemoryBarrier imageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderRead,
-        .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->imageLuma->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, imageMemoryBarrier
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipelineGaussInput);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layoutGaussInput, 0, {this->descSetGaussInput}, {});
-
-    std::array valuesGauss = {
-        this->kernelSize,
-        *reinterpret_cast<int *>(&this->sigma)
-    };
-    runtime._cmd_buffer->pushConstants<int>(this->layoutGaussInput, vk::ShaderStageFlagBits::eCompute, 0, valuesGauss);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
-
-    vk::ImageMemoryBarrier gaussImageMemoryBarrier = {
-        .srcAccessMask = vk::AccessFlagBits::eShaderRead,
-        .dstAccessMask = vk::AccessFlagBits::eShaderWrite,
-        .oldLayout = vk::ImageLayout::eGeneral,
-        .newLayout = vk::ImageLayout::eGeneral,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = this->imageLumaBlurred->image,
-        .subresourceRange = vk::ImageSubresourceRange {
-            .aspectMask = vk::ImageAspectFlagBits::eColor,
-            .baseMipLevel = 0,
-            .levelCount = 1,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        }
-    };
-
-    runtime._cmd_buffer->pipelineBarrier(
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::PipelineStageFlagBits::eComputeShader,
-        vk::DependencyFlagBits::eDeviceGroup, {}, {}, gaussImageMemoryBarrier
-    );
-
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
-
-    std::array values = {
-        this->kernelSize,
-        *reinterpret_cast<int *>(&this->k_1),
-        *reinterpret_cast<int *>(&this->k_2),
-        *reinterpret_cast<int *>(&this->sigma)
-    };
-    runtime._cmd_buffer->pushConstants<int>(this->layout, vk::ShaderStageFlagBits::eCompute, 0, values);
-
-    runtime._cmd_buffer->dispatch(groupsX, groupsY, 1);
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
-
-    auto mask = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eComputeShader};
-    const vk::SubmitInfo submitInfo{
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &*this->uploadDone,
-        .pWaitDstStageMask = &mask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data(),
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &*this->computeDone
-    };
-
-    runtime._queue->submit(submitInfo, {});
-    runtime.waitForFence(this->transferFence);
-
-    const auto size = this->imageParameters.height * this->imageParameters.width * sizeof(float);
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached
-    );
-    stgBuf.bindMemory(stgMem, 0);
-
-    // copy out
-    const vk::CommandBufferBeginInfo beginInfoCopy = {
-        .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
-    };
-    runtime._cmd_bufferTransfer->begin(beginInfoCopy);
-
-    vk::BufferImageCopy copyRegion{
-        .bufferOffset = 0,
-        .bufferRowLength = this->imageParameters.width,
-        .bufferImageHeight = this->imageParameters.height,
-        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
-        .imageOffset = vk::Offset3D{0, 0, 0},
-        .imageExtent = vk::Extent3D{this->imageParameters.width, this->imageParameters.height, 1}
-    };
-    runtime._cmd_bufferTransfer->copyImageToBuffer(this->imageOut->image,  vk::ImageLayout::eGeneral, stgBuf, copyRegion);
+    slot.cmd->begin(beginInfo);
+    this->graph.execute(runtime, slot);
+    slot.cmd->end();
 
-    runtime._cmd_bufferTransfer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_bufferTransfer
-    };
-
-    auto maskCopy = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTransfer};
-    const vk::SubmitInfo submitInfoCopy{
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &*this->computeDone,
-        .pWaitDstStageMask = &maskCopy,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data()
-    };
-
-    const vk::raii::Fence fenceCopy{runtime._device, vk::FenceCreateInfo{}};
-
-    runtime._transferQueue->submit(submitInfoCopy, *fenceCopy);
-    runtime._device.waitIdle();
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
+    res.timestamps.addGpu(runtime.collectGpuTimers(slot));
 
     res.timestamps.mark("end GPU pipeline");
 
     std::vector<float> outputData(this->imageParameters.height * this->imageParameters.width);
-    void * outBufData = stgMem.mapMemory(0, this->imageParameters.height * this->imageParameters.width * sizeof(float), {});
+    // cached memory is not necessarily coherent
+    this->stgOut.invalidate();
+    void * outBufData = this->stgOut.data();
     memcpy(outputData.data(), outBufData, this->imageParameters.height * this->imageParameters.width * sizeof(float));
     res.timestamps.mark("end copy from GPU");
 
     res.mssim = this->computeMSSIM( static_cast<float*>(outBufData), this->imageParameters.width, this->imageParameters.height);
     res.timestamps.mark("end MSSIM compute");
-    stgMem.unmapMemory();
 
     res.imageData = std::move(outputData);
     res.height = this->imageParameters.height;
@@ -242,38 +110,83 @@ IQM::GPU::SSIMResult IQM::GPU::SSIM::computeMetric(const VulkanRuntime &runtime,
     return res;
 }
 
-void IQM::GPU::SSIM::prepareImages(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
-    // always 4 channels on input, with 1B per channel
-    const auto size = image.width * image.height * 4;
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    auto [stgRefBuf, stgRefMem] = runtime.createBuffer(
-        size,
-        vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-
-    this->imageParameters.height = image.height;
-    this->imageParameters.width = image.width;
-
-    stgBuf.bindMemory(stgMem, 0);
-    stgRefBuf.bindMemory(stgRefMem, 0);
+IQM::GPU::SSIM::PassConstants IQM::GPU::SSIM::passConstants() const {
+    // constant ids follow the shaders, the dynamic variants ignore all but the workgroup size
+    PassConstants constants{
+        .lumapack = this->workgroupSize.constants(),
+        .gaussInput = this->workgroupSize.constants(),
+        .ssim = this->workgroupSize.constants(),
+    };
+    constants.gaussInput.add(this->kernelSize).add(this->sigma).add(!this->specialize);
+    constants.ssim.add(this->kernelSize).add(this->sigma).add(this->k_1).add(this->k_2).add(!this->specialize);
+    return constants;
+}
 
-    void * inBufData = stgMem.mapMemory(0, size, {});
-    memcpy(inBufData, image.data.data(), size);
-    stgMem.unmapMemory();
+void IQM::GPU::SSIM::buildGraph(const VulkanRuntime &runtime) {
+    // shaders work in workgroupSize tiles
+    auto [groupsX, groupsY] = VulkanRuntime::compute2DGroupCounts(this->imageParameters.width, this->imageParameters.height, this->workgroupSize);
+
+    const auto constants = this->passConstants();
+    const auto pipelineLumapack = &this->pipelinesLumapack.get(runtime, this->kernelLumapack, this->layoutLumapack.pipelineLayout(), constants.lumapack);
+    const auto pipelineGaussInput = &this->pipelinesGaussInput.get(runtime, this->kernelGaussInput, this->layoutGaussInput.pipelineLayout(), constants.gaussInput);
+    const auto pipeline = &this->pipelines.get(runtime, this->kernel, this->layout.pipelineLayout(), constants.ssim);
+
+    this->graph.addPass("ssim_lumapack", [this, groupsX, groupsY, pipelineLumapack](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipelineLumapack);
+        this->layoutLumapack.push(slot, storageImages({this->imageInput, this->imageRef, this->imageLuma}));
+        cmd.dispatch(groupsX, groupsY, 1);
+    }).read(this->imageInput).read(this->imageRef).write(this->imageLuma);
+
+    this->graph.addPass("ssim_gaussinput", [this, groupsX, groupsY, pipelineGaussInput](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipelineGaussInput);
+        this->layoutGaussInput.push(slot, storageImages({this->imageLuma, this->imageLumaBlurred}));
+
+        // pushed for specialized variants as well, the shader still declares the block
+        std::array valuesGauss = {
+            this->kernelSize,
+            *reinterpret_cast<int *>(&this->sigma)
+        };
+        cmd.pushConstants<int>(this->layoutGaussInput.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, valuesGauss);
+        cmd.dispatch(groupsX, groupsY, 1);
+    }).read(this->imageLuma).write(this->imageLumaBlurred);
+
+    this->graph.addPass("ssim", [this, groupsX, groupsY, pipeline](FrameSlot &slot, vk::raii::CommandBuffer &cmd) {
+        cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+        this->layout.push(slot, storageImages({this->imageLuma, this->imageLumaBlurred, this->imageOut}));
+
+        std::array values = {
+            this->kernelSize,
+            *reinterpret_cast<int *>(&this->k_1),
+            *reinterpret_cast<int *>(&this->k_2),
+            *reinterpret_cast<int *>(&this->sigma)
+        };
+        cmd.pushConstants<int>(this->layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, values);
+        cmd.dispatch(groupsX, groupsY, 1);
+    }).read(this->imageLuma).read(this->imageLumaBlurred).write(this->imageOut);
+
+    // copy out in the same submission, so the slot needs only one round trip
+    this->graph.addPass("ssim readback", [this](FrameSlot &, vk::raii::CommandBuffer &cmd) {
+        vk::BufferImageCopy copyRegion{
+            .bufferOffset = this->stgOut.offset(),
+            .bufferRowLength = this->imageParameters.width,
+            .bufferImageHeight = this->imageParameters.height,
+            .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
+            .imageOffset = vk::Offset3D{0, 0, 0},
+            .imageExtent = vk::Extent3D{this->imageParameters.width, this->imageParameters.height, 1}
+        };
+        cmd.copyImageToBuffer(this->imageOut->image,  vk::ImageLayout::eGeneral, this->stgOut.buffer(), copyRegion);
+    }).transferRead(this->imageOut).transferWrite(this->stgOut.buffer());
+
+    this->graph.readback(this->stgOut.buffer());
+    this->graph.compile(runtime);
+}
 
-    inBufData = stgRefMem.mapMemory(0, size, {});
-    memcpy(inBufData, ref.data.data(), size);
-    stgRefMem.unmapMemory();
+void IQM::GPU::SSIM::prepareImages(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref) {
+    const auto outSize = image.width * image.height * sizeof(float);
+    this->stgOut = runtime._readbackRing->reserve(slot, outSize);
 
-    this->stgInput = std::move(stgBuf);
-    this->stgInputMemory = std::move(stgMem);
-    this->stgRef = std::move(stgRefBuf);
-    this->stgRefMemory = std::move(stgRefMem);
+    this->imageParameters.height = image.height;
+    this->imageParameters.width = image.width;
 
     vk::ImageCreateInfo srcImageInfo = {
         .flags = {},
@@ -292,95 +205,38 @@ void IQM::GPU::SSIM::prepareImages(const VulkanRuntime &runtime, const InputImag
     };
 
     vk::ImageCreateInfo lumaImageInfo {srcImageInfo};
-    lumaImageInfo.format = vk::Format::eR32G32Sfloat;
+    lumaImageInfo.format = runtime.intermediateFormat(2);
     lumaImageInfo.usage = vk::ImageUsageFlagBits::eStorage;
 
     vk::ImageCreateInfo dstImageInfo = {srcImageInfo};
     dstImageInfo.usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc;
     dstImageInfo.format = vk::Format::eR32Sfloat;
 
-    this->imageInput = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-    this->imageRef = std::make_shared<VulkanImage>(runtime.createImage(srcImageInfo));
-    this->imageOut = std::make_shared<VulkanImage>(runtime.createImage(dstImageInfo));
-    this->imageLuma = std::make_shared<VulkanImage>(runtime.createImage(lumaImageInfo));
-    this->imageLumaBlurred = std::make_shared<VulkanImage>(runtime.createImage(lumaImageInfo));
+    // intermediate images are kept by the graph and reused if the resolution did not change
+    this->graph.reset();
+    // dropped first, so the cache can hand them out again
+    this->imageInput.reset();
+    this->imageRef.reset();
+    // written by the host directly where the device allows it
+    this->imageInput = runtime.acquireInputImage(srcImageInfo);
+    this->imageRef = runtime.acquireInputImage(srcImageInfo);
+    this->imageOut = this->graph.createTransientImage(runtime, dstImageInfo);
+    this->imageLuma = this->graph.createTransientImage(runtime, lumaImageInfo);
+    this->imageLumaBlurred = this->graph.createTransientImage(runtime, lumaImageInfo);
 
     // copy data to images, correct formats
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_bufferTransfer->begin(beginInfo);
-
-    VulkanRuntime::initImages(runtime._cmd_bufferTransfer, {
-        this->imageInput,
-        this->imageRef,
-        this->imageOut,
-        this->imageLuma,
-        this->imageLumaBlurred,
-    });
-
-    vk::BufferImageCopy copyRegion{
-        .bufferOffset = 0,
-        .bufferRowLength = this->imageParameters.width,
-        .bufferImageHeight = this->imageParameters.height,
-        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1},
-        .imageOffset = vk::Offset3D{0, 0, 0},
-        .imageExtent = vk::Extent3D{this->imageParameters.width, this->imageParameters.height, 1}
-    };
-    runtime._cmd_bufferTransfer->copyBufferToImage(this->stgInput, this->imageInput->image,  vk::ImageLayout::eGeneral, copyRegion);
-    runtime._cmd_bufferTransfer->copyBufferToImage(this->stgRef, this->imageRef->image,  vk::ImageLayout::eGeneral, copyRegion);
-
-    runtime._cmd_bufferTransfer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_bufferTransfer
-    };
-
-    const vk::SubmitInfo submitInfoCopy{
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data(),
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &*this->uploadDone
-    };
-
-    runtime._transferQueue->submit(submitInfoCopy, this->transferFence);
-
-    auto imageInfos = VulkanRuntime::createImageInfos({
-        this->imageLuma,
-        this->imageLumaBlurred,
-        this->imageOut,
-    });
-
-    auto writeSet = VulkanRuntime::createWriteSet(
-        this->descSet,
-        0,
-        imageInfos
-    );
-
-    auto lumapackImageInfos = VulkanRuntime::createImageInfos({
-        this->imageInput,
-        this->imageRef,
-        this->imageLuma,
-    });
-
-    auto writeSetLumapack = VulkanRuntime::createWriteSet(
-        this->descSetLumapack,
-        0,
-        lumapackImageInfos
-    );
-
-    auto gaussInputImageInfos = VulkanRuntime::createImageInfos({
-        this->imageLuma,
-        this->imageLumaBlurred,
-    });
-
-    auto writeSetGauss = VulkanRuntime::createWriteSet(
-        this->descSetGaussInput,
-        0,
-        gaussInputImageInfos
-    );
-
-    runtime._device.updateDescriptorSets({writeSet, writeSetLumapack, writeSetGauss}, nullptr);
+    slot.cmdTransfer->begin(beginInfo);
+    const bool inputRecorded = runtime.uploadInputImage(slot, this->imageInput, image);
+    const bool refRecorded = runtime.uploadInputImage(slot, this->imageRef, ref);
+    slot.cmdTransfer->end();
+
+    // reused zero copy inputs need no GPU work at all
+    if (inputRecorded || refRecorded) {
+        runtime.submitSlot(slot, SlotQueue::Transfer);
+    }
 }
 
 double IQM::GPU::SSIM::computeMSSIM(const float* buffer, unsigned width, unsigned height) const {
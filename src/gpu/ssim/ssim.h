@@ -10,6 +10,7 @@
 
 #include "../../input_image.h"
 #include "../img_params.h"
+#include "../base/render_graph.h"
 #include "../base/vulkan_runtime.h"
 #include "../../timestamps.h"
 
@@ -25,39 +26,44 @@ namespace IQM::GPU {
     class SSIM {
     public:
         explicit SSIM(const VulkanRuntime &runtime);
-        SSIMResult computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref);
+        SSIMResult computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref);
         [[nodiscard]] double computeMSSIM(const float *buffer, unsigned width, unsigned height) const;
 
         int kernelSize = 11;
         float k_1 = 0.01;
         float k_2 = 0.03;
         float sigma = 1.5;
+        // shared by all passes, the tuned size of the "ssim" kernel if there is one
+        WorkgroupSize workgroupSize{16, 16};
+        // pipelines are specialized for the parameters above, disabling it is only useful for comparison
+        bool specialize = true;
     private:
+        // specialization constants of the passes for the current parameters
+        struct PassConstants {
+            SpecializationConstants lumapack;
+            SpecializationConstants gaussInput;
+            SpecializationConstants ssim;
+        };
+
         ImageParameters imageParameters;
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
-        vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
+        PipelineVariants pipelines;
 
         vk::raii::ShaderModule kernelLumapack = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layoutLumapack = VK_NULL_HANDLE;
-        vk::raii::Pipeline pipelineLumapack = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetLumapack = VK_NULL_HANDLE;
+        PushDescriptorLayout layoutLumapack;
+        PipelineVariants pipelinesLumapack;
 
         vk::raii::ShaderModule kernelGaussInput = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layoutGaussInput = VK_NULL_HANDLE;
-        vk::raii::Pipeline pipelineGaussInput = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSetGaussInput = VK_NULL_HANDLE;
+        PushDescriptorLayout layoutGaussInput;
+        PipelineVariants pipelinesGaussInput;
 
-        vk::raii::Semaphore uploadDone = VK_NULL_HANDLE;
-        vk::raii::Semaphore computeDone = VK_NULL_HANDLE;
+        // reserved from the runtime's readback ring for the slot the metric is computed in
+        StagingRange stgOut = VK_NULL_HANDLE;
 
-        vk::raii::Fence transferFence = VK_NULL_HANDLE;
-        vk::raii::Buffer stgInput = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgInputMemory = VK_NULL_HANDLE;
-        vk::raii::Buffer stgRef = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgRefMemory = VK_NULL_HANDLE;
+        // owns the memory of the transient images, declared before them so it is destroyed last
+        RenderGraph graph;
 
         std::shared_ptr<VulkanImage> imageInput;
         std::shared_ptr<VulkanImage> imageRef;
@@ -65,7 +71,9 @@ namespace IQM::GPU {
         std::shared_ptr<VulkanImage> imageLumaBlurred;
         std::shared_ptr<VulkanImage> imageOut;
 
-        void prepareImages(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref);
+        void prepareImages(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref);
+        [[nodiscard]] PassConstants passConstants() const;
+        void buildGraph(const VulkanRuntime &runtime);
     };
 }
 
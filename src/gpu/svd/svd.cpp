@@ -17,26 +17,17 @@ static uint32_t src[] =
 IQM::GPU::SVD::SVD(const VulkanRuntime &runtime) {
     this->kernel = runtime.createShaderModule(src, sizeof(src));
 
-    const std::vector layouts = {
-        *runtime._descLayoutBuffer
-    };
-
-    vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo = {
-        .descriptorPool = runtime._descPool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = layouts.data()
-    };
-
-    this->descSet = std::move(vk::raii::DescriptorSets{runtime._device, descriptorSetAllocateInfo}.front());
-
     // 1x int - buffer size
     const auto ranges = VulkanRuntime::createPushConstantRange(sizeof(int) * 1);
 
-    this->layout = runtime.createPipelineLayout(layouts, ranges);
-    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout);
+    this->layout = PushDescriptorLayout{runtime, {
+        {vk::DescriptorType::eStorageBuffer, 1},
+        {vk::DescriptorType::eStorageBuffer, 1},
+    }, ranges};
+    this->pipeline = runtime.createComputePipeline(this->kernel, this->layout.pipelineLayout());
 }
 
-IQM::GPU::SVDResult IQM::GPU::SVD::computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref) {
+IQM::GPU::SVDResult IQM::GPU::SVD::computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref) {
     SVDResult res;
 
     auto bufSize = 2 * 8 * (image.width / 8) * (image.height / 8);
@@ -47,10 +38,9 @@ IQM::GPU::SVDResult IQM::GPU::SVD::computeMetric(const VulkanRuntime &runtime, c
 
     res.timestamps.mark("buffers prepared");
 
-    cv::Mat inputColor(image.data);
-    inputColor = inputColor.reshape(4, image.height);
-    cv::Mat refColor(ref.data);
-    refColor = refColor.reshape(4, image.height);
+    // wraps the decoded pixels, cvtColor only reads them
+    const cv::Mat inputColor(image.height, image.width, CV_8UC4, const_cast<unsigned char *>(image.data.data()));
+    const cv::Mat refColor(ref.height, ref.width, CV_8UC4, const_cast<unsigned char *>(ref.data.data()));
 
     cv::Mat greyInput;
     cv::cvtColor(inputColor, greyInput, cv::COLOR_RGB2GRAY);
@@ -88,52 +78,45 @@ IQM::GPU::SVDResult IQM::GPU::SVD::computeMetric(const VulkanRuntime &runtime, c
 
     res.timestamps.mark("end SVD compute");
 
-    void * inBufData = this->stgMemory.mapMemory(0, bufSize * sizeof(float), {});
-    memcpy(inBufData, data.data(), bufSize * sizeof(float));
-    this->stgMemory.unmapMemory();
+    const auto stgInput = runtime._uploadRing->reserve(slot, bufSize * sizeof(float));
+    memcpy(stgInput.data(), data.data(), bufSize * sizeof(float));
+    stgInput.flush();
 
-    this->copyToGpu(runtime, bufSize * sizeof(float), outBufSize * sizeof(float));
+    this->copyToGpu(runtime, slot, stgInput);
 
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
+    slot.cmd->begin(beginInfo);
 
-    runtime._cmd_buffer->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
-    runtime._cmd_buffer->bindDescriptorSets(vk::PipelineBindPoint::eCompute, this->layout, 0, {this->descSet}, {});
-    runtime._cmd_buffer->pushConstants<int>(this->layout, vk::ShaderStageFlagBits::eCompute, 0, bufSize);
+    runtime.beginGpuTimer(slot, "svd");
+    slot.cmd->bindPipeline(vk::PipelineBindPoint::eCompute, this->pipeline);
+    this->layout.push(slot, {
+        PushDescriptor::storageBuffer(this->inputBuffer, 0, bufSize * sizeof(float)),
+        PushDescriptor::storageBuffer(this->outBuffer, 0, outBufSize * sizeof(float)),
+    });
+    slot.cmd->pushConstants<int>(this->layout.pipelineLayout(), vk::ShaderStageFlagBits::eCompute, 0, bufSize);
 
     // group takes 128 values, reduces to 8 values
     auto groupsX = (bufSize / 128) + 1;
-    runtime._cmd_buffer->dispatch(groupsX, 1, 1);
-
-    runtime._cmd_buffer->end();
+    slot.cmd->dispatch(groupsX, 1, 1);
+    runtime.endGpuTimer(slot);
 
-    const std::vector cmdBufs = {
-        &**runtime._cmd_buffer
-    };
-
-    auto mask = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eComputeShader};
-    const vk::SubmitInfo submitInfo{
-        .pWaitDstStageMask = &mask,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufs.data()
-    };
-
-    const vk::raii::Fence fence{runtime._device, vk::FenceCreateInfo{}};
+    slot.cmd->end();
 
-    runtime._queue->submit(submitInfo, *fence);
-    runtime._device.waitIdle();
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
+    res.timestamps.addGpu(runtime.collectGpuTimers(slot));
 
     res.timestamps.mark("GPU sum computed");
 
-    this->copyFromGpu(runtime, outBufSize * sizeof(float));
+    const auto stgOutput = runtime._readbackRing->reserve(slot, outBufSize * sizeof(float));
+    this->copyFromGpu(runtime, slot, stgOutput);
 
     cv::Mat dummy;
     dummy.create(image.height / 8, image.width / 8, CV_32F);
-    void * outBufData = this->stgMemory.mapMemory(0, outBufSize * sizeof(float), {});
-    memcpy(dummy.data, outBufData, outBufSize * sizeof(float));
-    this->stgMemory.unmapMemory();
+    stgOutput.invalidate();
+    memcpy(dummy.data, stgOutput.data(), outBufSize * sizeof(float));
 
     res.timestamps.mark("end GPU writeback");
 
@@ -164,24 +147,11 @@ IQM::GPU::SVDResult IQM::GPU::SVD::computeMetric(const VulkanRuntime &runtime, c
 }
 
 void IQM::GPU::SVD::prepareBuffers(const VulkanRuntime &runtime, size_t sizeInput, size_t sizeOutput) {
-    assert(sizeInput > sizeOutput);
-
-    // one staging buffer should be enough
-    auto [stgBuf, stgMem] = runtime.createBuffer(
-        sizeInput,
-        vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-    stgBuf.bindMemory(stgMem, 0);
-    this->stgBuffer = std::move(stgBuf);
-    this->stgMemory = std::move(stgMem);
-
     auto [buf, mem] = runtime.createBuffer(
         sizeInput,
         vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
         vk::MemoryPropertyFlagBits::eDeviceLocal
     );
-    buf.bindMemory(mem, 0);
     this->inputBuffer = std::move(buf);
     this->inputMemory = std::move(mem);
 
@@ -190,98 +160,51 @@ void IQM::GPU::SVD::prepareBuffers(const VulkanRuntime &runtime, size_t sizeInpu
         vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eStorageBuffer,
         vk::MemoryPropertyFlagBits::eDeviceLocal
     );
-    outBuf.bindMemory(outMem, 0);
     this->outBuffer = std::move(outBuf);
     this->outMemory = std::move(outMem);
 }
 
-void IQM::GPU::SVD::copyToGpu(const VulkanRuntime &runtime, size_t sizeInput, size_t sizeOutput) {
+void IQM::GPU::SVD::copyToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgInput) {
     const vk::CommandBufferBeginInfo beginInfo = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfo);
+    slot.cmd->begin(beginInfo);
 
     vk::BufferCopy copyRegion{
-        .srcOffset = 0,
+        .srcOffset = stgInput.offset(),
         .dstOffset = 0,
-        .size = sizeInput,
-    };
-    runtime._cmd_buffer->copyBuffer(this->stgBuffer, this->inputBuffer, copyRegion);
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_buffer
-    };
-
-    auto maskCopy = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eAllCommands};
-    const vk::SubmitInfo submitInfoCopy{
-        .pWaitDstStageMask = &maskCopy,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data()
+        .size = stgInput.size(),
     };
+    slot.cmd->copyBuffer(stgInput.buffer(), this->inputBuffer, copyRegion);
 
-    const vk::raii::Fence fenceCopy{runtime._device, vk::FenceCreateInfo{}};
-
-    runtime._queue->submit(submitInfoCopy, *fenceCopy);
-    runtime._device.waitIdle();
-
-    std::vector bufInfos = {
-        vk::DescriptorBufferInfo {
-            .buffer = this->inputBuffer,
-            .offset = 0,
-            .range = sizeInput,
-        },
-        vk::DescriptorBufferInfo {
-            .buffer = this->outBuffer,
-            .offset = 0,
-            .range = sizeOutput,
-        },
-    };
-
-    vk::WriteDescriptorSet writeSet{
-        .dstSet = this->descSet,
-        .dstBinding = 0,
-        .dstArrayElement = 0,
-        .descriptorCount = 2,
-        .descriptorType = vk::DescriptorType::eStorageBuffer,
-        .pImageInfo = nullptr,
-        .pBufferInfo = bufInfos.data(),
-        .pTexelBufferView = nullptr,
-    };
+    slot.cmd->end();
 
-    runtime._device.updateDescriptorSets(writeSet, nullptr);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 }
 
-void IQM::GPU::SVD::copyFromGpu(const VulkanRuntime &runtime, size_t sizeOutput) {
-    runtime._cmd_buffer->reset();
+void IQM::GPU::SVD::copyFromGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgOutput) {
+    slot.cmd->reset();
     const vk::CommandBufferBeginInfo beginInfoCopy = {
         .flags = vk::CommandBufferUsageFlags{vk::CommandBufferUsageFlagBits::eOneTimeSubmit},
     };
-    runtime._cmd_buffer->begin(beginInfoCopy);
+    slot.cmd->begin(beginInfoCopy);
 
     vk::BufferCopy copyRegion{
         .srcOffset = 0,
-        .dstOffset = 0,
-        .size = sizeOutput,
-    };
-    runtime._cmd_buffer->copyBuffer(this->outBuffer, this->stgBuffer, copyRegion);
-
-    runtime._cmd_buffer->end();
-
-    const std::vector cmdBufsCopy = {
-        &**runtime._cmd_buffer
+        .dstOffset = stgOutput.offset(),
+        .size = stgOutput.size(),
     };
+    slot.cmd->copyBuffer(this->outBuffer, stgOutput.buffer(), copyRegion);
 
-    auto maskCopy = vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTransfer};
-    const vk::SubmitInfo submitInfoCopy{
-        .pWaitDstStageMask = &maskCopy,
-        .commandBufferCount = 1,
-        .pCommandBuffers = *cmdBufsCopy.data()
+    const vk::MemoryBarrier barrier = {
+        .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+        .dstAccessMask = vk::AccessFlagBits::eHostRead,
     };
+    slot.cmd->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {barrier}, {}, {});
 
-    const vk::raii::Fence fenceCopy{runtime._device, vk::FenceCreateInfo{}};
+    slot.cmd->end();
 
-    runtime._queue->submit(submitInfoCopy, *fenceCopy);
-    runtime.waitForFence(fenceCopy);
+    runtime.submitSlot(slot);
+    runtime.waitForSlot(slot);
 }
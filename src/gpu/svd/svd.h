@@ -25,25 +25,21 @@ namespace IQM::GPU {
     class SVD {
     public:
         explicit SVD(const VulkanRuntime &runtime);
-        SVDResult computeMetric(const VulkanRuntime &runtime, const InputImage &image, const InputImage &ref);
+        SVDResult computeMetric(const VulkanRuntime &runtime, FrameSlot &slot, const InputImage &image, const InputImage &ref);
 
     private:
         void prepareBuffers(const VulkanRuntime &runtime, size_t sizeInput, size_t sizeOutput);
-        void copyToGpu(const VulkanRuntime &runtime, size_t sizeInput, size_t sizeOutput);
-        void copyFromGpu(const VulkanRuntime &runtime, size_t sizeOutput);
+        void copyToGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgInput);
+        void copyFromGpu(const VulkanRuntime &runtime, FrameSlot &slot, const StagingRange &stgOutput);
 
         vk::raii::ShaderModule kernel = VK_NULL_HANDLE;
-        vk::raii::PipelineLayout layout = VK_NULL_HANDLE;
+        PushDescriptorLayout layout;
         vk::raii::Pipeline pipeline = VK_NULL_HANDLE;
-        vk::raii::DescriptorSet descSet = VK_NULL_HANDLE;
 
         vk::raii::Buffer inputBuffer = VK_NULL_HANDLE;
         vk::raii::Buffer outBuffer = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory inputMemory = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory outMemory = VK_NULL_HANDLE;
-
-        vk::raii::Buffer stgBuffer = VK_NULL_HANDLE;
-        vk::raii::DeviceMemory stgMemory = VK_NULL_HANDLE;
+        VulkanAllocation inputMemory = VK_NULL_HANDLE;
+        VulkanAllocation outMemory = VK_NULL_HANDLE;
     };
 }
 
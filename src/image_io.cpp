@@ -0,0 +1,170 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "image_io.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+// stb_image only passes the pointer to STBI_FREE, so every allocation is preceded by a header saying how it was made;
+// the header sits right before the returned pointer, so the pointer keeps the alignment of its allocation
+struct StbiHeader {
+    bool importable;
+};
+
+static constexpr size_t STBI_HEADER_SIZE = alignof(std::max_align_t);
+static constexpr size_t STBI_IMPORT_ALIGNMENT = HostImportAllocator<unsigned char>::ALIGNMENT;
+// only buffers large enough to be a decoded image are import aligned, scratch buffers of the decoders stay small
+static constexpr size_t STBI_IMPORT_THRESHOLD = 1024 * 1024;
+
+static StbiHeader *stbiHeader(void *p) {
+    return reinterpret_cast<StbiHeader *>(static_cast<unsigned char *>(p) - STBI_HEADER_SIZE);
+}
+
+// stb_image expects NULL on failure and reports it as a normal load error, so nothing here may throw
+static void *stbiMalloc(const size_t size) {
+    if (size >= STBI_IMPORT_THRESHOLD) {
+        // a whole alignment block in front of the data keeps both its start and its end on the import alignment
+        const auto allocationSize = STBI_IMPORT_ALIGNMENT + HostImportAllocator<unsigned char>::allocationSize(size);
+        auto *base = static_cast<unsigned char *>(::operator new(allocationSize, std::align_val_t{STBI_IMPORT_ALIGNMENT}, std::nothrow));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        auto *p = base + STBI_IMPORT_ALIGNMENT;
+        stbiHeader(p)->importable = true;
+        return p;
+    }
+
+    auto *base = static_cast<unsigned char *>(std::malloc(STBI_HEADER_SIZE + size));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    auto *p = base + STBI_HEADER_SIZE;
+    stbiHeader(p)->importable = false;
+    return p;
+}
+
+static void stbiFree(void *p) {
+    if (p == nullptr) {
+        return;
+    }
+    if (stbiHeader(p)->importable) {
+        ::operator delete(static_cast<unsigned char *>(p) - STBI_IMPORT_ALIGNMENT, std::align_val_t{STBI_IMPORT_ALIGNMENT});
+    } else {
+        std::free(static_cast<unsigned char *>(p) - STBI_HEADER_SIZE);
+    }
+}
+
+static void *stbiRealloc(void *p, const size_t oldSize, const size_t newSize) {
+    if (p == nullptr) {
+        return stbiMalloc(newSize);
+    }
+
+    if (stbiHeader(p)->importable) {
+        // the padding up to the import alignment is already allocated, the zlib output grows into it
+        if (newSize <= HostImportAllocator<unsigned char>::allocationSize(oldSize)) {
+            return p;
+        }
+    } else if (newSize < STBI_IMPORT_THRESHOLD) {
+        auto *base = static_cast<unsigned char *>(std::realloc(static_cast<unsigned char *>(p) - STBI_HEADER_SIZE, STBI_HEADER_SIZE + newSize));
+        return base == nullptr ? nullptr : base + STBI_HEADER_SIZE;
+    }
+
+    auto *resized = stbiMalloc(newSize);
+    if (resized != nullptr) {
+        memcpy(resized, p, std::min(oldSize, newSize));
+        stbiFree(p);
+    }
+    return resized;
+}
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_FAILURE_USERMSG
+#define STBI_MALLOC(sz) stbiMalloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) stbiRealloc(p, oldsz, newsz)
+#define STBI_FREE(p) stbiFree(p)
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+InputImage load_image(const std::string &filename) {
+    // force all images to always open in RGBA format to prevent issues with separate RGB and RGBA loading
+    int x, y, channels;
+    unsigned char* data = stbi_load(filename.c_str(), &x, &y, &channels, 4);
+    if (data == nullptr) {
+        const auto err = stbi_failure_reason();
+        const auto msg = std::string("Failed to load image '" + filename + "', reason: " + err);
+        throw std::runtime_error(msg);
+    }
+
+    // the view points into the buffer stb_image decoded to, freed with the last copy of the view
+    const std::shared_ptr<const void> owner(data, [](const void *p) {
+        stbi_image_free(const_cast<void *>(p));
+    });
+
+    return InputImage{
+        .width = x,
+        .height = y,
+        .data = std::span<const unsigned char>(data, static_cast<size_t>(x) * y * 4),
+        .owner = owner,
+        // small images come from the plain heap and are copied into staging memory instead
+        .hostAlignment = stbiHeader(data)->importable ? STBI_IMPORT_ALIGNMENT : 0,
+    };
+}
+
+std::optional<std::pair<int, int>> read_image_size(const std::string &filename) {
+    int x, y, channels;
+    if (stbi_info(filename.c_str(), &x, &y, &channels) == 0) {
+        return std::nullopt;
+    }
+    return std::pair{x, y};
+}
+
+void save_image(const std::string &filename, const std::vector<float> &data, const unsigned width, const unsigned height) {
+    std::vector<unsigned char> converted(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        converted[i] = static_cast<unsigned char>(data[i] * 255.0f);
+    }
+
+    const auto saveResult = stbi_write_png(filename.c_str(), static_cast<int>(width), static_cast<int>(height), 1, converted.data(), static_cast<int>(width));
+    if (saveResult == 0) {
+        throw std::runtime_error("Failed to save output image '" + filename + "'");
+    }
+}
+
+ImagePairLoader::ImagePairLoader(const std::string &inputPath, const std::string &refPath) {
+    this->_total.start = std::chrono::high_resolution_clock::now();
+    this->_inputFuture = std::async(std::launch::async, decode, inputPath);
+    this->_referenceFuture = std::async(std::launch::async, decode, refPath);
+}
+
+std::pair<InputImage, InputImage> ImagePairLoader::wait() {
+    this->_wait.start = std::chrono::high_resolution_clock::now();
+    auto input = this->_inputFuture.get();
+    auto reference = this->_referenceFuture.get();
+    this->_wait.end = std::chrono::high_resolution_clock::now();
+
+    this->_total.end = this->_wait.end;
+    this->_input = input.timing;
+    this->_reference = reference.timing;
+
+    if (input.image.width != reference.image.width || input.image.height != reference.image.height) {
+        throw std::runtime_error("Compared images must have the same size");
+    }
+
+    return {std::move(input.image), std::move(reference.image)};
+}
+
+ImagePairLoader::Decoded ImagePairLoader::decode(const std::string &path) {
+    Decoded decoded{};
+    decoded.timing.start = std::chrono::high_resolution_clock::now();
+    decoded.image = load_image(path);
+    decoded.timing.end = std::chrono::high_resolution_clock::now();
+    return decoded;
+}
@@ -0,0 +1,61 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_IMAGE_IO_H
+#define IQM_IMAGE_IO_H
+
+#include <chrono>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "input_image.h"
+
+// always loads as RGBA, 1B per channel
+InputImage load_image(const std::string &filename);
+
+// width and height from the header only, nullopt if the file cannot be read
+std::optional<std::pair<int, int>> read_image_size(const std::string &filename);
+
+// saves a single channel image with values in [0, 1] as a grayscale PNG
+void save_image(const std::string &filename, const std::vector<float> &data, unsigned width, unsigned height);
+
+struct DecodeTiming {
+    std::chrono::time_point<std::chrono::high_resolution_clock> start;
+    std::chrono::time_point<std::chrono::high_resolution_clock> end;
+};
+
+/**
+ * Decodes the input and reference image of a pair on two threads of their own,
+ * so the caller can initialize Vulkan and the metric while the images decode.
+ */
+class ImagePairLoader {
+public:
+    ImagePairLoader(const std::string &inputPath, const std::string &refPath);
+
+    // blocks until both images are decoded, throws if either fails to load or their sizes differ
+    std::pair<InputImage, InputImage> wait();
+
+    // valid after wait(), _total spans from the constructor until both images are joined
+    DecodeTiming _total{};
+    DecodeTiming _input{};
+    DecodeTiming _reference{};
+    // time spent blocked in wait()
+    DecodeTiming _wait{};
+
+private:
+    struct Decoded {
+        InputImage image;
+        DecodeTiming timing;
+    };
+
+    static Decoded decode(const std::string &path);
+
+    std::future<Decoded> _inputFuture;
+    std::future<Decoded> _referenceFuture;
+};
+
+#endif //IQM_IMAGE_IO_H
@@ -6,12 +6,69 @@
 #ifndef INPUT_IMAGE_H
 #define INPUT_IMAGE_H
 
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
 #include <vector>
 
+/**
+ * Allocations start and end on an ALIGNMENT boundary, so the runtime can import pixel data
+ * as a Vulkan buffer (VK_EXT_external_memory_host) instead of copying it into staging memory.
+ */
+template <typename T>
+struct HostImportAllocator {
+    using value_type = T;
+    // covers minImportedHostPointerAlignment of known implementations, mostly one 4 KiB page
+    static constexpr std::size_t ALIGNMENT = 64 * 1024;
+
+    HostImportAllocator() = default;
+    template <typename U>
+    HostImportAllocator(const HostImportAllocator<U> &) noexcept {}
+
+    static std::size_t allocationSize(const std::size_t n) {
+        return (n * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    T *allocate(const std::size_t n) {
+        return static_cast<T *>(::operator new(allocationSize(n), std::align_val_t{ALIGNMENT}));
+    }
+
+    void deallocate(T *p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t{ALIGNMENT});
+    }
+
+    template <typename U>
+    bool operator==(const HostImportAllocator<U> &) const noexcept { return true; }
+};
+
+using PixelData = std::vector<unsigned char, HostImportAllocator<unsigned char>>;
+
+/**
+ * Non-owning view of RGBA pixels, 1B per channel with tightly packed rows.
+ *
+ * The pixels stay wherever they were decoded or written, owner only keeps that memory alive,
+ * so views can be copied and passed between threads without copying the pixels.
+ */
 struct InputImage {
     int width;
     int height;
-    std::vector<unsigned char> data;
+    std::span<const unsigned char> data;
+    std::shared_ptr<const void> owner;
+    // start and end of the allocation behind data are aligned to this, 0 if the memory must not be imported
+    std::size_t hostAlignment = 0;
+
+    // takes over pixels written by the caller
+    static InputImage fromPixels(const int width, const int height, PixelData &&pixels) {
+        auto storage = std::make_shared<const PixelData>(std::move(pixels));
+        return InputImage{
+            .width = width,
+            .height = height,
+            .data = std::span(storage->data(), storage->size()),
+            .owner = storage,
+            .hostAlignment = PixelData::allocator_type::ALIGNMENT,
+        };
+    }
 };
 
 #endif //INPUT_IMAGE_H
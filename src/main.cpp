@@ -3,20 +3,20 @@
  * Petr Volf - 2024
  */
 
+#include <algorithm>
 #include <iostream>
 #include <chrono>
-
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_FAILURE_USERMSG
-#include "stb_image.h"
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include <cmath>
+#include <cstdlib>
 
 #include "args.h"
+#include "autotune.h"
+#include "batch.h"
 #include "gpu/base/vulkan_runtime.h"
 #include "debug_utils.h"
+#include "image_io.h"
 #include "input_image.h"
+#include "server.h"
 
 #if COMPILE_SSIM
 #include <ssim.h>
@@ -34,60 +34,162 @@
 #include <flip.h>
 #endif
 
-InputImage load_image(const std::string &filename) {
-    // force all images to always open in RGBA format to prevent issues with separate RGB and RGBA loading
-    int x, y, channels;
-    unsigned char* data = stbi_load(filename.c_str(), &x, &y, &channels, 4);
-    if (data == nullptr) {
-        const auto err = stbi_failure_reason();
-        const auto msg = std::string("Failed to load image '" + filename + "', reason: " + err);
-        throw std::runtime_error(msg);
+IQM::GPU::VulkanRuntimeConfig runtimeConfig(const IQM::Args& args) {
+    IQM::GPU::VulkanRuntimeConfig config{};
+
+    // command line takes precedence over environment
+    if (args.device.has_value()) {
+        config.device = args.device;
+    } else if (const char *device = std::getenv("IQM_DEVICE"); device != nullptr && device[0] != '\0') {
+        config.device = std::string(device);
     }
 
-    std::vector<unsigned char> dataVec(x * y * 4);
-    memcpy(dataVec.data(), data, x * y * 4 * sizeof(char));
+    // empty path disables the cache
+    if (!args.pipelineCachePath.has_value()) {
+        config.pipelineCachePath = IQM::GPU::VulkanRuntimeConfig::defaultPipelineCachePath();
+    } else if (!args.pipelineCachePath.value().empty()) {
+        config.pipelineCachePath = args.pipelineCachePath;
+    }
 
-    stbi_image_free(data);
+    // same as the pipeline cache, empty path keeps every kernel at its default size
+    if (!args.workgroupSizesDir.has_value()) {
+        config.workgroupSizesDir = IQM::GPU::VulkanRuntimeConfig::defaultWorkgroupSizesDir();
+    } else if (!args.workgroupSizesDir.value().empty()) {
+        config.workgroupSizesDir = args.workgroupSizesDir;
+    }
 
-    return InputImage{
-        .width = x,
-        .height = y,
-        .data = std::move(dataVec)
-    };
+    // timestamp queries are only read back when they get printed
+    config.gpuTimers = args.verbose;
+    config.halfPrecision = args.halfPrecision;
+    if (args.debugGpu) {
+        config.enableDebugProfile();
+    }
+
+    // IQM_ZERO_COPY=0 forces staged uploads, for comparison
+    if (const char *zeroCopy = std::getenv("IQM_ZERO_COPY"); zeroCopy != nullptr && std::string(zeroCopy) == "0") {
+        config.zeroCopyInputs = false;
+    }
+    // IQM_IMPORT_HOST=0 stages the inputs that are not written directly
+    if (const char *importHost = std::getenv("IQM_IMPORT_HOST"); importHost != nullptr && std::string(importHost) == "0") {
+        config.importHostMemory = false;
+    }
+    // IQM_SUBGROUPS=0 reduces in shared memory even where subgroup operations are supported
+    if (const char *subgroups = std::getenv("IQM_SUBGROUPS"); subgroups != nullptr && std::string(subgroups) == "0") {
+        config.subgroupReductions = false;
+    }
+
+    return config;
+}
+
+void printStartup(const IQM::GPU::VulkanRuntime &vulkan, const std::chrono::time_point<std::chrono::high_resolution_clock> &start, const std::chrono::time_point<std::chrono::high_resolution_clock> &end) {
+    const auto stats = vulkan.pipelineCacheStats();
+    const auto startup = std::chrono::duration<double, std::milli>(end - start);
+
+    std::cout << "Startup (" << vulkan.config().profileName() << " profile): " << startup.count() << " ms, "
+        << (stats.warm ? "warm" : "cold") << " pipeline cache";
+    if (!stats.warm) {
+        std::cout << " (" << stats.rejectReason << ")";
+    }
+    std::cout << ", " << stats.pipelineCount << " pipelines created in " << stats.creationTime.count() << " ms" << std::endl;
+    std::cout << "Workgroup sizes: " << vulkan._workgroupSizes.entries().size() << " tuned kernels";
+    if (!vulkan._workgroupSizesPath.empty()) {
+        std::cout << " (" << vulkan._workgroupSizesPath << ")";
+    }
+    std::cout << std::endl;
 }
 
-std::vector<unsigned char> convertFloatToChar(const std::vector<float>& data) {
-    std::vector<unsigned char> result(data.size());
+void printDecodeOverlap(const ImagePairLoader &loader, const std::chrono::time_point<std::chrono::high_resolution_clock> &initStart, const std::chrono::time_point<std::chrono::high_resolution_clock> &initEnd) {
+    using Millis = std::chrono::duration<double, std::milli>;
+    const auto input = Millis(loader._input.end - loader._input.start);
+    const auto reference = Millis(loader._reference.end - loader._reference.start);
+    const auto init = Millis(initEnd - initStart);
 
-    for (int i = 0; i < data.size(); ++i) {
-        result[i] = static_cast<unsigned char>(data[i] * 255.0f);
+    std::cout << "Decode overlap: input " << input.count() << " ms, reference " << reference.count()
+        << " ms, init " << init.count() << " ms, done in " << Millis(loader._total.end - loader._total.start).count()
+        << " ms instead of " << (input + reference + init).count() << " ms, waited "
+        << Millis(loader._wait.end - loader._wait.start).count() << " ms for decoding" << std::endl;
+}
+
+void printAllocatorStats(const IQM::GPU::VulkanRuntime &vulkan) {
+    const auto stats = vulkan._allocator->stats();
+    constexpr double mib = 1024.0 * 1024.0;
+    std::cout << "Device memory: "
+        << stats.totalAllocations << " allocations in "
+        << stats.deviceAllocations << " device allocations, peak "
+        << static_cast<double>(stats.peakBytesUsed) / mib << " MiB used, "
+        << static_cast<double>(stats.bytesReserved) / mib << " MiB reserved" << std::endl;
+    std::cout << "Input uploads: "
+        << (vulkan._zeroCopyInputs ? "written directly into device local memory"
+            : vulkan._externalMemoryHost ? "imported from host memory" : "staged") << std::endl;
+    std::cout << "Intermediate images: " << (vulkan._halfPrecision ? "16" : "32") << " bit floats" << std::endl;
+    std::cout << "Reductions: "
+        << (vulkan._subgroupArithmetic ? "subgroup operations, subgroup size " + std::to_string(vulkan._subgroupSize) : std::string("shared memory")) << std::endl;
+
+    const auto descriptorStats = vulkan._descriptors->stats();
+    std::cout << "Descriptor sets: "
+        << descriptorStats.totalSets << " allocated from "
+        << descriptorStats.poolCount << " pools, "
+        << descriptorStats.poolGrowths << " pool growths, bound with "
+        << (vulkan._pushDescriptors ? "push descriptors" : "update templates") << std::endl;
+
+    const auto slotStats = vulkan.slotDescriptorStats();
+    std::cout << "Per frame descriptor sets: "
+        << slotStats.totalSets << " allocated from "
+        << slotStats.transientPoolCount << " pools in "
+        << vulkan._slots.size() << " slots, "
+        << slotStats.poolGrowths << " pool growths, "
+        << slotStats.resetCount << " resets, peak "
+        << slotStats.peakTransientSets << " sets" << std::endl;
+
+    for (const auto &[name, ring] : {std::pair{"upload", vulkan._uploadRing.get()}, std::pair{"readback", vulkan._readbackRing.get()}}) {
+        const auto ringStats = ring->stats();
+        std::cout << "Staging " << name << " ring: "
+            << ringStats.reservations << " reservations, "
+            << static_cast<double>(ringStats.bytesReserved) / mib << " MiB in "
+            << ringStats.blockCount << " buffers, peak "
+            << static_cast<double>(ringStats.peakBytesInFlight) / mib << " MiB in flight, "
+            << ringStats.growths << " growths" << std::endl;
     }
 
-    return result;
+    const auto cacheStats = vulkan._imageCache->stats();
+    std::cout << "Image cache: "
+        << cacheStats.hits << " hits, "
+        << cacheStats.misses << " misses ("
+        << cacheStats.hitRate() * 100.0 << "% hit rate), "
+        << cacheStats.cachedImages << " cached images" << std::endl;
 }
 
 void ssim(const IQM::Args& args) {
 #ifdef COMPILE_SSIM
-    auto input = load_image(args.inputPath);
-    auto reference = load_image(args.refPath);
+    // decoding runs alongside the Vulkan and pipeline initialization, joined right before the upload
+    ImagePairLoader loader(args.inputPath, args.refPath);
 
-    if (input.width != reference.width || input.height != reference.height) {
-        throw std::runtime_error("Compared images must have the same size");
-    }
+    const auto initStart = std::chrono::high_resolution_clock::now();
+    const IQM::GPU::VulkanRuntime vulkan(runtimeConfig(args));
+    IQM::GPU::SSIM ssim(vulkan);
+    const auto initEnd = std::chrono::high_resolution_clock::now();
 
-    const IQM::GPU::VulkanRuntime vulkan;
+    // mostly for benchmarks, the defaults are the fastest known configuration
+    if (args.options.contains("SSIM_SPECIALIZE")) {
+        ssim.specialize = std::stoi(args.options.at("SSIM_SPECIALIZE")) != 0;
+    }
+    if (args.options.contains("SSIM_WORKGROUP")) {
+        const auto side = static_cast<uint32_t>(std::stoul(args.options.at("SSIM_WORKGROUP")));
+        ssim.workgroupSize = {side, side};
+    }
 
     if (args.verbose) {
         std::cout << "Selected device: "<< vulkan.selectedDevice << std::endl;
     }
 
-    IQM::GPU::SSIM ssim(vulkan);
+    auto [input, reference] = loader.wait();
 
-    // starts only in debug, needs to init after vulkan
-    initRenderDoc();
+    // starts only in the debug profile, needs to init after vulkan
+    initRenderDoc(vulkan.config().renderDoc);
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = ssim.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = ssim.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -97,15 +199,13 @@ void ssim(const IQM::Args& args) {
 
     if (args.verbose) {
         result.timestamps.print(start, end);
+        printAllocatorStats(vulkan);
+        printStartup(vulkan, initStart, initEnd);
+        printDecodeOverlap(loader, initStart, initEnd);
     }
 
     if (args.outputPath.has_value()) {
-        auto converted = convertFloatToChar(result.imageData);
-
-        auto saveResult = stbi_write_png(args.outputPath.value().c_str(), result.width, result.height, 1, converted.data(), result.width * sizeof(unsigned char));
-        if (saveResult == 0) {
-            throw std::runtime_error("Failed to save output image");
-        }
+        save_image(args.outputPath.value(), result.imageData, result.width, result.height);
     }
 #else
     throw std::runtime_error("SSIM support was not compiled");
@@ -134,25 +234,26 @@ void cw_ssim_ref(const IQM::Args& args) {
 
 void svd(const IQM::Args& args) {
 #ifdef COMPILE_SVD
-    auto input = load_image(args.inputPath);
-    auto reference = load_image(args.refPath);
+    // decoding runs alongside the Vulkan and pipeline initialization, joined right before the upload
+    ImagePairLoader loader(args.inputPath, args.refPath);
 
-    if (input.width != reference.width || input.height != reference.height) {
-        throw std::runtime_error("Compared images must have the same size");
-    }
-
-    const IQM::GPU::VulkanRuntime vulkan;
+    const auto initStart = std::chrono::high_resolution_clock::now();
+    const IQM::GPU::VulkanRuntime vulkan(runtimeConfig(args));
     IQM::GPU::SVD svd(vulkan);
+    const auto initEnd = std::chrono::high_resolution_clock::now();
 
     if (args.verbose) {
         std::cout << "Selected device: "<< vulkan.selectedDevice << std::endl;
     }
 
-    // starts only in debug, needs to init after vulkan
-    initRenderDoc();
+    auto [input, reference] = loader.wait();
+
+    // starts only in the debug profile, needs to init after vulkan
+    initRenderDoc(vulkan.config().renderDoc);
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = svd.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = svd.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -162,15 +263,13 @@ void svd(const IQM::Args& args) {
 
     if (args.verbose) {
         result.timestamps.print(start, end);
+        printAllocatorStats(vulkan);
+        printStartup(vulkan, initStart, initEnd);
+        printDecodeOverlap(loader, initStart, initEnd);
     }
 
     if (args.outputPath.has_value()) {
-        auto converted = convertFloatToChar(result.imageData);
-
-        auto saveResult = stbi_write_png(args.outputPath.value().c_str(), result.width, result.height, 1, converted.data(), result.width * sizeof(unsigned char));
-        if (saveResult == 0) {
-            throw std::runtime_error("Failed to save output image");
-        }
+        save_image(args.outputPath.value(), result.imageData, result.width, result.height);
     }
 #else
     throw std::runtime_error("SVD support was not compiled");
@@ -179,25 +278,26 @@ void svd(const IQM::Args& args) {
 
 void fsim(const IQM::Args& args) {
 #ifdef COMPILE_FSIM
-    auto input = load_image(args.inputPath);
-    auto reference = load_image(args.refPath);
+    // decoding runs alongside the Vulkan and pipeline initialization, joined right before the upload
+    ImagePairLoader loader(args.inputPath, args.refPath);
 
-    if (input.width != reference.width || input.height != reference.height) {
-        throw std::runtime_error("Compared images must have the same size");
-    }
-
-    const IQM::GPU::VulkanRuntime vulkan;
+    const auto initStart = std::chrono::high_resolution_clock::now();
+    const IQM::GPU::VulkanRuntime vulkan(runtimeConfig(args));
     IQM::GPU::FSIM fsim(vulkan);
+    const auto initEnd = std::chrono::high_resolution_clock::now();
 
     if (args.verbose) {
         std::cout << "Selected device: "<< vulkan.selectedDevice << std::endl;
     }
 
-    // starts only in debug, needs to init after vulkan
-    initRenderDoc();
+    auto [input, reference] = loader.wait();
+
+    // starts only in the debug profile, needs to init after vulkan
+    initRenderDoc(vulkan.config().renderDoc);
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = fsim.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = fsim.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -207,6 +307,15 @@ void fsim(const IQM::Args& args) {
 
     if (args.verbose) {
         result.timestamps.print(start, end);
+        printAllocatorStats(vulkan);
+        constexpr double mib = 1024.0 * 1024.0;
+        std::cout << "Transient memory: "
+            << result.transientMemory.resourceCount << " resources, "
+            << static_cast<double>(result.transientMemory.requestedBytes) / mib << " MiB without aliasing, "
+            << static_cast<double>(result.transientMemory.allocatedBytes) / mib << " MiB allocated, "
+            << result.transientMemory.reusedCount << " reused" << std::endl;
+        printStartup(vulkan, initStart, initEnd);
+        printDecodeOverlap(loader, initStart, initEnd);
     }
 #else
     throw std::runtime_error("FSIM support was not compiled");
@@ -215,15 +324,8 @@ void fsim(const IQM::Args& args) {
 
 void flip(const IQM::Args& args) {
 #ifdef COMPILE_FLIP
-    auto input = load_image(args.inputPath);
-    auto reference = load_image(args.refPath);
-
-    if (input.width != reference.width || input.height != reference.height) {
-        throw std::runtime_error("Compared images must have the same size");
-    }
-
-    const IQM::GPU::VulkanRuntime vulkan;
-    IQM::GPU::FLIP flip(vulkan);
+    // decoding runs alongside the Vulkan and pipeline initialization, joined right before the upload
+    ImagePairLoader loader(args.inputPath, args.refPath);
 
     auto flip_args = IQM::GPU::FLIPArguments{};
     if (args.options.contains("FLIP_WIDTH")) {
@@ -236,6 +338,12 @@ void flip(const IQM::Args& args) {
         flip_args.monitor_distance = std::stof(args.options.at("FLIP_DISTANCE"));
     }
 
+    const auto initStart = std::chrono::high_resolution_clock::now();
+    const IQM::GPU::VulkanRuntime vulkan(runtimeConfig(args));
+    // the filter pipelines for these arguments are compiled while the images decode
+    IQM::GPU::FLIP flip(vulkan, flip_args);
+    const auto initEnd = std::chrono::high_resolution_clock::now();
+
     if (args.verbose) {
         std::cout << "Selected device: "<< vulkan.selectedDevice << std::endl
         << "FLIP monitor resolution: "<< flip_args.monitor_resolution_x << std::endl
@@ -243,11 +351,14 @@ void flip(const IQM::Args& args) {
         << "FLIP monitor width: "<< flip_args.monitor_width << std::endl;
     }
 
-    // starts only in debug, needs to init after vulkan
-    initRenderDoc();
+    auto [input, reference] = loader.wait();
+
+    // starts only in the debug profile, needs to init after vulkan
+    initRenderDoc(vulkan.config().renderDoc);
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = flip.computeMetric(vulkan, input, reference, flip_args);
+    auto slot = vulkan.acquireSlot();
+    auto result = flip.computeMetric(vulkan, *slot, input, reference, flip_args);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -255,19 +366,221 @@ void flip(const IQM::Args& args) {
 
     if (args.verbose) {
         result.timestamps.print(start, end);
+        printAllocatorStats(vulkan);
+        printStartup(vulkan, initStart, initEnd);
+        printDecodeOverlap(loader, initStart, initEnd);
     }
 #else
     throw std::runtime_error("FLIP support was not compiled");
 #endif
 }
 
+void autotune(const IQM::Args& args) {
+    IQM::GPU::VulkanRuntime vulkan(runtimeConfig(args));
+    if (vulkan._workgroupSizesPath.empty()) {
+        throw std::runtime_error("Autotuning needs a directory for the workgroup sizes");
+    }
+
+    std::cout << "Tuning workgroup sizes on " << vulkan.selectedDevice << std::endl;
+
+    IQM::Autotuner tuner(args, vulkan);
+    const auto results = tuner.run();
+
+    for (const auto &result : results) {
+        std::cout << result.kernel << ": " << result.size.x << "x" << result.size.y << " " << result.time.count() << " ms, slowest "
+            << result.slowestSize.x << "x" << result.slowestSize.y << " " << result.slowestTime.count() << " ms, "
+            << result.candidates << " candidates" << std::endl;
+    }
+
+    vulkan.saveWorkgroupSizes();
+    std::cout << "Saved to " << vulkan._workgroupSizesPath << std::endl;
+}
+
+void batch(const IQM::Args& args) {
+    if (args.outputPath.has_value()) {
+        throw std::runtime_error("Output image is not supported when comparing multiple pairs, use the output column of a --batch manifest");
+    }
+
+    const auto config = runtimeConfig(args);
+    const auto devices = args.devices.has_value()
+        ? IQM::BatchRunner::parseDevices(args.devices.value())
+        : std::vector{config.device};
+
+    std::vector<IQM::BatchJob> jobs;
+    // printed in front of the result of each job
+    std::vector<std::string> labels;
+    bool failed = false;
+    if (args.inputDir.has_value()) {
+        auto pairs = IQM::BatchRunner::pairDirectories(args.inputDir.value(), args.refDir.value());
+        for (const auto &name : pairs.onlyInInput) {
+            std::cout << name << ": error: missing in " << args.refDir.value() << std::endl;
+        }
+        for (const auto &name : pairs.onlyInRef) {
+            std::cout << name << ": error: missing in " << args.inputDir.value() << std::endl;
+        }
+        failed = !pairs.onlyInInput.empty() || !pairs.onlyInRef.empty();
+        std::cout << "Matched " << pairs.jobs.size() << " pairs, " << pairs.onlyInInput.size() << " files only in "
+            << args.inputDir.value() << ", " << pairs.onlyInRef.size() << " files only in " << args.refDir.value() << std::endl;
+
+        jobs = std::move(pairs.jobs);
+        labels = std::move(pairs.names);
+        if (jobs.empty()) {
+            throw std::runtime_error("No files with the same name in both directories");
+        }
+    } else {
+        if (args.batchManifest.has_value()) {
+            jobs = IQM::BatchRunner::parseManifest(args.batchManifest.value());
+        } else {
+            for (size_t i = 0; i < args.inputPaths.size(); i++) {
+                jobs.emplace_back(IQM::BatchJob{
+                    .inputPath = args.inputPaths[i],
+                    .refPath = args.refPaths[i],
+                });
+            }
+        }
+        for (const auto &job : jobs) {
+            labels.push_back(job.inputPath + " " + job.refPath);
+        }
+    }
+
+    IQM::BatchRunner runner(args, config, devices);
+
+    // lines are streamed as pairs finish, but held back until all earlier pairs are printed to keep the input order
+    std::vector<std::optional<IQM::BatchJobResult>> finished(jobs.size());
+    size_t nextToPrint = 0;
+    const auto printResult = [&](const size_t job, const IQM::BatchJobResult &result) {
+        finished[job] = result;
+        for (; nextToPrint < jobs.size() && finished[nextToPrint].has_value(); nextToPrint++) {
+            const auto &ready = finished[nextToPrint].value();
+            std::cout << labels[nextToPrint] << ":";
+            if (ready.error.has_value()) {
+                std::cout << " error: " << ready.error.value() << std::endl;
+                failed = true;
+                continue;
+            }
+            for (const auto &[name, value] : ready.values) {
+                std::cout << " " << name << ": " << value;
+            }
+            std::cout << std::endl;
+        }
+    };
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const auto results = runner.run(jobs, printResult);
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    // pairs of devices that failed to initialize never reach the callback
+    for (size_t i = nextToPrint; i < jobs.size(); i++) {
+        if (!finished[i].has_value()) {
+            printResult(i, results[i]);
+        }
+    }
+
+    const auto wallTime = std::chrono::duration<double>(end - start);
+    const auto &stats = runner.deviceStats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        std::cout << "Device " << i << " (" << stats[i].name << "): ";
+        if (stats[i].error.has_value()) {
+            std::cout << "failed to initialize: " << stats[i].error.value() << std::endl;
+            continue;
+        }
+        std::cout << stats[i].completed << " pairs, " << stats[i].stolen << " stolen, "
+            << static_cast<double>(stats[i].completed) / wallTime.count() << " pairs/s" << std::endl;
+    }
+    std::cout << "Total: " << jobs.size() << " pairs in " << wallTime.count() << " s, "
+        << static_cast<double>(jobs.size()) / wallTime.count() << " pairs/s" << std::endl;
+
+    // from decoding to the result, including the time waiting for a frame slot
+    std::vector<double> latencies;
+    for (const auto &result : results) {
+        if (!result.error.has_value()) {
+            latencies.push_back(result.time.count());
+        }
+    }
+    if (!latencies.empty()) {
+        std::ranges::sort(latencies);
+        // nearest rank
+        const auto percentile = [&latencies](const double p) {
+            const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(latencies.size())));
+            return latencies[std::clamp<size_t>(rank, 1, latencies.size()) - 1];
+        };
+        std::cout << "Latency: p50 " << percentile(50) << " ms, p90 " << percentile(90) << " ms, p99 "
+            << percentile(99) << " ms, max " << latencies.back() << " ms" << std::endl;
+    }
+
+    // per metric summary, the lowest and highest scoring files are the first ones to look at in regressions
+    if (args.inputDir.has_value()) {
+        struct MetricSummary {
+            std::string name;
+            double sum = 0.0;
+            size_t count = 0;
+            size_t min = 0;
+            size_t max = 0;
+            double minValue = 0.0;
+            double maxValue = 0.0;
+        };
+        std::vector<MetricSummary> summaries;
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &values = results[i].values;
+            for (size_t metric = 0; metric < values.size() && !results[i].error.has_value(); metric++) {
+                if (summaries.size() <= metric) {
+                    summaries.push_back(MetricSummary{.name = values[metric].first});
+                }
+                auto &summary = summaries[metric];
+                const auto value = values[metric].second;
+                if (summary.count == 0 || value < summary.minValue) {
+                    summary.min = i;
+                    summary.minValue = value;
+                }
+                if (summary.count == 0 || value > summary.maxValue) {
+                    summary.max = i;
+                    summary.maxValue = value;
+                }
+                summary.sum += value;
+                summary.count++;
+            }
+        }
+
+        for (const auto &summary : summaries) {
+            std::cout << "Summary " << summary.name << ": mean " << summary.sum / static_cast<double>(summary.count)
+                << ", min " << summary.minValue << " (" << labels[summary.min] << ")"
+                << ", max " << summary.maxValue << " (" << labels[summary.max] << ")"
+                << " over " << summary.count << " pairs" << std::endl;
+        }
+    }
+
+    if (failed) {
+        throw std::runtime_error("Some pairs could not be compared");
+    }
+}
+
+void serve(const IQM::Args& args) {
+    IQM::Server server(args, runtimeConfig(args));
+    server.run();
+}
+
 int main(int argc, const char **argv) {
     auto args = IQM::Args(argc, argv);
-    if (args.verbose) {
+    if (args.verbose && args.methodSelected) {
         std::cout << "Selected method: " << IQM::method_name(args.method) << std::endl;
     }
 
     try {
+        if (args.servePath.has_value()) {
+            serve(args);
+            return 0;
+        }
+
+        if (args.autotune) {
+            autotune(args);
+            return 0;
+        }
+
+        if (args.batchManifest.has_value() || args.inputDir.has_value() || args.devices.has_value() || args.inputPaths.size() > 1) {
+            batch(args);
+            return 0;
+        }
+
         switch (args.method) {
             case IQM::Method::SSIM:
                 ssim(args);
@@ -22,4 +22,19 @@ namespace IQM {
                 throw std::runtime_error("unknown method");
         }
     }
+
+    Method parse_method(const std::string &name) {
+        if (name == "SSIM") {
+            return Method::SSIM;
+        } else if (name == "CW_SSIM_CPU") {
+            return Method::CW_SSIM_CPU;
+        } else if (name == "SVD") {
+            return Method::SVD;
+        } else if (name == "FSIM") {
+            return Method::FSIM;
+        } else if (name == "FLIP") {
+            return Method::FLIP;
+        }
+        throw std::runtime_error("Unknown method");
+    }
 }
\ No newline at end of file
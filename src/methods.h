@@ -19,6 +19,8 @@ namespace IQM {
     };
 
     std::string method_name(const Method &method);
+    // accepts the names used by --method
+    Method parse_method(const std::string &name);
 };
 
 #endif //IQM_METHODS_H
@@ -0,0 +1,122 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "metric_worker.h"
+
+#include <stdexcept>
+
+#if COMPILE_SSIM
+#include <ssim.h>
+#endif
+
+#if COMPILE_SVD
+#include <svd.h>
+#endif
+
+#if COMPILE_FSIM
+#include <fsim.h>
+#endif
+
+#if COMPILE_FLIP
+#include <flip.h>
+#endif
+
+#if COMPILE_SSIM
+class SSIMWorker final : public IQM::MetricWorker {
+public:
+    explicit SSIMWorker(const IQM::GPU::VulkanRuntime &runtime) : runtime(runtime), ssim(runtime) {}
+    IQM::MetricOutput compute(IQM::GPU::FrameSlot &slot, const InputImage &image, const InputImage &ref, const std::unordered_map<std::string, std::string> &) override {
+        auto result = this->ssim.computeMetric(this->runtime, slot, image, ref);
+        return {{{"MSSIM", result.mssim}}, std::move(result.imageData), result.width, result.height};
+    }
+private:
+    const IQM::GPU::VulkanRuntime &runtime;
+    IQM::GPU::SSIM ssim;
+};
+#endif
+
+#if COMPILE_SVD
+class SVDWorker final : public IQM::MetricWorker {
+public:
+    explicit SVDWorker(const IQM::GPU::VulkanRuntime &runtime) : runtime(runtime), svd(runtime) {}
+    IQM::MetricOutput compute(IQM::GPU::FrameSlot &slot, const InputImage &image, const InputImage &ref, const std::unordered_map<std::string, std::string> &) override {
+        auto result = this->svd.computeMetric(this->runtime, slot, image, ref);
+        return {{{"M-SVD", result.msvd}}, std::move(result.imageData), result.width, result.height};
+    }
+private:
+    const IQM::GPU::VulkanRuntime &runtime;
+    IQM::GPU::SVD svd;
+};
+#endif
+
+#if COMPILE_FSIM
+class FSIMWorker final : public IQM::MetricWorker {
+public:
+    explicit FSIMWorker(const IQM::GPU::VulkanRuntime &runtime) : runtime(runtime), fsim(runtime) {}
+    IQM::MetricOutput compute(IQM::GPU::FrameSlot &slot, const InputImage &image, const InputImage &ref, const std::unordered_map<std::string, std::string> &) override {
+        const auto result = this->fsim.computeMetric(this->runtime, slot, image, ref);
+        return {{{"FSIM", result.fsim}, {"FSIMc", result.fsimc}}};
+    }
+private:
+    const IQM::GPU::VulkanRuntime &runtime;
+    IQM::GPU::FSIM fsim;
+};
+#endif
+
+#if COMPILE_FLIP
+class FLIPWorker final : public IQM::MetricWorker {
+public:
+    explicit FLIPWorker(const IQM::GPU::VulkanRuntime &runtime) : runtime(runtime), flip(runtime) {}
+    IQM::MetricOutput compute(IQM::GPU::FrameSlot &slot, const InputImage &image, const InputImage &ref, const std::unordered_map<std::string, std::string> &options) override {
+        auto flipArgs = IQM::GPU::FLIPArguments{};
+        if (options.contains("FLIP_WIDTH")) {
+            flipArgs.monitor_width = std::stof(options.at("FLIP_WIDTH"));
+        }
+        if (options.contains("FLIP_RES")) {
+            flipArgs.monitor_resolution_x = std::stof(options.at("FLIP_RES"));
+        }
+        if (options.contains("FLIP_DISTANCE")) {
+            flipArgs.monitor_distance = std::stof(options.at("FLIP_DISTANCE"));
+        }
+
+        const auto result = this->flip.computeMetric(this->runtime, slot, image, ref, flipArgs);
+        return {{{"FLIP", result.mean_flip}}};
+    }
+private:
+    const IQM::GPU::VulkanRuntime &runtime;
+    IQM::GPU::FLIP flip;
+};
+#endif
+
+std::unique_ptr<IQM::MetricWorker> IQM::createWorker(const Method method, const GPU::VulkanRuntime &runtime) {
+    switch (method) {
+        case Method::SSIM:
+#if COMPILE_SSIM
+            return std::make_unique<SSIMWorker>(runtime);
+#else
+            throw std::runtime_error("SSIM support was not compiled");
+#endif
+        case Method::SVD:
+#if COMPILE_SVD
+            return std::make_unique<SVDWorker>(runtime);
+#else
+            throw std::runtime_error("SVD support was not compiled");
+#endif
+        case Method::FSIM:
+#if COMPILE_FSIM
+            return std::make_unique<FSIMWorker>(runtime);
+#else
+            throw std::runtime_error("FSIM support was not compiled");
+#endif
+        case Method::FLIP:
+#if COMPILE_FLIP
+            return std::make_unique<FLIPWorker>(runtime);
+#else
+            throw std::runtime_error("FLIP support was not compiled");
+#endif
+        default:
+            throw std::runtime_error("Method " + method_name(method) + " can only compare a single pair");
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_METRIC_WORKER_H
+#define IQM_METRIC_WORKER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "methods.h"
+#include "gpu/base/vulkan_runtime.h"
+
+namespace IQM {
+    // metric name -> value, in the order they should be printed
+    using MetricValues = std::vector<std::pair<std::string, double>>;
+
+    struct MetricOutput {
+        MetricValues values;
+        // stays empty for metrics without an output image
+        std::vector<float> imageData;
+        unsigned width = 0;
+        unsigned height = 0;
+    };
+
+    /**
+     * Common interface of the GPU metrics for modes that compute many pairs with one runtime.
+     * A worker keeps its per-pair resources between pairs, so only one pair may use it at a time.
+     */
+    class MetricWorker {
+    public:
+        virtual ~MetricWorker() = default;
+        // options are the same KEY -> value pairs as Args::options
+        virtual MetricOutput compute(GPU::FrameSlot &slot, const InputImage &image, const InputImage &ref, const std::unordered_map<std::string, std::string> &options) = 0;
+    };
+
+    std::unique_ptr<MetricWorker> createWorker(Method method, const GPU::VulkanRuntime &runtime);
+}
+
+#endif //IQM_METRIC_WORKER_H
@@ -6,13 +6,10 @@
 #include <iostream>
 #include <chrono>
 
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_FAILURE_USERMSG
-#include "stb_image.h"
-
 #include "args.h"
 #include "gpu/base/vulkan_runtime.h"
 #include "debug_utils.h"
+#include "image_io.h"
 #include "input_image.h"
 
 #include <GLFW/glfw3.h>
@@ -33,28 +30,6 @@
 #include <flip.h>
 #endif
 
-InputImage load_image(const std::string &filename) {
-    // force all images to always open in RGBA format to prevent issues with separate RGB and RGBA loading
-    int x, y, channels;
-    unsigned char* data = stbi_load(filename.c_str(), &x, &y, &channels, 4);
-    if (data == nullptr) {
-        const auto err = stbi_failure_reason();
-        const auto msg = std::string("Failed to load image '" + filename + "', reason: " + err);
-        throw std::runtime_error(msg);
-    }
-
-    std::vector<unsigned char> dataVec(x * y * 4);
-    memcpy(dataVec.data(), data, x * y * 4 * sizeof(char));
-
-    stbi_image_free(data);
-
-    return InputImage{
-        .width = x,
-        .height = y,
-        .data = std::move(dataVec)
-    };
-}
-
 void ssim(const IQM::Args& args, const IQM::GPU::VulkanRuntime &vulkan, IQM::GPU::SSIM &ssim) {
 #if COMPILE_SSIM
     auto input = load_image(args.inputPath);
@@ -68,7 +43,8 @@ void ssim(const IQM::Args& args, const IQM::GPU::VulkanRuntime &vulkan, IQM::GPU
     initRenderDoc();
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = ssim.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = ssim.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -120,7 +96,8 @@ void svd(const IQM::Args& args, const IQM::GPU::VulkanRuntime &vulkan) {
     initRenderDoc();
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = svd.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = svd.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -150,7 +127,8 @@ void fsim(const IQM::Args& args, const IQM::GPU::VulkanRuntime &vulkan, IQM::GPU
     initRenderDoc();
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = fsim.computeMetric(vulkan, input, reference);
+    auto slot = vulkan.acquireSlot();
+    auto result = fsim.computeMetric(vulkan, *slot, input, reference);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -197,7 +175,8 @@ void flip(const IQM::Args& args, const IQM::GPU::VulkanRuntime &vulkan, IQM::GPU
     initRenderDoc();
 
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = flip.computeMetric(vulkan, input, reference, flip_args);
+    auto slot = vulkan.acquireSlot();
+    auto result = flip.computeMetric(vulkan, *slot, input, reference, flip_args);
     auto end = std::chrono::high_resolution_clock::now();
 
     // saves capture for debugging
@@ -248,41 +227,45 @@ int main(int argc, const char **argv) {
     vulkan.createSwapchain(surface);
     glfwShowWindow(window);
 
-    IQM::GPU::SSIM ssimMethod(vulkan);
-    IQM::GPU::FSIM fsimMethod(vulkan);
-    IQM::GPU::FLIP flipMethod(vulkan);
-
-    while (!glfwWindowShouldClose(window)) {
-        try {
-            auto index = vulkan.acquire();
-
-            switch (args.method) {
-                case IQM::Method::SSIM:
-                    ssim(args, vulkan, ssimMethod);
-                break;
-                case IQM::Method::CW_SSIM_CPU:
-                break;
-                case IQM::Method::SVD:
-                    svd(args, vulkan);
-                break;
-                case IQM::Method::FSIM:
-                    fsim(args, vulkan, fsimMethod);
-                break;
-                case IQM::Method::FLIP:
-                    flip(args, vulkan, flipMethod);
-                break;
+    // metrics must release their memory before the runtime is torn down
+    {
+        IQM::GPU::SSIM ssimMethod(vulkan);
+        IQM::GPU::FSIM fsimMethod(vulkan);
+        IQM::GPU::FLIP flipMethod(vulkan);
+
+        while (!glfwWindowShouldClose(window)) {
+            try {
+                auto index = vulkan.acquire();
+
+                switch (args.method) {
+                    case IQM::Method::SSIM:
+                        ssim(args, vulkan, ssimMethod);
+                    break;
+                    case IQM::Method::CW_SSIM_CPU:
+                    break;
+                    case IQM::Method::SVD:
+                        svd(args, vulkan);
+                    break;
+                    case IQM::Method::FSIM:
+                        fsim(args, vulkan, fsimMethod);
+                    break;
+                    case IQM::Method::FLIP:
+                        flip(args, vulkan, flipMethod);
+                    break;
+                }
+
+                vulkan.present(index);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                exit(-1);
             }
 
-            vulkan.present(index);
-        } catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
-            exit(-1);
+            glfwPollEvents();
         }
 
-        glfwPollEvents();
+        vulkan._device.waitIdle();
     }
 
-    vulkan._device.waitIdle();
     vulkan.~VulkanRuntime();
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -0,0 +1,48 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "serve_client.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+IQM::ServeClient::ServeClient(const std::string &socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path '" + socketPath + "' is too long");
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    this->_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->_fd < 0) {
+        throw std::runtime_error(std::string("Failed to create socket: ") + strerror(errno));
+    }
+    if (connect(this->_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        const auto error = std::string(strerror(errno));
+        close(this->_fd);
+        throw std::runtime_error("Failed to connect to '" + socketPath + "': " + error);
+    }
+}
+
+IQM::ServeClient::~ServeClient() {
+    if (this->_fd >= 0) {
+        close(this->_fd);
+    }
+}
+
+IQM::Serve::Response IQM::ServeClient::compute(const Serve::Request &request) const {
+    Serve::sendRequest(this->_fd, request);
+    const auto frame = Serve::readFrame(this->_fd);
+    if (frame == nullptr) {
+        throw std::runtime_error("Server closed the connection");
+    }
+    return Serve::parseResponse(*frame);
+}
@@ -0,0 +1,33 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_SERVE_CLIENT_H
+#define IQM_SERVE_CLIENT_H
+
+#include <string>
+
+#include "serve_protocol.h"
+
+namespace IQM {
+    /**
+     * Connection to IQM --serve, requests are answered in the order they are sent.
+     * Paths in requests are opened by the server, so they should be absolute.
+     */
+    class ServeClient {
+    public:
+        explicit ServeClient(const std::string &socketPath);
+        ~ServeClient();
+        ServeClient(const ServeClient &) = delete;
+        ServeClient &operator=(const ServeClient &) = delete;
+
+        // errors of the request end up in Response::error, connection failures throw
+        Serve::Response compute(const Serve::Request &request) const;
+
+    private:
+        int _fd = -1;
+    };
+}
+
+#endif //IQM_SERVE_CLIENT_H
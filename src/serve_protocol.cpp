@@ -0,0 +1,272 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "serve_protocol.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// false if the connection was closed before any byte arrived and allowEof is set
+static bool readExact(const int fd, unsigned char *data, const size_t size, const bool allowEof) {
+    size_t done = 0;
+    while (done < size) {
+        const auto count = read(fd, data + done, size - done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            throw std::runtime_error(std::string("Failed to read from socket: ") + strerror(errno));
+        }
+        if (count == 0) {
+            if (done == 0 && allowEof) {
+                return false;
+            }
+            throw std::runtime_error("Connection closed in the middle of a message");
+        }
+        done += count;
+    }
+    return true;
+}
+
+static void writeExact(const int fd, const unsigned char *data, const size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        // a client that went away must not kill the server with SIGPIPE
+        const auto count = send(fd, data + done, size - done, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            throw std::runtime_error(std::string("Failed to write to socket: ") + strerror(errno));
+        }
+        done += count;
+    }
+}
+
+// parts are sent back to back as a single frame, so inline pixels never get copied into one buffer
+static void writeFrame(const int fd, const std::vector<std::span<const unsigned char>> &parts) {
+    size_t size = 0;
+    for (const auto &part : parts) {
+        size += part.size();
+    }
+    if (size > IQM::Serve::MAX_FRAME_SIZE) {
+        throw std::runtime_error("Message of " + std::to_string(size) + " B is over the limit of " + std::to_string(IQM::Serve::MAX_FRAME_SIZE) + " B");
+    }
+
+    const unsigned char header[4] = {
+        static_cast<unsigned char>(size),
+        static_cast<unsigned char>(size >> 8),
+        static_cast<unsigned char>(size >> 16),
+        static_cast<unsigned char>(size >> 24),
+    };
+    writeExact(fd, header, sizeof(header));
+    for (const auto &part : parts) {
+        writeExact(fd, part.data(), part.size());
+    }
+}
+
+static std::span<const unsigned char> bytes(const std::string &text) {
+    return {reinterpret_cast<const unsigned char *>(text.data()), text.size()};
+}
+
+// values end at a newline, so they must not contain one
+static std::string line(const std::string &key, const std::string &value) {
+    if (value.find('\n') != std::string::npos) {
+        throw std::runtime_error("'" + key + "' must not contain a line break");
+    }
+    return key + " " + value + "\n";
+}
+
+// option keys are single upper case words, together with values that are not flags
+// this skips the pairs of unrelated arguments that Args collects, e.g. "SSIM" -> "--input"
+static bool isOptionKey(const std::string &key) {
+    return !key.empty() && std::ranges::all_of(key, [](const unsigned char c) {
+        return std::isupper(c) || std::isdigit(c) || c == '_';
+    });
+}
+
+std::shared_ptr<const PixelData> IQM::Serve::readFrame(const int fd) {
+    const auto size = readFrameSize(fd);
+    if (!size.has_value()) {
+        return nullptr;
+    }
+    return readFrameBody(fd, size.value());
+}
+
+std::optional<uint32_t> IQM::Serve::readFrameSize(const int fd) {
+    unsigned char header[4];
+    if (!readExact(fd, header, sizeof(header), true)) {
+        return std::nullopt;
+    }
+
+    const uint32_t size = header[0] | header[1] << 8 | header[2] << 16 | static_cast<uint32_t>(header[3]) << 24;
+    if (size > MAX_FRAME_SIZE) {
+        throw std::runtime_error("Message of " + std::to_string(size) + " B is over the limit of " + std::to_string(MAX_FRAME_SIZE) + " B");
+    }
+    return size;
+}
+
+std::shared_ptr<const PixelData> IQM::Serve::readFrameBody(const int fd, const uint32_t size) {
+    auto frame = std::make_shared<PixelData>(size);
+    readExact(fd, frame->data(), size, false);
+    return frame;
+}
+
+void IQM::Serve::sendRequest(const int fd, const Request &request) {
+    std::string header = line("method", method_name(request.method));
+    std::vector<std::span<const unsigned char>> pixels;
+    for (const auto &[name, source] : {std::pair{"input", &request.input}, std::pair{"ref", &request.ref}}) {
+        if (source->pixels.has_value()) {
+            const auto &image = source->pixels.value();
+            header += line(std::string(name) + "-pixels", std::to_string(image.width) + " " + std::to_string(image.height));
+            pixels.push_back(image.data);
+        } else {
+            header += line(name, source->path);
+        }
+    }
+    if (request.outputPath.has_value()) {
+        header += line("output", request.outputPath.value());
+    }
+    for (const auto &[key, value] : request.options) {
+        if (isOptionKey(key) && !value.starts_with("--")) {
+            header += line("option", key + " " + value);
+        }
+    }
+    header += "\n";
+
+    std::vector parts = {bytes(header)};
+    parts.insert(parts.end(), pixels.begin(), pixels.end());
+    writeFrame(fd, parts);
+}
+
+IQM::Serve::Request IQM::Serve::parseRequest(const std::shared_ptr<const PixelData> &frame) {
+    const std::string_view text(reinterpret_cast<const char *>(frame->data()), frame->size());
+    const auto headerEnd = text.find("\n\n");
+    if (headerEnd == std::string_view::npos) {
+        throw std::runtime_error("Request header is not terminated by an empty line");
+    }
+
+    Request request{};
+    bool hasMethod = false;
+    bool hasInput = false;
+    bool hasRef = false;
+    // inline images in the order of their pixels after the header
+    std::vector<std::pair<InputImage *, std::pair<int, int>>> inlineImages;
+
+    std::istringstream header{std::string(text.substr(0, headerEnd + 1))};
+    std::string row;
+    while (std::getline(header, row)) {
+        const auto space = row.find(' ');
+        const auto key = row.substr(0, space);
+        const auto value = space == std::string::npos ? std::string() : row.substr(space + 1);
+
+        if (key == "method") {
+            request.method = parse_method(value);
+            hasMethod = true;
+        } else if (key == "input" || key == "ref") {
+            (key == "input" ? request.input : request.ref).path = value;
+            (key == "input" ? hasInput : hasRef) = true;
+        } else if (key == "input-pixels" || key == "ref-pixels") {
+            int width = 0, height = 0;
+            std::istringstream size(value);
+            if (!(size >> width >> height) || width <= 0 || height <= 0) {
+                throw std::runtime_error("Invalid size '" + value + "' of " + key);
+            }
+            auto &source = key == "input-pixels" ? request.input : request.ref;
+            source.pixels = InputImage{};
+            inlineImages.emplace_back(&source.pixels.value(), std::pair{width, height});
+            (key == "input-pixels" ? hasInput : hasRef) = true;
+        } else if (key == "output") {
+            request.outputPath = value;
+        } else if (key == "option") {
+            const auto optionSpace = value.find(' ');
+            if (optionSpace == std::string::npos) {
+                throw std::runtime_error("Option '" + value + "' has no value");
+            }
+            request.options[value.substr(0, optionSpace)] = value.substr(optionSpace + 1);
+        } else {
+            throw std::runtime_error("Unknown request field '" + key + "'");
+        }
+    }
+
+    if (!hasMethod || !hasInput || !hasRef) {
+        throw std::runtime_error("Request needs a method, an input and a reference");
+    }
+
+    size_t offset = headerEnd + 2;
+    for (const auto &[image, size] : inlineImages) {
+        const auto byteCount = static_cast<size_t>(size.first) * size.second * 4;
+        if (offset + byteCount > frame->size()) {
+            throw std::runtime_error("Request is shorter than its inline pixels");
+        }
+        // the frame starts on an aligned boundary, but the pixels after the header do not, so they are never imported
+        *image = InputImage{
+            .width = size.first,
+            .height = size.second,
+            .data = std::span(frame->data() + offset, byteCount),
+            .owner = frame,
+        };
+        offset += byteCount;
+    }
+    if (offset != frame->size()) {
+        throw std::runtime_error("Request is longer than its inline pixels");
+    }
+
+    return request;
+}
+
+void IQM::Serve::sendResponse(const int fd, const Response &response) {
+    std::string text;
+    if (response.error.has_value()) {
+        auto message = response.error.value();
+        std::ranges::replace(message, '\n', ' ');
+        text = "error " + message + "\n";
+    } else {
+        text = "ok\n";
+        for (const auto &[name, value] : response.values) {
+            // shortest representation that parses back to the same double
+            char number[32];
+            const auto end = std::to_chars(number, number + sizeof(number), value).ptr;
+            text += name + " " + std::string(number, end) + "\n";
+        }
+    }
+    writeFrame(fd, {bytes(text)});
+}
+
+IQM::Serve::Response IQM::Serve::parseResponse(const PixelData &frame) {
+    std::istringstream text{std::string(reinterpret_cast<const char *>(frame.data()), frame.size())};
+    std::string row;
+    if (!std::getline(text, row)) {
+        throw std::runtime_error("Empty response");
+    }
+
+    Response response;
+    if (row.starts_with("error ")) {
+        response.error = row.substr(6);
+        return response;
+    }
+    if (row != "ok") {
+        throw std::runtime_error("Invalid response status '" + row + "'");
+    }
+
+    while (std::getline(text, row)) {
+        const auto space = row.rfind(' ');
+        double value = 0.0;
+        if (space == std::string::npos || std::from_chars(row.data() + space + 1, row.data() + row.size(), value).ec != std::errc()) {
+            throw std::runtime_error("Invalid response line '" + row + "'");
+        }
+        response.values.emplace_back(row.substr(0, space), value);
+    }
+    return response;
+}
@@ -0,0 +1,72 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_SERVE_PROTOCOL_H
+#define IQM_SERVE_PROTOCOL_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "input_image.h"
+#include "methods.h"
+
+/**
+ * Protocol between IQM --serve and its clients over a Unix domain socket.
+ *
+ * Every message is a frame, a little endian uint32 byte count followed by that many bytes.
+ * A request frame starts with text lines "key value", ended by an empty line:
+ *   method SSIM
+ *   input /path/to/input.png      or   input-pixels WIDTH HEIGHT
+ *   ref /path/to/ref.png          or   ref-pixels WIDTH HEIGHT
+ *   output /path/to/output.png    optional, written by the server
+ *   option KEY value              any number of them, the same options as on the command line
+ * followed by the RGBA pixels, 1B per channel, of the inline input and then of the inline reference.
+ * The response frame holds either "ok" and a "NAME value" line per metric value, or "error message".
+ * A connection may send any number of requests, each one is answered before the next one is read.
+ */
+namespace IQM::Serve {
+    constexpr uint32_t MAX_FRAME_SIZE = 1u << 30;
+
+    // either a path the server loads or pixels sent with the request
+    struct ImageSource {
+        std::string path;
+        std::optional<InputImage> pixels;
+    };
+
+    struct Request {
+        Method method;
+        ImageSource input;
+        ImageSource ref;
+        std::optional<std::string> outputPath = std::nullopt;
+        std::unordered_map<std::string, std::string> options;
+    };
+
+    struct Response {
+        // metric name -> value, in the order they should be printed
+        std::vector<std::pair<std::string, double>> values;
+        std::optional<std::string> error = std::nullopt;
+    };
+
+    // nullptr if the peer closed the connection before the frame started, throws on errors and truncated frames
+    std::shared_ptr<const PixelData> readFrame(int fd);
+    // readFrame in two steps, so the receiver can wait with allocating the frame until it is ready to process it
+    // nullopt if the peer closed the connection before the frame started, throws for sizes over MAX_FRAME_SIZE
+    std::optional<uint32_t> readFrameSize(int fd);
+    std::shared_ptr<const PixelData> readFrameBody(int fd, uint32_t size);
+
+    void sendRequest(int fd, const Request &request);
+    // inline pixels are views into the frame
+    Request parseRequest(const std::shared_ptr<const PixelData> &frame);
+
+    void sendResponse(int fd, const Response &response);
+    Response parseResponse(const PixelData &frame);
+}
+
+#endif //IQM_SERVE_PROTOCOL_H
@@ -0,0 +1,237 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#include "server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "image_io.h"
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+static sockaddr_un socketAddress(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path '" + path + "' is too long");
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+IQM::Server::Server(const Args &args, const GPU::VulkanRuntimeConfig &config):
+_args(args),
+_socketPath(args.servePath.value())
+{
+    this->_runtime = std::make_unique<GPU::VulkanRuntime>(config);
+
+    // metric instances hold per-pair resources, so every slot in flight needs its own
+    this->_lanes = std::vector<Lane>(this->_runtime->slotCount());
+    for (auto &lane : this->_lanes) {
+        // with --method, pipelines of that method are ready before the first request
+        if (args.methodSelected) {
+            lane.metrics[args.method] = createWorker(args.method, *this->_runtime);
+        }
+        this->_freeLanes.push_back(&lane);
+    }
+
+    const auto address = socketAddress(this->_socketPath);
+
+    // bind fails on a socket file left behind by a server that is gone, but must not steal one from a running server
+    if (std::filesystem::is_socket(this->_socketPath)) {
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const bool running = probe >= 0 && connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (running) {
+            throw std::runtime_error("Another server is listening on '" + this->_socketPath + "'");
+        }
+        std::filesystem::remove(this->_socketPath);
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Failed to create socket: ") + strerror(errno));
+    }
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        const auto error = std::string(strerror(errno));
+        close(fd);
+        throw std::runtime_error("Failed to listen on '" + this->_socketPath + "': " + error);
+    }
+    this->_listenFd = fd;
+}
+
+IQM::Server::~Server() {
+    if (this->_listenFd >= 0) {
+        close(this->_listenFd);
+        std::filesystem::remove(this->_socketPath);
+    }
+}
+
+void IQM::Server::run() {
+    // without SA_RESTART, so poll() returns as soon as a signal arrives
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Serving on " << this->_socketPath << " with " << this->_runtime->selectedDevice << ", "
+        << this->_lanes.size() << " requests in parallel" << std::endl;
+
+    while (stopRequested == 0) {
+        this->reapConnections(false);
+        bool accepting;
+        {
+            std::lock_guard lock(this->_connectionsMutex);
+            accepting = this->_connections.size() < MAX_CONNECTIONS;
+        }
+
+        // at the limit the socket is not polled for clients, they stay in the backlog until a connection is reaped
+        pollfd listening{.fd = this->_listenFd, .events = static_cast<short>(accepting ? POLLIN : 0), .revents = 0};
+        const auto ready = poll(&listening, 1, 500);
+        if (ready <= 0 || !accepting) {
+            continue;
+        }
+
+        const int fd = accept4(this->_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+
+        std::lock_guard lock(this->_connectionsMutex);
+        auto &connection = this->_connections.emplace_back();
+        connection.fd = fd;
+        connection.thread = std::thread([this, &connection] {
+            this->serveConnection(connection);
+        });
+    }
+
+    // connections wait for their next request in read(), which returns once the socket is shut down for reading,
+    // requests in progress still get their response
+    {
+        std::lock_guard lock(this->_connectionsMutex);
+        for (const auto &connection : this->_connections) {
+            shutdown(connection.fd, SHUT_RD);
+        }
+    }
+    this->reapConnections(true);
+}
+
+void IQM::Server::serveConnection(Connection &connection) {
+    try {
+        while (const auto size = Serve::readFrameSize(connection.fd)) {
+            Serve::Response response;
+            {
+                // the frame is allocated and read only with a lane reserved, and freed before the lane is returned
+                const LaneGuard lane(*this);
+                const auto frame = Serve::readFrameBody(connection.fd, size.value());
+                try {
+                    response = this->handle(lane.lane(), Serve::parseRequest(frame));
+                } catch (const std::exception &e) {
+                    response.error = e.what();
+                }
+            }
+            Serve::sendResponse(connection.fd, response);
+        }
+    } catch (const std::exception &e) {
+        // a broken connection only ends its own thread
+        if (this->_args.verbose) {
+            std::cerr << "Connection closed: " << e.what() << std::endl;
+        }
+    }
+
+    // the socket is closed once the thread is joined, so run() never shuts down a reused descriptor
+    connection.finished = true;
+}
+
+IQM::Serve::Response IQM::Server::handle(Lane &lane, const Serve::Request &request) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // decoding of one lane still overlaps the GPU work of the others
+    const auto load = [](const Serve::ImageSource &source) {
+        return source.pixels.has_value() ? source.pixels.value() : load_image(source.path);
+    };
+    const auto input = load(request.input);
+    const auto reference = load(request.ref);
+    if (input.width != reference.width || input.height != reference.height) {
+        throw std::runtime_error("Compared images must have the same size");
+    }
+
+    auto &metric = lane.metrics[request.method];
+    if (metric == nullptr) {
+        metric = createWorker(request.method, *this->_runtime);
+    }
+    MetricOutput output;
+    {
+        const auto slot = this->_runtime->acquireSlot();
+        output = metric->compute(*slot, input, reference, request.options);
+    }
+
+    if (request.outputPath.has_value()) {
+        if (output.imageData.empty()) {
+            throw std::runtime_error("Method " + method_name(request.method) + " has no output image");
+        }
+        save_image(request.outputPath.value(), output.imageData, output.width, output.height);
+    }
+
+    if (this->_args.verbose) {
+        const auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+        // one write per line, connections print concurrently
+        std::ostringstream log;
+        log << method_name(request.method) << " "
+            << (request.input.pixels.has_value() ? "inline" : request.input.path) << " "
+            << (request.ref.pixels.has_value() ? "inline" : request.ref.path) << ": " << time.count() << " ms\n";
+        std::cout << log.str() << std::flush;
+    }
+
+    return Serve::Response{.values = std::move(output.values)};
+}
+
+IQM::Server::Lane *IQM::Server::acquireLane() {
+    std::unique_lock lock(this->_lanesMutex);
+    this->_laneReleased.wait(lock, [this] { return !this->_freeLanes.empty(); });
+    auto *lane = this->_freeLanes.back();
+    this->_freeLanes.pop_back();
+    return lane;
+}
+
+void IQM::Server::releaseLane(Lane *lane) {
+    {
+        std::lock_guard lock(this->_lanesMutex);
+        this->_freeLanes.push_back(lane);
+    }
+    this->_laneReleased.notify_one();
+}
+
+void IQM::Server::reapConnections(const bool all) {
+    std::lock_guard lock(this->_connectionsMutex);
+    for (auto it = this->_connections.begin(); it != this->_connections.end();) {
+        if (!all && !it->finished) {
+            ++it;
+            continue;
+        }
+        it->thread.join();
+        close(it->fd);
+        it = this->_connections.erase(it);
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * Image Quality Metrics
+ * Petr Volf - 2025
+ */
+
+#ifndef IQM_SERVER_H
+#define IQM_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "args.h"
+#include "metric_worker.h"
+#include "serve_protocol.h"
+#include "gpu/base/vulkan_runtime.h"
+
+namespace IQM {
+    /**
+     * Computes metrics for clients of a Unix domain socket, see serve_protocol.h for the messages.
+     *
+     * The runtime, its pipelines and the metric instances with their FFT plans and cached images
+     * stay alive between requests, so only the first request of a method pays for their creation.
+     * Every connection is served by its own thread, at most MAX_CONNECTIONS of them, further clients wait
+     * in the listen backlog. A connection reserves a free lane, a set of metric instances of which there is
+     * one per frame slot, before it reads the body of a request and loads its images, so memory of requests
+     * in progress is bounded by the number of lanes and not by the number of clients.
+     */
+    class Server {
+    public:
+        static constexpr size_t MAX_CONNECTIONS = 64;
+
+        Server(const Args &args, const GPU::VulkanRuntimeConfig &config);
+        ~Server();
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        // accepts clients until SIGINT or SIGTERM, then waits for the requests in progress
+        void run();
+
+    private:
+        struct Lane {
+            // created on the first request of each method
+            std::unordered_map<Method, std::unique_ptr<MetricWorker>> metrics;
+        };
+
+        struct Connection {
+            int fd = -1;
+            std::thread thread;
+            std::atomic<bool> finished = false;
+        };
+
+        // holds a lane from construction to destruction
+        class LaneGuard {
+        public:
+            explicit LaneGuard(Server &server): _server(server), _lane(server.acquireLane()) {}
+            ~LaneGuard() { this->_server.releaseLane(this->_lane); }
+            LaneGuard(const LaneGuard &) = delete;
+            LaneGuard &operator=(const LaneGuard &) = delete;
+
+            [[nodiscard]] Lane &lane() const { return *this->_lane; }
+
+        private:
+            Server &_server;
+            Lane *_lane;
+        };
+
+        void serveConnection(Connection &connection);
+        Serve::Response handle(Lane &lane, const Serve::Request &request);
+        Lane *acquireLane();
+        void releaseLane(Lane *lane);
+        void reapConnections(bool all);
+
+        const Args &_args;
+        std::string _socketPath;
+        int _listenFd = -1;
+        std::unique_ptr<GPU::VulkanRuntime> _runtime;
+
+        std::vector<Lane> _lanes;
+        std::vector<Lane *> _freeLanes;
+        std::mutex _lanesMutex;
+        std::condition_variable _laneReleased;
+
+        std::list<Connection> _connections;
+        std::mutex _connectionsMutex;
+    };
+}
+
+#endif //IQM_SERVER_H
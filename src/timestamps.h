@@ -12,12 +12,23 @@
 #include <vector>
 #include <cmath>
 
+struct GpuTimestamp {
+    std::string name;
+    // relative to the earliest timer of the same run
+    std::chrono::duration<double, std::milli> start;
+    std::chrono::duration<double, std::milli> duration;
+};
+
 class Timestamps {
 public:
     std::vector<std::pair<std::string, std::chrono::time_point<std::chrono::high_resolution_clock>>> inner;
+    std::vector<GpuTimestamp> gpu;
     void mark(const std::string& name) {
         inner.emplace_back(name, std::chrono::high_resolution_clock::now());
     }
+    void addGpu(const std::vector<GpuTimestamp>& timers) {
+        gpu.insert(gpu.end(), timers.begin(), timers.end());
+    }
     void print(
         const std::chrono::time_point<std::chrono::high_resolution_clock> start,
         const std::chrono::time_point<std::chrono::high_resolution_clock> end
@@ -47,6 +58,27 @@ public:
         }
 
         std::cout << std::setw(longestName) << "TOTAL" << ": " << std::setw(timePad) << execTime << std::endl;
+
+        if (gpu.empty()) {
+            return;
+        }
+
+        // start on the GPU timeline | time spent in the pass
+        int longestGpuName = 0;
+        for (const auto& timer : gpu) {
+            longestGpuName = std::max(longestGpuName, static_cast<int>(timer.name.length()));
+        }
+
+        std::cout << std::endl << std::setw(longestGpuName) << "GPU" << std::endl;
+        std::chrono::duration<double, std::milli> gpuTotal{};
+        for (const auto& timer : gpu) {
+            auto start = std::chrono::duration_cast<std::chrono::microseconds>(timer.start);
+            auto duration = std::chrono::duration_cast<std::chrono::microseconds>(timer.duration);
+            std::cout << std::setw(longestGpuName) << timer.name << ": " << std::setw(timePad) << start << " | " << std::setw(timePad) << duration << std::endl;
+            gpuTotal += timer.duration;
+        }
+
+        std::cout << std::setw(longestGpuName) << "TOTAL" << ": " << std::setw(timePad) << std::chrono::duration_cast<std::chrono::microseconds>(gpuTotal) << std::endl;
     }
 };
 